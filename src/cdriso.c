@@ -29,14 +29,11 @@
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
-#include <process.h>
 #include <windows.h>
 
 #define strcasecmp _stricmp
 #define fseeko fseek
 #define ftello ftell
-#else // UNIX:
-#include <pthread.h>
 #endif
 
 #include <sys/time.h>
@@ -51,7 +48,6 @@
 #define OFF_T_MSB ((off_t)1 << (sizeof(off_t) * 8 - 1))
 
 static FILE *cdHandle = NULL;
-static FILE *cddaHandle = NULL;
 static FILE *subHandle = NULL;
 
 static uint_fast8_t subChanMixed = FALSE;
@@ -63,25 +59,13 @@ static uint_fast8_t multifile = FALSE;
 static unsigned char cdbuffer[CD_FRAMESIZE_RAW];
 static unsigned char subbuffer[SUB_FRAMESIZE];
 
-static unsigned char sndbuffer[CD_FRAMESIZE_RAW * 10];
-
 unsigned char *(*CDR_getBuffer)(void);
 
-#define CDDA_FRAMETIME			(1000 * (sizeof(sndbuffer) / CD_FRAMESIZE_RAW) / 75)
-
-#ifdef _WIN32
-static HANDLE threadid;
-#else
-static pthread_t threadid;
-#endif
-static unsigned int initial_offset = 0;
 static uint_fast8_t playing = FALSE;
 static uint_fast8_t cddaBigEndian = FALSE;
 
-// cdda sectors in toc, byte offset in file
+// cdda sector being played
 static unsigned int cdda_cur_sector;
-static unsigned int cdda_first_sector;
-static unsigned int cdda_file_offset;
 /* Frame offset into CD image where pregap data would be found if it was there.
  * If a game seeks there we must *not* return subchannel data since it's
  * not in the CD image, so that cdrom code can fake subchannel data instead.
@@ -243,139 +227,9 @@ static void tok2msf(char *time, char *msf) {
 	}
 }
 
-#ifndef _WIN32
-static long GetTickCount(void) {
-	static time_t		initial_time = 0;
-	struct timeval		now;
-
-	gettimeofday(&now, NULL);
-
-	if (initial_time == 0) {
-		initial_time = now.tv_sec;
-	}
-
-	return (now.tv_sec - initial_time) * 1000L + now.tv_usec / 1000L;
-}
-#endif
-
-#ifdef _WIN32
-static void playthread(void *param)
-#else
-static void *playthread(void *param)
-#endif
-{
-	long osleep, d, t, i, s;
-	unsigned char	tmp;
-	int ret = 0, sector_offs;
-
-	t = GetTickCount();
-
-	while (playing) {
-		s = 0;
-		for (i = 0; i < sizeof(sndbuffer) / CD_FRAMESIZE_RAW; i++) {
-			sector_offs = cdda_cur_sector - cdda_first_sector;
-			if (sector_offs < 0) {
-				d = CD_FRAMESIZE_RAW;
-				memset(sndbuffer + s, 0, d);
-			}
-			else {
-				d = cdimg_read_func(cddaHandle, cdda_file_offset,
-					sndbuffer + s, sector_offs);
-				if (d < CD_FRAMESIZE_RAW)
-					break;
-			}
-
-			s += d;
-			cdda_cur_sector++;
-		}
-
-		if (s == 0) {
-			playing = FALSE;
-			initial_offset = 0;
-			break;
-		}
-
-		if (!cdr.Muted && playing) {
-			if (cddaBigEndian) {
-				for (i = 0; i < s / 2; i++) {
-					tmp = sndbuffer[i * 2];
-					sndbuffer[i * 2] = sndbuffer[i * 2 + 1];
-					sndbuffer[i * 2 + 1] = tmp;
-				}
-			}
-
-			// can't do it yet due to readahead..
-			//cdrAttenuate((short *)sndbuffer, s / 4, 1);
-			do {
-				ret = SPU_playCDDAchannel((short *)sndbuffer, s);
-				if (ret == 0x7761)
-					usleep(6 * 1000);
-			} while (ret == 0x7761 && playing); // rearmed_wait
-		}
-
-		if (ret != 0x676f) { // !rearmed_go
-			// do approx sleep
-			long now;
-
-			//senquack - disabled pcsxReARMed-specific stuff we don't have (yet)
-			// HACK: stop feeding data while emu is paused
-			//extern int stop;
-			//while (stop && playing)
-			//	usleep(10000);
-
-			now = GetTickCount();
-			osleep = t - now;
-			if (osleep <= 0) {
-				osleep = 1;
-				t = now;
-			}
-			else if (osleep > CDDA_FRAMETIME) {
-				osleep = CDDA_FRAMETIME;
-				t = now;
-			}
-
-			usleep(osleep * 1000);
-			t += CDDA_FRAMETIME;
-		}
-
-	}
-
-#ifdef _WIN32
-	_endthread();
-#else
-	pthread_exit(0);
-	return NULL;
-#endif
-}
-
-// stop the CDDA playback
-static void stopCDDA() {
-	if (!playing) {
-		return;
-	}
-
-	playing = FALSE;
-#ifdef _WIN32
-	WaitForSingleObject(threadid, INFINITE);
-#else
-	pthread_join(threadid, NULL);
-#endif
-}
-
-// start the CDDA playback
-static void startCDDA(void) {
-	if (playing) {
-		stopCDDA();
-	}
-
-	playing = TRUE;
-
-#ifdef _WIN32
-	threadid = (HANDLE)_beginthread(playthread, 0, NULL);
-#else
-	pthread_create(&threadid, NULL, playthread, NULL);
-#endif
-}
+// CD audio is not streamed from here: cdrom.c's cdrPlayInterrupt() pulls
+//  each sector with CDR_readCDDA() as emulated time advances, and feeds
+//  it to the SPU. CDR_play()/CDR_stop() only track play state.
 
 // this function tries to get the .toc file of the given .bin
 // the necessary data is put into the ti (trackinformation)-array
@@ -1662,7 +1516,6 @@ long CDR_open(void) {
 		ti[1].handle = fopen(bin_filename, "rb");
 	}
 	cdda_cur_sector = 0;
-	cdda_file_offset = 0;
 
 	return 0;
 }
@@ -1678,8 +1531,7 @@ long CDR_close(void) {
 		fclose(subHandle);
 		subHandle = NULL;
 	}
-	stopCDDA();
-	cddaHandle = NULL;
+	playing = FALSE;
 
 	if (compr_img != NULL) {
 		free(compr_img->index_table);
@@ -1830,37 +1682,18 @@ long CDR_readTrack(unsigned char *time) {
 // sector: byte 0 - minute; byte 1 - second; byte 2 - frame
 // does NOT uses bcd format
 long CDR_play(unsigned char *time) {
-	unsigned int i;
-
 	if (numtracks <= 1)
 		return 0;
 
-	// find the track
 	cdda_cur_sector = msf2sec((char *)time);
-	for (i = numtracks; i > 1; i--) {
-		cdda_first_sector = msf2sec(ti[i].start);
-		if (cdda_first_sector <= cdda_cur_sector + 2 * 75)
-			break;
-	}
-	cdda_file_offset = ti[i].start_offset;
-
-	// find the file that contains this track
-	for (; i > 1; i--)
-		if (ti[i].handle != NULL)
-			break;
-
-	cddaHandle = ti[i].handle;
-
-	// Uncomment when SPU_playCDDAchannel is a func ptr again
-	//if (SPU_playCDDAchannel != NULL)
-		startCDDA();
+	playing = TRUE;
 
 	return 0;
 }
 
 // stops cdda audio
 long CDR_stop(void) {
-	stopCDDA();
+	playing = FALSE;
 	return 0;
 }
 
@@ -1903,6 +1736,14 @@ long CDR_getStatus(struct CdrStat *stat) {
 	return 0;
 }
 
+// advance CDDA play position to a sector played without being read
+//  (CD audio muted or disabled), so CDR_getStatus() doesn't report it stuck
+void CDR_setCDDAPos(unsigned char m, unsigned char s, unsigned char f) {
+	unsigned char msf[3] = {m, s, f};
+
+	cddaCurPos = msf2sec((char *)msf);
+}
+
 // read CDDA sector into buffer
 long CDR_readCDDA(unsigned char m, unsigned char s, unsigned char f, unsigned char *buffer) {
 	unsigned char msf[3] = {m, s, f};
@@ -29,5 +29,6 @@ extern void (CALLBACK *cdrIsoMultidiskCallback)(void);
 extern unsigned int cdrIsoMultidiskCount;
 extern unsigned int cdrIsoMultidiskSelect;
 extern long CDR_readCDDA(unsigned char m, unsigned char s, unsigned char f, unsigned char *buffer);
+extern void CDR_setCDDAPos(unsigned char m, unsigned char s, unsigned char f);
 
 #endif
@@ -39,6 +39,7 @@
 #include "ppf.h"
 #include "psxdma.h"
 #include "psxevents.h"
+#include "psxtrace.h"
 
 #if defined(CDR_LOG) || defined(CDR_LOG_I) || defined(CDR_LOG_IO)
 static const char *CmdName[0x100]= {
@@ -546,6 +547,27 @@ static void cdrPlayInterrupt_Autopause()
 	}
 }
 
+// Feed the sector being played to the SPU. CD audio is paced by this
+//  event like the rest of the drive, so it stays in step with emulated
+//  time whatever the emulator's speed.
+static void cdrPlayCdda(void)
+{
+	int16_t buf[CD_FRAMESIZE_RAW / 2];
+
+	if (Config.Cdda || cdr.Muted) {
+		CDR_setCDDAPos(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1],
+		               cdr.SetSectorPlay[2]);
+		return;
+	}
+
+	if (CDR_readCDDA(cdr.SetSectorPlay[0], cdr.SetSectorPlay[1],
+	                 cdr.SetSectorPlay[2], (uint8_t *)buf) != 0)
+		return;
+
+	cdrAttenuate(buf, CD_FRAMESIZE_RAW / 4, 1);
+	SPU_playCDDAchannel(buf, CD_FRAMESIZE_RAW);
+}
+
 // also handles seek
 void cdrPlayInterrupt()
 {
@@ -590,6 +612,8 @@ void cdrPlayInterrupt()
 
 	if (!cdr.Play) return;
 
+	cdrPlayCdda();
+
 	cdr.SetSectorPlay[2]++;
 	if (cdr.SetSectorPlay[2] == 75) {
 		cdr.SetSectorPlay[2] = 0;
@@ -623,6 +647,8 @@ void cdrInterrupt()
 	int delay;
 	unsigned int seekTime = 0;
 
+	TRACE_INSTANT_EV(TRACE_CDR_IRQ, Irq, cdr.Stat);
+
 	// Reschedule IRQ
 	if (cdr.Stat) {
 		CDR_LOG_I("cdrom: stat hack: %02x %x\n", cdr.Irq, cdr.Stat);
@@ -24,11 +24,6 @@
 
 #include "decode_xa.h"
 
-#define FIXED
-
-#define NOT(_X_)				(!(_X_))
-#define XACLAMP(_X_,_MI_,_MA_)	{if(_X_<_MI_)_X_=_MI_; else if(_X_>_MA_)_X_=_MA_;}
-
 #define SH	4
 #define SHC	10
 
@@ -36,37 +31,22 @@
 //===  ADPCM DECODING ROUTINES
 //============================================
 
-#ifndef FIXED
-static double K0[4] = {
-    0.0,
-    0.9375,
-    1.796875,
-    1.53125
+// Prediction filter coefficients, negated and in 1<<SHC fixed point
+static const int IK0[4] = {
+	-(int)(0.0       * (double)(1<<SHC)),
+	-(int)(0.9375    * (double)(1<<SHC)),
+	-(int)(1.796875  * (double)(1<<SHC)),
+	-(int)(1.53125   * (double)(1<<SHC))
 };
 
-static double K1[4] = {
-    0.0,
-    0.0,
-    -0.8125,
-    -0.859375
-};
-#else
-static int K0[4] = {
-	(int)(0.0       * (double)(1<<SHC)),
-	(int)(0.9375    * (double)(1<<SHC)),
-	(int)(1.796875  * (double)(1<<SHC)),
-	(int)(1.53125   * (double)(1<<SHC))
-};
- 
-static int K1[4] = {
-	(int)(0.0       * (double)(1<<SHC)),
-	(int)(0.0       * (double)(1<<SHC)),
-	(int)(-0.8125   * (double)(1<<SHC)),
-	(int)(-0.859375 * (double)(1<<SHC))
+static const int IK1[4] = {
+	-(int)(0.0       * (double)(1<<SHC)),
+	-(int)(0.0       * (double)(1<<SHC)),
+	-(int)(-0.8125   * (double)(1<<SHC)),
+	-(int)(-0.859375 * (double)(1<<SHC))
 };
-#endif
 
-#define BLKSIZ 28       /* block size (32 - 4 nibbles) */
+#define BLKSIZ 28       /* samples per sound unit */
 
 //===========================================
 void ADPCM_InitDecode(ADPCM_Decode_t *decp) {
@@ -74,190 +54,157 @@ void ADPCM_InitDecode(ADPCM_Decode_t *decp) {
 	decp->y1 = 0;
 }
 
-//===========================================
-#ifndef FIXED
-#define IK0(fid)	((int)((-K0[fid]) * (1<<SHC)))
-#define IK1(fid)	((int)((-K1[fid]) * (1<<SHC)))
+/*
+ * A sound group is 16 header bytes followed by 28 rows of 4 data bytes.
+ * Row k holds sample k of all 8 sound units, as nibble 'u' of the row
+ * read as a little-endian word. Shifting that nibble to the top of the
+ * word, masking off the rest and arithmetic-shifting it back down by
+ * 16+range does sign extension and range scaling in one go, and does it
+ * for all samples of a unit alike: with SSE2/NEON, four rows at a time.
+ *
+ * Level A (8-bit) sectors are decoded as nibbles, too: sample n of unit
+ * pair i is nibble n&1 of byte i of row n/2. This isn't how 8-bit XA is
+ * supposed to be decoded, but matches what this decoder always did.
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define XA_USE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define XA_USE_NEON
+#endif
+
+#define XA_NIBBLE(row, lsh, rsh)  ((int32_t)(((row) << (lsh)) & 0xf0000000) >> (rsh))
+
+INLINE uint32_t xa_row(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Expand sound unit 'u' (0..7) of 4-bit group data to 16.SH fixed point
+static void xa_expand_unit4(int32_t *x, const uint8_t *datap, int u, int range)
+{
+	const int lsh = 28 - 4*u, rsh = 16 + range;
+	int k;
+#if defined(XA_USE_SSE2)
+	const __m128i vlsh = _mm_cvtsi32_si128(lsh), vrsh = _mm_cvtsi32_si128(rsh);
+	const __m128i mask = _mm_set1_epi32(0xf0000000);
+	for (k = 0; k < BLKSIZ; k += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(datap + k*4));
+		v = _mm_and_si128(_mm_sll_epi32(v, vlsh), mask);
+		v = _mm_sra_epi32(v, vrsh);
+		_mm_storeu_si128((__m128i *)(x + k), _mm_slli_epi32(v, SH));
+	}
+#elif defined(XA_USE_NEON)
+	const int32x4_t vlsh = vdupq_n_s32(lsh), vrsh = vdupq_n_s32(-rsh);
+	const uint32x4_t mask = vdupq_n_u32(0xf0000000);
+	for (k = 0; k < BLKSIZ; k += 4) {
+		uint32x4_t v = vshlq_u32(vreinterpretq_u32_u8(vld1q_u8(datap + k*4)), vlsh);
+		v = vandq_u32(v, mask);
+		int32x4_t w = vshlq_s32(vreinterpretq_s32_u32(v), vrsh);
+		vst1q_s32(x + k, vshlq_n_s32(w, SH));
+	}
 #else
-#define IK0(fid)	(-K0[fid])
-#define IK1(fid)	(-K1[fid])
+	for (k = 0; k < BLKSIZ; k++)
+		x[k] = XA_NIBBLE(xa_row(datap + k*4), lsh, rsh) << SH;
 #endif
+}
+
+// Expand unit 2*i+n of 8-bit (level A) group data, see above
+static void xa_expand_unit8(int32_t *x, const uint8_t *datap, int i, int range)
+{
+	const int rsh = 16 + range;
+	int k;
+	for (k = 0; k < BLKSIZ; k += 2) {
+		uint32_t row = xa_row(datap + k*2);
+		x[k]   = XA_NIBBLE(row, 28 - 8*i, rsh) << SH;
+		x[k+1] = XA_NIBBLE(row, 24 - 8*i, rsh) << SH;
+	}
+}
 
-INLINE void ADPCM_DecodeBlock16( ADPCM_Decode_t *decp, uint8_t filter_range, const void *vblockp, short *destp, int inc ) {
-	int i;
-	int range, filterid;
-	int32_t fy0, fy1;
-	const uint16_t *blockp;
-
-	blockp = (const unsigned short *)vblockp;
-	filterid = (filter_range >>  4) & 0x0f;
-	range    = (filter_range >>  0) & 0x0f;
-
-	fy0 = decp->y0;
-	fy1 = decp->y1;
-
-	for (i = BLKSIZ/4; i; --i) {
-		int32_t y;
-		int32_t x0, x1, x2, x3;
-
-		y = *blockp++;
-		x3 = (short)( y        & 0xf000) >> range; x3 <<= SH;
-		x2 = (short)((y <<  4) & 0xf000) >> range; x2 <<= SH;
-		x1 = (short)((y <<  8) & 0xf000) >> range; x1 <<= SH;
-		x0 = (short)((y << 12) & 0xf000) >> range; x0 <<= SH;
-
-		x0 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x0;
-		x1 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x1;
-		x2 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x2;
-		x3 -= (IK0(filterid) * fy0 + (IK1(filterid) * fy1)) >> SHC; fy1 = fy0; fy0 = x3;
-
-		XACLAMP( x0, -32768<<SH, 32767<<SH ); *destp = x0 >> SH; destp += inc;
-		XACLAMP( x1, -32768<<SH, 32767<<SH ); *destp = x1 >> SH; destp += inc;
-		XACLAMP( x2, -32768<<SH, 32767<<SH ); *destp = x2 >> SH; destp += inc;
-		XACLAMP( x3, -32768<<SH, 32767<<SH ); *destp = x3 >> SH; destp += inc;
+INLINE short xa_clamp(int32_t x)
+{
+	x >>= SH;
+	if (x < -32768) x = -32768;
+	else if (x > 32767) x = 32767;
+	return x;
+}
+
+// Run expanded samples of a unit through the prediction filter
+static void xa_filter_unit(ADPCM_Decode_t *decp, int filterid, const int32_t *x,
+                           short *destp)
+{
+	const int k0 = IK0[filterid], k1 = IK1[filterid];
+	int32_t fy0 = decp->y0, fy1 = decp->y1;
+	int k;
+
+	for (k = 0; k < BLKSIZ; k++) {
+		int32_t y = x[k] - ((k0 * fy0 + k1 * fy1) >> SHC);
+		fy1 = fy0; fy0 = y;
+		destp[k] = xa_clamp(y);
 	}
 	decp->y0 = fy0;
 	decp->y1 = fy1;
 }
 
-static int headtable[4] = {0,2,8,10};
+// Stereo: left and right filters are independent, so run them side by
+//  side to give the CPU two dependency chains to overlap
+static void xa_filter_units_stereo(ADPCM_Decode_t *lp, ADPCM_Decode_t *rp,
+                                   int lfilter, int rfilter,
+                                   const int32_t *xl, const int32_t *xr, short *destp)
+{
+	const int lk0 = IK0[lfilter], lk1 = IK1[lfilter];
+	const int rk0 = IK0[rfilter], rk1 = IK1[rfilter];
+	int32_t l0 = lp->y0, l1 = lp->y1;
+	int32_t r0 = rp->y0, r1 = rp->y1;
+	int k;
+
+	for (k = 0; k < BLKSIZ; k++) {
+		int32_t l = xl[k] - ((lk0 * l0 + lk1 * l1) >> SHC);
+		int32_t r = xr[k] - ((rk0 * r0 + rk1 * r1) >> SHC);
+		l1 = l0; l0 = l;
+		r1 = r0; r0 = r;
+		destp[0] = xa_clamp(l);
+		destp[1] = xa_clamp(r);
+		destp += 2;
+	}
+	lp->y0 = l0; lp->y1 = l1;
+	rp->y0 = r0; rp->y1 = r1;
+}
+
+static const uint8_t headtable[4] = {0,2,8,10};
 
 static void xa_decode_data( xa_decode_t *xdp, unsigned char *srcp ) {
-	const uint8_t    *sound_groupsp;
-	const uint8_t    *sound_datap, *sound_datap2;
-	int         i, j, k, nbits;
-	uint16_t			data[4096], *datap;
-	short		*destp;
-
-	destp = xdp->pcm;
-	nbits = xdp->nbits == 4 ? 4 : 2;
-
-	if (xdp->stereo) { // stereo
-		if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
-			for (j=0; j < 18; j++) {
-				sound_groupsp = srcp + j * 128;		// sound groups header
-				sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-				for (i=0; i < nbits; i++) {
-    				datap = data;
-    				sound_datap2 = sound_datap + i;
-
-					for (k=0; k < 14; k++, sound_datap2 += 8) {
-        	   				*(datap++) = (uint16_t)sound_datap2[0] |
-        	               			     (uint16_t)(sound_datap2[4] << 8);
-					}
-
-    				ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-        	           				    destp+0, 2 );
-
-        			datap = data;
-        			sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (uint16_t)sound_datap2[0] |
-            	          			     (uint16_t)(sound_datap2[4] << 8);
-					}
-					ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
-                           			    destp+1, 2 );
-										
-	        		destp += 28*2;
-				}
-    		}
-		} else { // level B/C
-			for (j=0; j < 18; j++) {
-				sound_groupsp = srcp + j * 128;		// sound groups header
-				sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-				for (i=0; i < nbits; i++) {
-	    			datap = data;
-	    			sound_datap2 = sound_datap + i;
-
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (uint16_t)(sound_datap2[ 0] & 0x0f) |
-                       				    ((uint16_t)(sound_datap2[ 4] & 0x0f) <<  4) |
-                       				    ((uint16_t)(sound_datap2[ 8] & 0x0f) <<  8) |
-                       				    ((uint16_t)(sound_datap2[12] & 0x0f) << 12);
-					}
-	    			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                   				    destp+0, 2 );
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (uint16_t)(sound_datap2[ 0] >> 4) |
-                       	    			((uint16_t)(sound_datap2[ 4] >> 4) <<  4) |
-                       				    ((uint16_t)(sound_datap2[ 8] >> 4) <<  8) |
-                       				    ((uint16_t)(sound_datap2[12] >> 4) << 12);
-					}
-					ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
-                           			    destp+1, 2 );
-
-	        		destp += 28*2;
-				}
-	    	}
-		}
-	} else { // mono
-		if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
-			for (j=0; j < 18; j++) {
-    			sound_groupsp = srcp + j * 128;		// sound groups header
-    			sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-    			for (i=0; i < nbits; i++) {
-        			datap = data;
-        			sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (uint16_t)sound_datap2[0] |
-                       				     (uint16_t)(sound_datap2[4] << 8);
-					}
-	        		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                           			    destp, 1 );
-
-	        		destp += 28;
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-           					*(datap++) = (uint16_t)sound_datap2[0] |
-                       				     (uint16_t)(sound_datap2[4] << 8);
-					}
-	       			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
-                           			    destp, 1 );
-
-					destp += 28;
-				}
-	    	}
-		} else { // level B/C
-			for (j=0; j < 18; j++) {
-	    		sound_groupsp = srcp + j * 128;		// sound groups header
-	    		sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-	    		for (i=0; i < nbits; i++) {
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-           					*(datap++) = (uint16_t)(sound_datap2[ 0] & 0x0f) |
-                       				    ((uint16_t)(sound_datap2[ 4] & 0x0f) <<  4) |
-                       				    ((uint16_t)(sound_datap2[ 8] & 0x0f) <<  8) |
-                       				    ((uint16_t)(sound_datap2[12] & 0x0f) << 12);
-					}
-	        		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                           			    destp, 1 );
-
-	        		destp += 28;
-
-	        		datap = data;
-	        		sound_datap2 = sound_datap + i;
-        			for (k=0; k < 7; k++, sound_datap2 += 16) {
-            				*(datap++) = (uint16_t)(sound_datap2[ 0] >> 4) |
-                       	    		    ((uint16_t)(sound_datap2[ 4] >> 4) <<  4) |
-                        				((uint16_t)(sound_datap2[ 8] >> 4) <<  8) |
-                        				((uint16_t)(sound_datap2[12] >> 4) << 12);
-        			}
-	       			ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
-                           			    destp, 1 );
-
-					destp += 28;
-				}
-    		}
+	const int level_a = (xdp->nbits == 8) && (xdp->freq == 37800);
+	const int npairs = xdp->nbits == 4 ? 4 : 2;
+	int32_t x[2][BLKSIZ];
+	short *destp = xdp->pcm;
+	int i, j, n;
+
+	for (j = 0; j < 18; j++) {
+		const uint8_t *sound_groupsp = srcp + j * 128;  // sound groups header
+		const uint8_t *sound_datap = sound_groupsp + 16; // sound data just after the header
+
+		for (i = 0; i < npairs; i++) {
+			// Unit pair i: first is left channel when stereo
+			const uint8_t *fr = sound_groupsp + headtable[i];
+			for (n = 0; n < 2; n++) {
+				if (level_a)
+					xa_expand_unit8(x[n], sound_datap, i, fr[n] & 0x0f);
+				else
+					xa_expand_unit4(x[n], sound_datap, i*2 + n, fr[n] & 0x0f);
+			}
+
+			// Only filters 0..3 exist for XA
+			if (xdp->stereo) {
+				xa_filter_units_stereo(&xdp->left, &xdp->right,
+				                       (fr[0] >> 4) & 3, (fr[1] >> 4) & 3,
+				                       x[0], x[1], destp);
+			} else {
+				xa_filter_unit(&xdp->left, (fr[0] >> 4) & 3, x[0], destp);
+				xa_filter_unit(&xdp->left, (fr[1] >> 4) & 3, x[1], destp + BLKSIZ);
+			}
+			destp += BLKSIZ*2;
 		}
 	}
 }
@@ -80,6 +80,44 @@ void gpuDrawS(PtrUnion packet, const PS gpuSpriteSpanDriver)
 	}
 }
 
+// Fast path for 8x8/16x16 sprites (0x74..0x7F): ones lying wholly inside
+//  the drawing area, with no texture window, texcoords that don't wrap and
+//  no interlace line skipping need none of gpuDrawS()'s clipping or
+//  per-line checks. Returns false if sprite needs gpuDrawS().
+bool gpuDrawSFixed(PtrUnion packet, const PS gpuSpriteSpanDriver, int32_t size)
+{
+	if ((gpu_unai.TextureWindow[2] & gpu_unai.TextureWindow[3]) != 255 ||
+	    gpu_unai.ilace_mask || ProgressiveInterlaceEnabled())
+		return false;
+
+	const int32_t x0 = GPU_EXPANDSIGN(packet.S2[2] + gpu_unai.DrawingOffset[0]);
+	const int32_t y0 = GPU_EXPANDSIGN(packet.S2[3] + gpu_unai.DrawingOffset[1]);
+	uint32_t u0 = packet.U1[8];
+	const uint32_t v0 = packet.U1[9];
+
+	if (x0 < gpu_unai.DrawingArea[0] || x0 + size > gpu_unai.DrawingArea[2] ||
+	    y0 < gpu_unai.DrawingArea[1] || y0 + size > gpu_unai.DrawingArea[3] ||
+	    u0 + size > 256 || v0 + size > 256)
+		return false;
+
+	gpu_unai.r5 = packet.U1[0] >> 3;
+	gpu_unai.g5 = packet.U1[1] >> 3;
+	gpu_unai.b5 = packet.U1[2] >> 3;
+
+	uint16_t *Pixel = &((uint16_t*)gpu_unai.vram)[FRAME_OFFSET(x0, y0)];
+	uint8_t* pTxt = (uint8_t*)gpu_unai.TBA + v0 * 2048;
+
+	// Texture is accessed byte-wise, so adjust idx if 16bpp
+	if ((gpu_unai.TEXT_MODE >> 5) == 3) u0 <<= 1;
+
+	for (int32_t y = size; y; --y) {
+		gpuSpriteSpanDriver(Pixel, size, pTxt, u0);
+		Pixel += FRAME_WIDTH;
+		pTxt += 2048;
+	}
+	return true;
+}
+
 #ifdef __arm__
 #include "gpu_arm.h"
 
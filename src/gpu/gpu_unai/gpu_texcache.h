@@ -0,0 +1,372 @@
+/***************************************************************************
+*   Copyright (C) 2010 PCSX4ALL Team                                      *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+***************************************************************************/
+
+#ifndef GPU_UNAI_TEXCACHE_H
+#define GPU_UNAI_TEXCACHE_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  Decoded CLUT texture cache (gpulib only)
+//
+//  4bpp/8bpp textures are kept expanded to 16bpp, keyed by texture page
+//  address (TBA, which includes texture window offset), CLUT address (CBA)
+//  and texture mode. Slots are 256x256 texels laid out side by side in a
+//  buffer with the same 1024-halfword stride as VRAM, so when a prim's
+//  texture is cached, TBA is pointed at its slot and the prim is drawn
+//  with the ordinary 16bpp inner loops: texels become straight 16-bit loads
+//  instead of nibble extract + CLUT fetch.
+//
+//  Sprites decode only the 16x16 texel tiles they cover, on demand. Poly
+//  texcoords can step slightly outside their vertices' bounding box, so
+//  polys use a slot only once all of it is decoded, which is done after
+//  TEXCACHE_POLY_PROMOTE polys have used it.
+//
+//  Decoding is only a win if the texels get drawn often enough before the
+//  slot is evicted or invalidated, which isn't the case when a game's
+//  working set of pages/CLUTs is larger than the cache. So texels drawn from
+//  cache earn credit, decoding spends it, and nothing new is decoded while
+//  credit is negative: the cache then mostly costs a lookup per prim.
+//  Prims denied decoding slowly give credit back, so it can't lock up.
+//
+//  No slot ever overlaps the drawing area (slots are not used while they
+//  would, and are dropped when it moves onto them), so drawing prims never
+//  needs to invalidate. VRAM writes that aren't clipped to the drawing area
+//  (fills, VRAM copies, CPU->VRAM transfers) call texcache_invalidate().
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef GPU_UNAI_USE_TEXCACHE
+
+#define TEXCACHE_SLOTS          8       // Multiple of 4
+#define TEXCACHE_POLY_PROMOTE   8
+#define TEXCACHE_DECODE_COST    1       // Texels drawn from cache that pay for decoding one
+#define TEXCACHE_CREDIT_REGEN   16      // Credit regained per prim denied decoding
+#define TEXCACHE_CREDIT_MAX     (1 << 20)
+
+struct texcache_slot_t {
+	uint32_t tba_offs;      // Texture page, as halfword offset in VRAM
+	uint32_t cba_offs;      // CLUT, as halfword offset in VRAM
+	uint8_t  tmode;         // 1: 4bpp  2: 8bpp  0: slot unused
+	uint8_t  complete;      // All tiles decoded
+	uint16_t poly_uses;
+	uint32_t last_use;
+	uint32_t tiles[8];      // Decoded 16x16 tiles, 2 rows of 16 tiles per word
+};
+
+static struct {
+	texcache_slot_t slot[TEXCACHE_SLOTS];
+	texcache_slot_t *last;  // Slot of last lookup
+	uint32_t use_count;
+	int32_t  credit;        // Texels drawn from cache minus decoding work
+	uint16_t *saved_TBA;    // TBA/TEXT_MODE to restore after a cached prim
+	uint8_t  saved_TEXT_MODE;
+	uint8_t  bound;
+} texcache;
+
+static uint16_t texcache_buf[TEXCACHE_SLOTS/4 * 256 * 1024] __attribute__((aligned(32)));
+
+static inline uint16_t* texcache_slot_ptr(const texcache_slot_t *s)
+{
+	const int i = s - texcache.slot;
+	return &texcache_buf[(i >> 2) * 256 * 1024 + (i & 3) * 256];
+}
+
+static inline bool texcache_rect_overlap(int ax, int ay, int aw, int ah,
+                                         int bx, int by, int bw, int bh)
+{
+	return ax < bx + bw && bx < ax + aw && ay < by + bh && by < ay + ah;
+}
+
+static bool texcache_slot_overlaps(const texcache_slot_t *s, int x, int y, int w, int h)
+{
+	const int tw = (s->tmode == 1) ? 64 : 128;    // Page width in halfwords
+	const int cw = (s->tmode == 1) ? 16 : 256;    // CLUT width
+	return texcache_rect_overlap(s->tba_offs & 1023, s->tba_offs >> 10, tw, 256, x, y, w, h) ||
+	       texcache_rect_overlap(s->cba_offs & 1023, s->cba_offs >> 10, cw, 1, x, y, w, h);
+}
+
+// Drop all slots whose texture page or CLUT overlaps VRAM rect.
+//  Rects that wrap around VRAM edges are extended to the whole width/height.
+static void texcache_invalidate(int x, int y, int w, int h)
+{
+	if (x < 0 || w > 1024 || x + w > 1024) { x = 0; w = 1024; }
+	if (y < 0 || h > 512  || y + h > 512)  { y = 0; h = 512;  }
+
+	for (int i = 0; i < TEXCACHE_SLOTS; i++) {
+		texcache_slot_t *s = &texcache.slot[i];
+		if (s->tmode && texcache_slot_overlaps(s, x, y, w, h))
+			s->tmode = 0;
+	}
+	texcache.last = NULL;
+}
+
+static void texcache_invalidate_draw_area(void)
+{
+	texcache_invalidate(gpu_unai.DrawingArea[0], gpu_unai.DrawingArea[1],
+	                    gpu_unai.DrawingArea[2] - gpu_unai.DrawingArea[0],
+	                    gpu_unai.DrawingArea[3] - gpu_unai.DrawingArea[1]);
+}
+
+static void texcache_reset(void)
+{
+	memset(&texcache, 0, sizeof(texcache));
+}
+
+// Find or allocate slot for current TBA/CBA/TEXT_MODE, NULL if uncacheable
+static texcache_slot_t* texcache_lookup(void)
+{
+	const uint32_t tmode = gpu_unai.TEXT_MODE >> 5;
+	if (tmode != 1 && tmode != 2)
+		return NULL;
+
+	const uint32_t tba_offs = gpu_unai.TBA - gpu_unai.vram;
+	const uint32_t cba_offs = gpu_unai.CBA - gpu_unai.vram;
+
+	texcache_slot_t *s = texcache.last;
+	if (s && s->tba_offs == tba_offs && s->cba_offs == cba_offs && s->tmode == tmode) {
+		s->last_use = ++texcache.use_count;
+		return s;
+	}
+
+	texcache_slot_t *lru = &texcache.slot[0];
+	for (int i = 0; i < TEXCACHE_SLOTS; i++) {
+		s = &texcache.slot[i];
+		if (s->tmode == tmode && s->tba_offs == tba_offs && s->cba_offs == cba_offs) {
+			s->last_use = ++texcache.use_count;
+			return texcache.last = s;
+		}
+		if (!s->tmode) {
+			if (lru->tmode) lru = s;
+		} else if (lru->tmode && s->last_use < lru->last_use) {
+			lru = s;
+		}
+	}
+
+	// Pages/CLUTs running past VRAM edges are read linearly by the inner
+	//  loops, just don't cache them. Same for ones prims could draw over.
+	texcache_slot_t key;
+	key.tba_offs = tba_offs;
+	key.cba_offs = cba_offs;
+	key.tmode = tmode;
+	const int tx = tba_offs & 1023, ty = tba_offs >> 10;
+	const int cx = cba_offs & 1023;
+	if (tx + ((tmode == 1) ? 64 : 128) > 1024 || ty + 256 > 512 ||
+	    cx + ((tmode == 1) ? 16 : 256) > 1024 ||
+	    texcache_slot_overlaps(&key, gpu_unai.DrawingArea[0], gpu_unai.DrawingArea[1],
+	                           gpu_unai.DrawingArea[2] - gpu_unai.DrawingArea[0],
+	                           gpu_unai.DrawingArea[3] - gpu_unai.DrawingArea[1]))
+		return NULL;
+
+	s = lru;
+	s->tba_offs = tba_offs;
+	s->cba_offs = cba_offs;
+	s->tmode = tmode;
+	s->complete = 0;
+	s->poly_uses = 0;
+	s->last_use = ++texcache.use_count;
+	memset(s->tiles, 0, sizeof(s->tiles));
+	return texcache.last = s;
+}
+
+static void texcache_decode_tile(const texcache_slot_t *s, int tile_x, int tile_y)
+{
+	const uint8_t  *src = (const uint8_t*)(gpu_unai.vram + s->tba_offs) + tile_y * 16 * 2048;
+	const uint16_t *clut = gpu_unai.vram + s->cba_offs;
+	uint16_t *dst = texcache_slot_ptr(s) + tile_y * 16 * 1024 + tile_x * 16;
+
+	if (s->tmode == 1) {
+		src += tile_x * 8;
+		for (int v = 0; v < 16; v++, src += 2048, dst += 1024) {
+			for (int u = 0; u < 8; u++) {
+				dst[u*2+0] = clut[src[u] & 0xf];
+				dst[u*2+1] = clut[src[u] >> 4];
+			}
+		}
+	} else {
+		src += tile_x * 16;
+		for (int v = 0; v < 16; v++, src += 2048, dst += 1024) {
+			for (int u = 0; u < 16; u++)
+				dst[u] = clut[src[u]];
+		}
+	}
+}
+
+// Count 16x16 tiles of texels u0..u1, v0..v1 (inclusive) of slot that
+//  aren't decoded yet, decoding them too if 'decode' is set
+static int texcache_decode(texcache_slot_t *s, int u0, int u1, int v0, int v1, bool decode)
+{
+	const uint32_t need = (0xffff >> (15 - (u1 >> 4))) & (0xffff << (u0 >> 4));
+	int count = 0;
+
+	for (int ty = v0 >> 4; ty <= (v1 >> 4); ty++) {
+		const int shift = (ty & 1) * 16;
+		uint32_t missing = need & ~(s->tiles[ty >> 1] >> shift);
+		if (!missing)
+			continue;
+		if (decode)
+			s->tiles[ty >> 1] |= missing << shift;
+		for (int tx = 0; missing; tx++, missing >>= 1) {
+			if (missing & 1) {
+				count++;
+				if (decode)
+					texcache_decode_tile(s, tx, ty);
+			}
+		}
+	}
+	return count;
+}
+
+// Decode tiles if the cache has earned it, returns false if it hasn't
+static bool texcache_spend(texcache_slot_t *s, int u0, int u1, int v0, int v1)
+{
+	const int tiles = texcache_decode(s, u0, u1, v0, v1, false);
+	if (tiles) {
+		if (texcache.credit < 0) {
+			// Regain credit slowly, or cache could stay locked out for good
+			texcache.credit += TEXCACHE_CREDIT_REGEN;
+			return false;
+		}
+		texcache_decode(s, u0, u1, v0, v1, true);
+		texcache.credit -= tiles * 256 * TEXCACHE_DECODE_COST;
+	}
+	return true;
+}
+
+static inline void texcache_credit(int texels)
+{
+	texcache.credit += texels;
+	if (texcache.credit > TEXCACHE_CREDIT_MAX)
+		texcache.credit = TEXCACHE_CREDIT_MAX;
+}
+
+static void texcache_bind(texcache_slot_t *s, int texels)
+{
+	texcache_credit(texels);
+
+	texcache.saved_TBA = gpu_unai.TBA;
+	texcache.saved_TEXT_MODE = gpu_unai.TEXT_MODE;
+	texcache.bound = 1;
+	gpu_unai.TBA = texcache_slot_ptr(s);
+	gpu_unai.TEXT_MODE = 3 << 5;
+}
+
+// Decode the tiles of slot a sprite covers, returns # of texels it draws,
+//  or -1 if the cache hasn't earned decoding them
+static int texcache_sprite_tiles(texcache_slot_t *s, PtrUnion packet)
+{
+	const int w = packet.U2[6] & 0x3ff, h = packet.U2[7] & 0x1ff;
+	if (!w || !h)
+		return 0;
+
+	int u0 = packet.U1[8], u1 = u0 + w - 1;
+	int v0 = packet.U1[9], v1 = v0 + h - 1;
+
+	// Texcoords wrap within texture window, need all of it then
+	if (gpu_unai.TextureWindow[2] != 255 || u1 > 255) { u0 = 0; u1 = gpu_unai.TextureWindow[2]; }
+	if (gpu_unai.TextureWindow[3] != 255 || v1 > 255) { v0 = 0; v1 = gpu_unai.TextureWindow[3]; }
+
+	if (!s->complete && !texcache_spend(s, u0, u1, v0, v1))
+		return -1;
+	return w * h;
+}
+
+// Call after gpuSetCLUT() and, for 0x64 sprites, before drawing. Sprite
+//  size in packet must be set.
+static void texcache_bind_sprite(PtrUnion packet)
+{
+	if (!(packet.U2[6] & 0x3ff) || !(packet.U2[7] & 0x1ff))
+		return;
+
+	texcache_slot_t *s = texcache_lookup();
+	if (!s)
+		return;
+
+	const int texels = texcache_sprite_tiles(s, packet);
+	if (texels >= 0)
+		texcache_bind(s, texels);
+}
+
+// For further sprites of a run drawn with the binding (and so TBA/CBA/
+//  TEXT_MODE) of the first: returns false if sprite in packet can't be
+//  drawn from the slot bound, and needs texcache_bind_sprite() of its own
+static bool texcache_extend_sprite(PtrUnion packet)
+{
+	if (!texcache.bound)
+		return true;
+
+	const int texels = texcache_sprite_tiles(texcache.last, packet);
+	if (texels < 0)
+		return false;
+	texcache_credit(texels);
+	return true;
+}
+
+// Call after gpuSetCLUT() and gpuSetTexture() of textured polys, with
+//  vertex count and # of words per vertex in packet
+static void texcache_bind_poly(PtrUnion packet, int num_verts, int stride)
+{
+	texcache_slot_t *s = texcache_lookup();
+	if (!s)
+		return;
+
+	if (!s->complete) {
+		if (s->poly_uses < TEXCACHE_POLY_PROMOTE) {
+			s->poly_uses++;
+			return;
+		}
+		if (!texcache_spend(s, 0, 255, 0, 255))
+			return;
+		s->complete = 1;
+	}
+
+	// Credit bounding box area (half of it for triangles) as texels drawn
+	int xmin, xmax, ymin, ymax;
+	xmin = xmax = GPU_EXPANDSIGN(packet.S2[2]);
+	ymin = ymax = GPU_EXPANDSIGN(packet.S2[3]);
+	for (int i = 1; i < num_verts; i++) {
+		const int x = GPU_EXPANDSIGN(packet.S2[2 + i * stride * 2]);
+		const int y = GPU_EXPANDSIGN(packet.S2[3 + i * stride * 2]);
+		if (x < xmin) xmin = x; else if (x > xmax) xmax = x;
+		if (y < ymin) ymin = y; else if (y > ymax) ymax = y;
+	}
+	const int w = xmax - xmin, h = ymax - ymin;
+	texcache_bind(s, (w < 1024 && h < 512) ? (w * h) >> (num_verts == 3) : 0);
+}
+
+// Restore TBA/TEXT_MODE after drawing a prim
+static inline void texcache_unbind(void)
+{
+	if (texcache.bound) {
+		gpu_unai.TBA = texcache.saved_TBA;
+		gpu_unai.TEXT_MODE = texcache.saved_TEXT_MODE;
+		texcache.bound = 0;
+	}
+}
+
+#else
+
+static inline void texcache_invalidate(int x, int y, int w, int h) {}
+static inline void texcache_invalidate_draw_area(void) {}
+static inline void texcache_reset(void) {}
+static inline void texcache_bind_sprite(PtrUnion packet) {}
+static inline void texcache_bind_poly(PtrUnion packet, int num_verts, int stride) {}
+static inline bool texcache_extend_sprite(PtrUnion packet) { return true; }
+static inline void texcache_unbind(void) {}
+
+#endif // GPU_UNAI_USE_TEXCACHE
+
+#endif // GPU_UNAI_TEXCACHE_H
@@ -43,6 +43,11 @@
 //#define GPU_UNAI_USE_INT_DIV_MULTINV   // If GPU_UNAI_USE_FLOATMATH is *not*
                                          //  defined, use old inaccurate division
 
+#define GPU_UNAI_USE_TEXCACHE            // Cache 4bpp/8bpp CLUT textures decoded
+                                         //  to 16bpp (gpulib only, see gpu_texcache.h)
+//#define GPU_UNAI_USE_PRIM_STATS        // Count primitives drawn and rejected early,
+                                         //  printed at shutdown (gpulib only)
+
 
 #define uint8_t  uint8_t
 #define int8_t  int8_t
@@ -51,11 +51,27 @@
 // GPU command buffer execution/store
 #include "gpu_command.h"
 
+// Decoded CLUT texture cache
+#include "gpu_texcache.h"
+
 /////////////////////////////////////////////////////////////////////////////
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#ifdef GPU_UNAI_USE_PRIM_STATS
+static struct {
+  uint32_t drawn;        // Primitives passed to the rasterizer
+  uint32_t culled_clip;  // Outside drawing area, or zero-area
+  uint32_t culled_size;  // Larger than hardware limits (never drawn)
+  uint32_t culled_ilace; // Touch only lines interlace skipping suppresses
+  uint32_t culled_blit;  // Touch only columns blit_mask suppresses
+} prim_stats;
+#define PRIM_STAT(x) (prim_stats.x++)
+#else
+#define PRIM_STAT(x)
+#endif
+
 int renderer_init(void)
 {
   memset((void*)&gpu_unai, 0, sizeof(gpu_unai));
@@ -98,12 +114,18 @@ int renderer_init(void)
 
   SetupLightLUT();
   SetupDitheringConstants();
+  texcache_reset();
 
   return 0;
 }
 
 void renderer_finish(void)
 {
+#ifdef GPU_UNAI_USE_PRIM_STATS
+  printf("gpu_unai: %u prims drawn, culled: %u clipped, %u too large, "
+         "%u interlace, %u blit_mask\n", prim_stats.drawn, prim_stats.culled_clip,
+         prim_stats.culled_size, prim_stats.culled_ilace, prim_stats.culled_blit);
+#endif
 }
 
 void renderer_notify_res_change(void)
@@ -193,12 +215,14 @@ static void gpuGP0Cmd_0xEx(gpu_unai_t &gpu_unai, uint32_t cmd_word)
       // GP0(E3h) - Set Drawing Area top left (X1,Y1)
       gpu_unai.DrawingArea[0] = cmd_word         & 0x3FF;
       gpu_unai.DrawingArea[1] = (cmd_word >> 10) & 0x3FF;
+      texcache_invalidate_draw_area();
     } break;
 
     case 4: {
       // GP0(E4h) - Set Drawing Area bottom right (X2,Y2)
       gpu_unai.DrawingArea[2] = (cmd_word         & 0x3FF) + 1;
       gpu_unai.DrawingArea[3] = ((cmd_word >> 10) & 0x3FF) + 1;
+      texcache_invalidate_draw_area();
     } break;
 
     case 5: {
@@ -217,6 +241,204 @@ static void gpuGP0Cmd_0xEx(gpu_unai_t &gpu_unai, uint32_t cmd_word)
 
 extern const unsigned char cmd_lengths[256];
 
+// Early rejection pre-pass for a drawing primitive (GP0 0x20..0x7F).
+//  Computes the bounding box of its vertices, clipped to the drawing area,
+//  and returns false if the rasterizer would draw nothing, before any setup
+//  is done. The rules follow the rasterizers' own: polyUseTriangle() for
+//  polys, gpuDrawLineF/G() for lines, gpuDrawT/S() for rectangles.
+//
+// For primitives that will be drawn, marks the VRAM rows they can touch,
+//  for the dirty-line tracking vout_update() uses to skip unchanged rows,
+//  and adds an estimate of the pixels drawn to the frame's raster work,
+//  for the auto frameskip cost prediction.
+static bool prim_visible(const uint32_t *list, uint32_t cmd)
+{
+  int x0, x1, y0, y1;   // Bounding box, exclusive of x1,y1
+  int shift = 0;
+  bool is_line = false;
+
+  if (cmd < 0x40) {
+    // Polygon: vertex words are followed by optional texcoord word and
+    //  preceded by color word if Gouraud-shaded
+    const int stride = 1 + ((cmd >> 2) & 1) + ((cmd >> 4) & 1);
+    const int num_verts = (cmd & 8) ? 4 : 3;
+    int x[4], y[4];
+    for (int i = 0; i < num_verts; i++) {
+      x[i] = GPU_EXPANDSIGN(list[1 + i * stride]) + gpu_unai.DrawingOffset[0];
+      y[i] = GPU_EXPANDSIGN(list[1 + i * stride] >> 16) + gpu_unai.DrawingOffset[1];
+    }
+
+    // Vertices 1,2 are shared by both triangles of a quad
+    int sx0 = Min2(x[1], x[2]), sx1 = Max2(x[1], x[2]);
+    int sy0 = Min2(y[1], y[2]), sy1 = Max2(y[1], y[2]);
+    x0 = Min2(sx0, x[0]);  x1 = Max2(sx1, x[0]);
+    y0 = Min2(sy0, y[0]);  y1 = Max2(sy1, y[0]);
+
+    // Triangles spanning more than hardware limits are never drawn
+    bool too_large = (x1 - x0) >= CHKMAX_X || (y1 - y0) >= CHKMAX_Y;
+    if (num_verts == 4) {
+      sx0 = Min2(sx0, x[3]);  sx1 = Max2(sx1, x[3]);
+      sy0 = Min2(sy0, y[3]);  sy1 = Max2(sy1, y[3]);
+      too_large = too_large && ((sx1 - sx0) >= CHKMAX_X || (sy1 - sy0) >= CHKMAX_Y);
+      x0 = Min2(x0, sx0);  x1 = Max2(x1, sx1);
+      y0 = Min2(y0, sy0);  y1 = Max2(y1, sy1);
+    } else {
+      shift = 1;  // Triangle covers about half its bounding box
+    }
+
+    if (too_large) {
+      PRIM_STAT(culled_size);
+      return false;
+    }
+  } else if (cmd < 0x60) {
+    is_line = true;
+    if (cmd & 8) {
+      // Line strip: length isn't known yet, so it's never rejected here.
+      //  Assume it can touch the whole drawing area.
+      const int w = gpu_unai.DrawingArea[2] - gpu_unai.DrawingArea[0];
+      const int h = gpu_unai.DrawingArea[3] - gpu_unai.DrawingArea[1];
+      if (w > 0 && h > 0) {
+        gpulib_mark_dirty(gpu_unai.DrawingArea[1], h);
+        gpulib_add_raster_work(w > h ? w : h);
+      }
+      PRIM_STAT(drawn);
+      return true;
+    } else {
+      const int stride = 1 + ((cmd >> 4) & 1);
+      x0 = GPU_EXPANDSIGN(list[1]);
+      x1 = GPU_EXPANDSIGN(list[1 + stride]);
+      y0 = GPU_EXPANDSIGN(list[1] >> 16);
+      y1 = GPU_EXPANDSIGN(list[1 + stride] >> 16);
+      if (x0 > x1) {
+        int tmp = x0; x0 = x1; x1 = tmp;
+      }
+      if (y0 > y1) {
+        int tmp = y0; y0 = y1; y1 = tmp;
+      }
+      if ((x1 - x0) >= CHKMAX_X || (y1 - y0) >= CHKMAX_Y) {
+        PRIM_STAT(culled_size);
+        return false;
+      }
+      // Lines include both endpoints
+      x0 += gpu_unai.DrawingOffset[0];
+      x1 += gpu_unai.DrawingOffset[0] + 1;
+      y0 += gpu_unai.DrawingOffset[1];
+      y1 += gpu_unai.DrawingOffset[1] + 1;
+    }
+  } else {
+    // Rectangle: size is variable or 1x1, 8x8, 16x16
+    static const uint8_t sizes[4] = { 0, 1, 8, 16 };
+    int w = sizes[(cmd >> 3) & 3], h = w;
+    if (w == 0) {
+      w = list[2 + ((cmd >> 2) & 1)] & 0x3ff;
+      h = (list[2 + ((cmd >> 2) & 1)] >> 16) & 0x1ff;
+    }
+    x0 = GPU_EXPANDSIGN(list[1] + gpu_unai.DrawingOffset[0]);
+    y0 = GPU_EXPANDSIGN((list[1] >> 16) + gpu_unai.DrawingOffset[1]);
+    x1 = x0 + w;
+    y1 = y0 + h;
+  }
+
+  x0 = Max2(x0, (int)gpu_unai.DrawingArea[0]);
+  x1 = Min2(x1, (int)gpu_unai.DrawingArea[2]);
+  y0 = Max2(y0, (int)gpu_unai.DrawingArea[1]);
+  y1 = Min2(y1, (int)gpu_unai.DrawingArea[3]);
+  if (x0 >= x1 || y0 >= y1) {
+    PRIM_STAT(culled_clip);
+    return false;
+  }
+
+  const int w = x1 - x0, h = y1 - y0;
+
+  if (!is_line) {
+    // Interlace skipping: polys and rectangles only draw lines for which
+    //  this holds, so a short primitive may touch none of them
+    const int li = gpu_unai.ilace_mask;
+    const int pi = ProgressiveInterlaceEnabled() ? (li + 1) : 0;
+    const int pif = ProgressiveInterlaceEnabled() ? (gpu_unai.prog_ilace_flag ? (li + 1) : 0) : 1;
+    if ((li | pi) && h <= 3) {
+      int y = y0;
+      while (y < y1 && ((y & li) || (y & pi) == pif))
+        y++;
+      if (y == y1) {
+        PRIM_STAT(culled_ilace);
+        return false;
+      }
+    }
+
+    // Pixel skipping: textured polys skip columns set in blit_mask,
+    //  indexed by VRAM address, so a narrow one may touch none of them
+    if (cmd < 0x40 && (cmd & 4) && gpu_unai.blit_mask && w < 8) {
+      const uint32_t phase = ((uintptr_t)gpu_unai.vram >> 1) + x0;
+      uint32_t cols = ((1 << w) - 1) << (phase & 7);
+      cols = (cols | (cols >> 8)) & 0xff;
+      if ((cols & ~gpu_unai.blit_mask) == 0) {
+        PRIM_STAT(culled_blit);
+        return false;
+      }
+    }
+  }
+
+  PRIM_STAT(drawn);
+  gpulib_mark_dirty(y0, h);
+  if (is_line)
+    gpulib_add_raster_work(w > h ? w : h);
+  else
+    gpulib_add_raster_work((w * h) >> shift);
+  return true;
+}
+
+// Many 2D games send long runs of sprites or tiles with identical state.
+//  The helpers below draw the rectangle in packet, then those that directly
+//  follow it in the list with the same command word (so also same color,
+//  blend and lighting mode) and, for sprites, CLUT: these skip command
+//  decode, CLUT and texture lookup and span driver selection. 'size' is 8
+//  or 16 for fixed-size rectangles, 0 for variable size. Return the number
+//  of list words used after the first rectangle's.
+
+static uint32_t draw_tile_run(PtrUnion packet, const PT driver, const uint32_t *list,
+                              const uint32_t *list_end, uint32_t len, int size)
+{
+  uint32_t words = 0;
+  gpuDrawT(packet, driver);
+
+  for (const uint32_t *next = list + 1 + len; next + 1 + len <= list_end; next += 1 + len) {
+    if (next[0] != list[0])
+      break;
+    words += 1 + len;
+    if (!prim_visible(next, list[0] >> 24))
+      continue;
+    packet.U4[1] = next[1];
+    if (!size) packet.U4[2] = next[2];
+    gpuDrawT(packet, driver);
+  }
+  return words;
+}
+
+static uint32_t draw_sprite_run(PtrUnion packet, const PS driver, const uint32_t *list,
+                                const uint32_t *list_end, uint32_t len, int size)
+{
+  uint32_t words = 0;
+  if (!size || !gpuDrawSFixed(packet, driver, size))
+    gpuDrawS(packet, driver);
+
+  for (const uint32_t *next = list + 1 + len; next + 1 + len <= list_end; next += 1 + len) {
+    if (next[0] != list[0] || (next[2] >> 16) != (list[2] >> 16))
+      break;
+    packet.U4[1] = next[1];
+    packet.U4[2] = next[2];
+    if (!size) packet.U4[3] = next[3];
+    if (!texcache_extend_sprite(packet))
+      break;
+    words += 1 + len;
+    if (!prim_visible(next, list[0] >> 24))
+      continue;
+    if (!size || !gpuDrawSFixed(packet, driver, size))
+      gpuDrawS(packet, driver);
+  }
+  return words;
+}
+
 int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
 {
   unsigned int cmd = 0, len, i;
@@ -247,11 +469,23 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
 
     PtrUnion packet = { .ptr = (void*)&gpu_unai.PacketBuffer };
 
+    if (cmd >= 0x20 && cmd <= 0x7f && !prim_visible(list, cmd)) {
+      // Textured polys still set the texture page for what follows
+      if ((cmd & 0xe4) == 0x24)
+        gpuSetTexture(list[2 + 2 + ((cmd >> 4) & 1)] >> 16);
+      continue;
+    }
+
     switch (cmd)
     {
-      case 0x02:
+      case 0x02: {
+        int y = (int16_t)(list[1] >> 16), h = (list[2] >> 16) & 0x3ff;
+        if (y < 0) { h += y; y = 0; }
+        gpulib_mark_dirty(y, h);
+        texcache_invalidate((int16_t)list[1] & ~0xf, y, ((list[2] & 0x3ff) + 0x1f) & ~0xf, h);
+        gpulib_add_raster_work((list[2] & 0x3ff) * (h > 0 ? h : 0));
         gpuClearImage(packet);
-        break;
+      } break;
 
       case 0x20:
       case 0x21:
@@ -271,6 +505,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x27: {          // Textured 3-pt poly
         gpuSetCLUT   (gpu_unai.PacketBuffer.U4[2] >> 16);
         gpuSetTexture(gpu_unai.PacketBuffer.U4[4] >> 16);
+        texcache_bind_poly(packet, 3, 2);
 
         uint32_t driver_idx =
           (gpu_unai.blit_mask?1024:0) |
@@ -287,6 +522,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
 
         PP driver = gpuPolySpanDrivers[driver_idx];
         gpuDrawPolyFT(packet, driver, false);
+        texcache_unbind();
       } break;
 
       case 0x28:
@@ -307,6 +543,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x2F: {          // Textured 4-pt poly
         gpuSetCLUT   (gpu_unai.PacketBuffer.U4[2] >> 16);
         gpuSetTexture(gpu_unai.PacketBuffer.U4[4] >> 16);
+        texcache_bind_poly(packet, 4, 2);
 
         uint32_t driver_idx =
           (gpu_unai.blit_mask?1024:0) |
@@ -323,6 +560,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
 
         PP driver = gpuPolySpanDrivers[driver_idx];
         gpuDrawPolyFT(packet, driver, true); // is_quad = true
+        texcache_unbind();
       } break;
 
       case 0x30:
@@ -348,6 +586,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x37: {          // Gouraud-shaded, textured 3-pt poly
         gpuSetCLUT    (gpu_unai.PacketBuffer.U4[2] >> 16);
         gpuSetTexture (gpu_unai.PacketBuffer.U4[5] >> 16);
+        texcache_bind_poly(packet, 3, 3);
         PP driver = gpuPolySpanDrivers[
           (gpu_unai.blit_mask?1024:0) |
           Dithering |
@@ -355,6 +594,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
           gpu_unai.Masking | Blending | ((Lighting)?129:0) | gpu_unai.PixelMSB
         ];
         gpuDrawPolyGT(packet, driver, false);
+        texcache_unbind();
       } break;
 
       case 0x38:
@@ -377,6 +617,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x3F: {          // Gouraud-shaded, textured 4-pt poly
         gpuSetCLUT    (gpu_unai.PacketBuffer.U4[2] >> 16);
         gpuSetTexture (gpu_unai.PacketBuffer.U4[5] >> 16);
+        texcache_bind_poly(packet, 4, 3);
         PP driver = gpuPolySpanDrivers[
           (gpu_unai.blit_mask?1024:0) |
           Dithering |
@@ -384,6 +625,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
           gpu_unai.Masking | Blending | ((Lighting)?129:0) | gpu_unai.PixelMSB
         ];
         gpuDrawPolyGT(packet, driver, true); // is_quad = true
+        texcache_unbind();
       } break;
 
       case 0x40:
@@ -471,7 +713,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x62:
       case 0x63: {          // Monochrome rectangle (variable size)
         PT driver = gpuTileSpanDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
-        gpuDrawT(packet, driver);
+        len += draw_tile_run(packet, driver, list, list_end, len, 0);
       } break;
 
       case 0x64:
@@ -479,6 +721,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x66:
       case 0x67: {          // Textured rectangle (variable size)
         gpuSetCLUT    (gpu_unai.PacketBuffer.U4[2] >> 16);
+        texcache_bind_sprite(packet);
         uint32_t driver_idx = Blending_Mode | gpu_unai.TEXT_MODE | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>1);
 
         //senquack - Only color 808080h-878787h allows skipping lighting calculation:
@@ -498,7 +741,8 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
         if ((gpu_unai.PacketBuffer.U4[0] & 0xF8F8F8) != 0x808080)
           driver_idx |= Lighting;
         PS driver = gpuSpriteSpanDrivers[driver_idx];
-        gpuDrawS(packet, driver);
+        len += draw_sprite_run(packet, driver, list, list_end, len, 0);
+        texcache_unbind();
       } break;
 
       case 0x68:
@@ -507,7 +751,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x6B: {          // Monochrome rectangle (1x1 dot)
         gpu_unai.PacketBuffer.U4[2] = 0x00010001;
         PT driver = gpuTileSpanDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
-        gpuDrawT(packet, driver);
+        len += draw_tile_run(packet, driver, list, list_end, len, 1);
       } break;
 
       case 0x70:
@@ -516,7 +760,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x73: {          // Monochrome rectangle (8x8)
         gpu_unai.PacketBuffer.U4[2] = 0x00080008;
         PT driver = gpuTileSpanDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
-        gpuDrawT(packet, driver);
+        len += draw_tile_run(packet, driver, list, list_end, len, 8);
       } break;
 
       case 0x74:
@@ -525,6 +769,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x77: {          // Textured rectangle (8x8)
         gpu_unai.PacketBuffer.U4[3] = 0x00080008;
         gpuSetCLUT    (gpu_unai.PacketBuffer.U4[2] >> 16);
+        texcache_bind_sprite(packet);
         uint32_t driver_idx = Blending_Mode | gpu_unai.TEXT_MODE | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>1);
 
         //senquack - Only color 808080h-878787h allows skipping lighting calculation:
@@ -533,7 +778,8 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
         if ((gpu_unai.PacketBuffer.U4[0] & 0xF8F8F8) != 0x808080)
           driver_idx |= Lighting;
         PS driver = gpuSpriteSpanDrivers[driver_idx];
-        gpuDrawS(packet, driver);
+        len += draw_sprite_run(packet, driver, list, list_end, len, 8);
+        texcache_unbind();
       } break;
 
       case 0x78:
@@ -542,7 +788,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x7B: {          // Monochrome rectangle (16x16)
         gpu_unai.PacketBuffer.U4[2] = 0x00100010;
         PT driver = gpuTileSpanDrivers[(Blending_Mode | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>3)) >> 1];
-        gpuDrawT(packet, driver);
+        len += draw_tile_run(packet, driver, list, list_end, len, 16);
       } break;
 
       case 0x7C:
@@ -560,6 +806,7 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
       case 0x7F: {          // Textured rectangle (16x16)
         gpu_unai.PacketBuffer.U4[3] = 0x00100010;
         gpuSetCLUT    (gpu_unai.PacketBuffer.U4[2] >> 16);
+        texcache_bind_sprite(packet);
         uint32_t driver_idx = Blending_Mode | gpu_unai.TEXT_MODE | gpu_unai.Masking | Blending | (gpu_unai.PixelMSB>>1);
         //senquack - Only color 808080h-878787h allows skipping lighting calculation:
         //if ((gpu_unai.PacketBuffer.U1[0]>0x5F) && (gpu_unai.PacketBuffer.U1[1]>0x5F) && (gpu_unai.PacketBuffer.U1[2]>0x5F))
@@ -567,10 +814,14 @@ int do_cmd_list(unsigned int *list, int list_len, int *last_cmd)
         if ((gpu_unai.PacketBuffer.U4[0] & 0xF8F8F8) != 0x808080)
           driver_idx |= Lighting;
         PS driver = gpuSpriteSpanDrivers[driver_idx];
-        gpuDrawS(packet, driver);
+        len += draw_sprite_run(packet, driver, list, list_end, len, 16);
+        texcache_unbind();
       } break;
 
       case 0x80:          //  vid -> vid
+        gpulib_mark_dirty((list[2] >> 16) & 511, list[3] >> 16);
+        texcache_invalidate(list[2] & 1023, (list[2] >> 16) & 511, list[3] & 0xffff, list[3] >> 16);
+        gpulib_add_raster_work((list[3] & 0xffff) * (list[3] >> 16));
         gpuMoveImage(packet);
         break;
 
@@ -614,6 +865,7 @@ void renderer_sync_ecmds(uint32_t *ecmds)
 
 void renderer_update_caches(int x, int y, int w, int h)
 {
+  texcache_invalidate(x, y, w, h);
 }
 
 void renderer_flush_queues(void)
@@ -628,6 +880,7 @@ void renderer_set_interlace(int enable, int is_odd)
 void renderer_set_config(const struct gpulib_config_t *config)
 {
   gpu_unai.vram = (uint16_t*)gpu.vram;
+  texcache_invalidate(0, 0, 1024, 512);
 }
 
 
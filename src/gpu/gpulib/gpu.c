@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include "plugins.h"    // For GPUFreeze_t, GPUScreenInfo_t
 #include "gpu.h"
+#include "gpu_trace.h"
 #include "plugin_lib.h"
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
@@ -226,7 +227,9 @@ static noinline void decide_frameskip(void)
     gpu.frameskip.frame_ready = 1;
   }
 
-  if (!gpu.frameskip.active && pl_frameskip_advice())
+  if (pl_data.fast_forward)
+    gpu.frameskip.active = !pl_fast_forward_draw();
+  else if (!gpu.frameskip.active && pl_frameskip_advice())
     gpu.frameskip.active = 1;
   else if (gpu.frameskip.set > 0 && gpu.frameskip.cnt < gpu.frameskip.set)
     gpu.frameskip.active = 1;
@@ -367,6 +370,9 @@ void GPU_writeStatus(uint32_t data)
   static const short vres[4] = { 240, 480, 256, 480 };
   uint32_t cmd = data >> 24;
 
+  if (unlikely(gpu_trace_file != NULL))
+    gpu_trace_gp1(data);
+
   if (cmd < ARRAY_SIZE(gpu.regs)) {
     if (cmd > 1 && cmd != 5 && gpu.regs[cmd] == data)
       return;
@@ -439,8 +445,33 @@ static inline void do_vram_line(int x, int y, uint16_t *mem, int l, int is_read)
   uint16_t *vram = VRAM_MEM_XY(x, y);
   if (is_read)
     memcpy(mem, vram, l * 2);
-  else
+  else {
     memcpy(vram, mem, l * 2);
+    gpulib_mark_dirty(y, 1);
+  }
+}
+
+/* Write whole rows of an upload. MDEC output is uploaded as columns of
+ * macroblocks, 16 (15bpp) or 24 (24bpp) halfwords wide, so give those
+ * fixed-size copies the compiler can inline as a few wide loads/stores,
+ * and mark the rows dirty in one go instead of per row. */
+static void do_vram_write_rows(int x, int y, uint16_t *mem, int w, int rows)
+{
+  gpulib_mark_dirty(y, rows);
+  switch (w) {
+    case 16:
+      for (; rows > 0; rows--, mem += 16, y = (y + 1) & 511)
+        memcpy(VRAM_MEM_XY(x, y), mem, 16 * 2);
+      break;
+    case 24:
+      for (; rows > 0; rows--, mem += 24, y = (y + 1) & 511)
+        memcpy(VRAM_MEM_XY(x, y), mem, 24 * 2);
+      break;
+    default:
+      for (; rows > 0; rows--, mem += w, y = (y + 1) & 511)
+        memcpy(VRAM_MEM_XY(x, y), mem, w * 2);
+      break;
+  }
 }
 
 static int do_vram_io(uint32_t *data, int count, int is_read)
@@ -471,6 +502,20 @@ static int do_vram_io(uint32_t *data, int count, int is_read)
     count -= l;
   }
 
+  if (!is_read) {
+    int rows = count / w;
+    if (rows > h)
+      rows = h;
+    if (rows > 0) {
+      y &= 511;
+      do_vram_write_rows(x, y, sdata, w, rows);
+      sdata += rows * w;
+      count -= rows * w;
+      y += rows;
+      h -= rows;
+    }
+  }
+
   for (; h > 0 && count >= w; sdata += w, count -= w, y++, h--) {
     y &= 511;
     do_vram_line(x, y, sdata, w, is_read);
@@ -595,6 +640,9 @@ void GPU_writeDataMem(uint32_t *mem, int count)
 
   log_io("gpu_dma_write %p %d\n", mem, count);
 
+  if (unlikely(gpu_trace_file != NULL))
+    gpu_trace_words(GPU_TRACE_GP0_MEM, mem, count);
+
   if (unlikely(gpu.cmd_len > 0))
     flush_cmd_buffer();
 
@@ -606,6 +654,9 @@ void GPU_writeDataMem(uint32_t *mem, int count)
 void GPU_writeData(uint32_t data)
 {
   log_io("gpu_write %08x\n", data);
+
+  if (unlikely(gpu_trace_file != NULL))
+    gpu_trace_gp0(data);
   gpu.cmd_buffer[gpu.cmd_len++] = data;
   if (gpu.cmd_len >= CMD_BUFFER_LEN)
     flush_cmd_buffer();
@@ -637,6 +688,9 @@ long GPU_dmaChain(uint32_t *rambase, uint32_t start_addr)
 
     log_io(".chain %08x #%d\n", (list - rambase) * 4, len);
 
+    if (unlikely(gpu_trace_file != NULL))
+      gpu_trace_words(GPU_TRACE_DMA_NODE, list + 1, len);
+
     if (len) {
       left = do_cmd_buffer(list + 1, len);
       if (left)
@@ -668,6 +722,9 @@ long GPU_dmaChain(uint32_t *rambase, uint32_t start_addr)
     }
   }
 
+  if (unlikely(gpu_trace_file != NULL))
+    gpu_trace_dma_end();
+
   gpu.state.last_list.frame = *gpu.state.frame_count;
   gpu.state.last_list.hcnt = *gpu.state.hcnt;
   gpu.state.last_list.cycles = cpu_cycles;
@@ -680,6 +737,9 @@ void GPU_readDataMem(uint32_t *mem, int count)
 {
   log_io("gpu_dma_read  %p %d\n", mem, count);
 
+  if (unlikely(gpu_trace_file != NULL))
+    gpu_trace_read(count);
+
   if (unlikely(gpu.cmd_len > 0))
     flush_cmd_buffer();
 
@@ -694,6 +754,9 @@ uint32_t GPU_readData(void)
   if (unlikely(gpu.cmd_len > 0))
     flush_cmd_buffer();
 
+  if (unlikely(gpu_trace_file != NULL))
+    gpu_trace_read(1);
+
   ret = gpu.gp0;
   if (gpu.dma.h)
     do_vram_io(&ret, 1, 1);
@@ -716,6 +779,7 @@ uint32_t GPU_readStatus(void)
 
 long GPU_freeze(uint32_t type, GPUFreeze_t *freeze)
 {
+  FILE *trace_file;
   int i;
 
   switch (type) {
@@ -728,7 +792,11 @@ long GPU_freeze(uint32_t type, GPUFreeze_t *freeze)
       freeze->ulStatus = gpu.status.reg;
       break;
     case 0: // load
+      // Trace gets a new full state record instead of the GP1 writes below
+      trace_file = gpu_trace_file;
+      gpu_trace_file = NULL;
       memcpy(gpu.vram, freeze->psxVRam, 1024 * 512 * 2);
+      gpulib_mark_dirty(0, 512);
       memcpy(gpu.regs, freeze->ulControl, sizeof(gpu.regs));
       memcpy(gpu.ex_regs, freeze->ulControl + 0xe0, sizeof(gpu.ex_regs));
       gpu.status.reg = freeze->ulStatus;
@@ -739,6 +807,9 @@ long GPU_freeze(uint32_t type, GPUFreeze_t *freeze)
       }
       renderer_sync_ecmds(gpu.ex_regs);
       renderer_update_caches(0, 0, 1024, 512);
+      gpu_trace_file = trace_file;
+      if (unlikely(gpu_trace_file != NULL))
+        gpu_trace_state();
       break;
   }
 
@@ -775,10 +846,16 @@ void GPU_updateLace(void)
   vout_update();
   gpu.state.fb_dirty = 0;
   gpu.state.blanked = 0;
+
+  if (unlikely(gpu_trace_file != NULL))
+    gpu_trace_frame();
 }
 
 void GPU_vBlank(int is_vblank, int lcf)
 {
+  if (unlikely(gpu_trace_file != NULL))
+    gpu_trace_vblank(is_vblank, lcf);
+
   int interlace = gpu.state.allow_interlace
     && gpu.status.interlace && gpu.status.dheight;
   // interlace doesn't look nice on progressive displays,
@@ -818,9 +895,23 @@ void GPU_getScreenInfo(GPUScreenInfo_t *sinfo)
 	sinfo->pal     = gpu.status.video;
 }
 
+// Fixed setup cost of a prim, in pixels drawn
+#define RASTER_PRIM_COST 32
+
+// Returns rasterization work done since last call, in pixel-equivalents
+uint32_t gpulib_take_raster_work(void)
+{
+  uint32_t work = gpu.state.raster_pixels + gpu.state.raster_prims * RASTER_PRIM_COST;
+  gpu.state.raster_prims = 0;
+  gpu.state.raster_pixels = 0;
+  return work;
+}
+
 void gpulib_frameskip_prepare(void)
 {
-  gpu.frameskip.set = Config.FrameSkip;
+  // Fast-forward decides per flip which frames get drawn, but needs
+  //  the same flip tracking as auto frameskip does
+  gpu.frameskip.set = pl_data.fast_forward ? FRAMESKIP_AUTO : Config.FrameSkip;
   gpu.frameskip.active = 0;
   gpu.frameskip.cnt = 0;
   gpu.frameskip.frame_ready = 1;
@@ -12,6 +12,7 @@
 #define GPULIB_GPU_H
 
 #include <stdint.h>
+#include <string.h>
 
 #ifdef GPU_UNAI
 #include "gpu/gpu_unai/gpu.h"  // To get config struct definition
@@ -80,6 +81,9 @@ struct psx_gpu {
       uint32_t hcnt;
     } last_list;
     uint32_t last_vram_read_frame;
+    uint32_t dirty_lines[512 / 32]; /* VRAM rows changed since last vout_update() */
+    uint32_t raster_prims;          /* drawing work since last gpulib_take_raster_work() */
+    uint32_t raster_pixels;
   } state;
   struct {
     int32_t set:3; /* -1 auto, 0 off, 1-3 fixed */
@@ -122,9 +126,40 @@ struct gpulib_config_t {
 
 extern struct gpulib_config_t gpulib_config;
 
+/* Mark VRAM rows y..y+h-1 (wrapping at 512) changed, lets vout_update()
+ * skip re-blitting rows of the display area that were not drawn to */
+static inline void gpulib_mark_dirty(int y, int h)
+{
+  if (h >= 512) {
+    memset(gpu.state.dirty_lines, 0xff, sizeof(gpu.state.dirty_lines));
+    return;
+  }
+  y &= 511;
+  while (h > 0) {
+    int bit = y & 31;
+    int n = 32 - bit;
+    if (n > h)
+      n = h;
+    gpu.state.dirty_lines[y >> 5] |= (n == 32) ? ~0u : ((1u << n) - 1) << bit;
+    y = (y + n) & 511;
+    h -= n;
+  }
+}
+
+/* Renderers call this for every prim drawn, with the (clipped, estimated)
+ * number of pixels it touches, for the auto frameskip cost prediction */
+static inline void gpulib_add_raster_work(uint32_t pixels)
+{
+  gpu.state.raster_prims++;
+  gpu.state.raster_pixels += pixels;
+}
+
+uint32_t gpulib_take_raster_work(void);
+
 int  vout_init(void);
 int  vout_finish(void);
 void vout_update(void);
 void vout_blank(void);
 void vout_set_config(const struct gpulib_config_t *config);
+void vout_invalidate(void);
 #endif // GPULIB_GPU_H
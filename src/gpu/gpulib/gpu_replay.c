@@ -0,0 +1,271 @@
+/*
+ * gpu_replay: feed a gpulib command-stream trace (see gpu_trace.h) to the
+ *  renderer, without the CPU core or any other part of the emulator.
+ *
+ * Gives a deterministic rasterizer-only benchmark on real game workloads,
+ *  and checks the VRAM hash of every frame against the one recorded.
+ *  Traces are recorded with pcsx4all's -gputrace option. Record with
+ *  frameskip off, or skipped frames will not match.
+ *
+ * This work is licensed under the terms of any of these licenses
+ * (at your option):
+ *  - GNU GPL, version 2 or later.
+ *  - GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "psxcommon.h"
+#include "plugins.h"
+#include "plugin_lib.h"
+#include "gpu.h"
+#include "gpu_trace.h"
+
+// Things gpulib and the renderer expect from the rest of the emulator
+PcsxConfig Config;
+uint32_t hSyncCount;
+uint32_t frame_counter;
+struct pl_data_t pl_data;
+
+int  vout_init(void) { return 0; }
+int  vout_finish(void) { return 0; }
+void vout_update(void) {}
+void vout_blank(void) {}
+void vout_set_config(const struct gpulib_config_t *config) {}
+void update_window_size(int w, int h, uint_fast8_t ntsc_fix) {}
+void pl_clear_borders(void) {}
+uint_fast8_t pl_fast_forward_draw(void) { return true; }
+
+extern void gpulib_set_config(const struct gpulib_config_t *config);
+
+static GPUFreeze_t freeze_buf;
+static uint32_t dma_ram[0x200000/4];    // GPU_dmaChain() lists are rebuilt here
+static uint32_t scratch[0x10000];
+
+struct replay_stats {
+	unsigned frames;
+	unsigned bad_frames;
+};
+
+static unsigned get_usecs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int replay(const uint32_t *trace, size_t trace_len, int check_hash,
+                  int verbose, struct replay_stats *stats)
+{
+	size_t pos = 4;
+	uint32_t dma_pos = 0, dma_last_node = 0;
+	int dma_nodes = 0;
+
+	while (pos < trace_len) {
+		const uint32_t tag = trace[pos++];
+		const uint32_t len = GPU_TRACE_LEN(tag);
+		const uint32_t *data = &trace[pos];
+
+		if (pos + len > trace_len) {
+			printf("ERROR: truncated record at word %u\n", (unsigned)(pos - 1));
+			return -1;
+		}
+		pos += len;
+
+		switch (GPU_TRACE_TYPE(tag)) {
+			case GPU_TRACE_STATE:
+				if (len != GPU_TRACE_STATE_LEN) {
+					printf("ERROR: bad state record length %u\n", len);
+					return -1;
+				}
+				freeze_buf.ulStatus = data[0];
+				memcpy(&freeze_buf.ulControl[0], &data[1], 16*4);
+				memcpy(&freeze_buf.ulControl[0xe0], &data[17], 8*4);
+				memcpy(freeze_buf.psxVRam, &data[25], 1024*512*2);
+				GPU_freeze(0, &freeze_buf);
+				break;
+
+			case GPU_TRACE_GP0:
+				for (uint32_t i = 0; i < len; i++)
+					GPU_writeData(data[i]);
+				break;
+
+			case GPU_TRACE_GP0_MEM:
+				// Renderer may alter the data, so pass a copy
+				if (len > sizeof(scratch)/4) {
+					printf("ERROR: GP0 write of %u words is too large\n", len);
+					return -1;
+				}
+				memcpy(scratch, data, len*4);
+				GPU_writeDataMem(scratch, len);
+				break;
+
+			case GPU_TRACE_DMA_NODE:
+				if (dma_pos + 1 + len > sizeof(dma_ram)/4) {
+					printf("ERROR: DMA chain too large\n");
+					return -1;
+				}
+				if (dma_nodes++)
+					dma_ram[dma_last_node] |= dma_pos * 4;
+				dma_last_node = dma_pos;
+				dma_ram[dma_pos++] = len << 24;
+				memcpy(&dma_ram[dma_pos], data, len*4);
+				dma_pos += len;
+				break;
+
+			case GPU_TRACE_DMA_END:
+				if (dma_nodes) {
+					dma_ram[dma_last_node] |= 0xffffff;
+					GPU_dmaChain(dma_ram, 0);
+				}
+				dma_pos = dma_last_node = 0;
+				dma_nodes = 0;
+				break;
+
+			case GPU_TRACE_GP1:
+				GPU_writeStatus(data[0]);
+				break;
+
+			case GPU_TRACE_READ:
+				for (uint32_t left = data[0]; left > 0; ) {
+					const uint32_t cnt = left < sizeof(scratch)/4 ? left : sizeof(scratch)/4;
+					GPU_readDataMem(scratch, cnt);
+					left -= cnt;
+				}
+				break;
+
+			case GPU_TRACE_VBLANK:
+				GPU_vBlank(data[0], data[1]);
+				break;
+
+			case GPU_TRACE_FRAME:
+				frame_counter = data[0];
+				GPU_updateLace();
+				stats->frames++;
+				if (check_hash) {
+					const uint32_t hash = gpu_trace_vram_hash(gpu.vram);
+					if (hash != data[1]) {
+						if (stats->bad_frames++ < 10 || verbose)
+							printf("frame %u: VRAM hash %08x, recorded %08x\n", data[0], hash, data[1]);
+					} else if (verbose) {
+						printf("frame %u: VRAM hash %08x OK\n", data[0], hash);
+					}
+				}
+				break;
+
+			default:
+				printf("ERROR: unknown record type %u at word %u\n",
+				       GPU_TRACE_TYPE(tag), (unsigned)(pos - len - 1));
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options] trace_file\n"
+	       "  -loops N      replay trace N times (default 1)\n"
+	       "  -nohash       don't check VRAM hashes (faster)\n"
+	       "  -v            print VRAM hash of every frame\n"
+	       "  -dither       enable dithering\n"
+	       "  -nolight      disable lighting\n"
+	       "  -nofastlight  disable fast lighting\n"
+	       "  -noblend      disable blending\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	const char *filename = NULL;
+	int loops = 1, check_hash = 1, verbose = 0;
+
+	gpu_unai_config_ext.ilace_force = 0;
+	gpu_unai_config_ext.pixel_skip = 0;
+	gpu_unai_config_ext.lighting = 1;
+	gpu_unai_config_ext.fast_lighting = 1;
+	gpu_unai_config_ext.blending = 1;
+	gpu_unai_config_ext.dithering = 0;
+	gpu_unai_config_ext.ntsc_fix = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-loops") == 0 && i + 1 < argc) {
+			loops = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-nohash") == 0) {
+			check_hash = 0;
+		} else if (strcmp(argv[i], "-v") == 0) {
+			verbose = 1;
+		} else if (strcmp(argv[i], "-dither") == 0) {
+			gpu_unai_config_ext.dithering = 1;
+		} else if (strcmp(argv[i], "-nolight") == 0) {
+			gpu_unai_config_ext.lighting = 0;
+		} else if (strcmp(argv[i], "-nofastlight") == 0) {
+			gpu_unai_config_ext.fast_lighting = 0;
+		} else if (strcmp(argv[i], "-noblend") == 0) {
+			gpu_unai_config_ext.blending = 0;
+		} else if (argv[i][0] != '-' && !filename) {
+			filename = argv[i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!filename || loops < 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	// Read whole trace up front, so file I/O isn't part of the timing
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		printf("ERROR: could not open %s\n", filename);
+		return 1;
+	}
+	fseek(f, 0, SEEK_END);
+	const size_t trace_len = ftell(f) / 4;
+	fseek(f, 0, SEEK_SET);
+	uint32_t *trace = (uint32_t *)malloc(trace_len * 4 + 4);
+	if (!trace || fread(trace, 4, trace_len, f) != trace_len) {
+		printf("ERROR: could not read %s\n", filename);
+		fclose(f);
+		return 1;
+	}
+	fclose(f);
+
+	if (trace_len < 4 || trace[0] != GPU_TRACE_MAGIC0 || trace[1] != GPU_TRACE_MAGIC1 ||
+	    trace[2] != GPU_TRACE_VERSION) {
+		printf("ERROR: %s is not a version %d GPU trace\n", filename, GPU_TRACE_VERSION);
+		return 1;
+	}
+
+	if (GPU_init() != 0) {
+		printf("ERROR: GPU_init() failed\n");
+		return 1;
+	}
+	struct gpulib_config_t config;
+	memset(&config, 0, sizeof(config));
+	gpulib_set_config(&config);
+
+	struct replay_stats stats = { 0, 0 };
+	const unsigned start = get_usecs();
+
+	for (int i = 0; i < loops; i++) {
+		if (replay(trace, trace_len, check_hash, verbose, &stats) != 0)
+			return 1;
+	}
+
+	const unsigned usecs = get_usecs() - start;
+	printf("%u frames in %u.%03u s, %.1f fps\n", stats.frames,
+	       usecs / 1000000, (usecs / 1000) % 1000,
+	       usecs ? stats.frames * 1000000.0 / usecs : 0.0);
+	if (check_hash)
+		printf("%u frames with VRAM hash mismatch\n", stats.bad_frames);
+
+	GPU_shutdown();
+	free(trace);
+	return stats.bad_frames ? 2 : 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * GPU command-stream capture for gpulib, see gpu_trace.h
+ *
+ * This work is licensed under the terms of any of these licenses
+ * (at your option):
+ *  - GNU GPL, version 2 or later.
+ *  - GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "plugins.h"    // For GPUFreeze_t
+#include "gpu.h"
+#include "gpu_trace.h"
+
+FILE *gpu_trace_file = NULL;
+
+// Single-word GP0 writes are collected and written as one record
+#define GP0_BUF_LEN 256
+static uint32_t gp0_buf[GP0_BUF_LEN];
+static int gp0_cnt;
+
+static GPUFreeze_t *freeze_buf;
+
+static void write_words(const uint32_t *data, int count)
+{
+	if (!gpu_trace_file)
+		return;
+
+	if (fwrite(data, 4, count, gpu_trace_file) != (size_t)count) {
+		printf("ERROR: gpu_trace: write failed, stopping trace\n");
+		fclose(gpu_trace_file);
+		gpu_trace_file = NULL;
+	}
+}
+
+static void write_tag(int type, int len)
+{
+	uint32_t tag = GPU_TRACE_TAG(type, len);
+	write_words(&tag, 1);
+}
+
+static void flush_gp0(void)
+{
+	if (gp0_cnt == 0)
+		return;
+	write_tag(GPU_TRACE_GP0, gp0_cnt);
+	write_words(gp0_buf, gp0_cnt);
+	gp0_cnt = 0;
+}
+
+int gpu_trace_start(const char *filename)
+{
+	gpu_trace_stop();
+
+	freeze_buf = (GPUFreeze_t *)malloc(sizeof(GPUFreeze_t));
+	if (!freeze_buf) {
+		printf("ERROR: gpu_trace: out of memory\n");
+		return -1;
+	}
+
+	gpu_trace_file = fopen(filename, "wb");
+	if (!gpu_trace_file) {
+		printf("ERROR: gpu_trace: could not open %s for writing\n", filename);
+		free(freeze_buf);
+		freeze_buf = NULL;
+		return -1;
+	}
+
+	const uint32_t header[4] = { GPU_TRACE_MAGIC0, GPU_TRACE_MAGIC1, GPU_TRACE_VERSION, 0 };
+	write_words(header, 4);
+
+	gp0_cnt = 0;
+	gpu_trace_state();
+
+	printf("gpu_trace: recording to %s\n", filename);
+	return 0;
+}
+
+void gpu_trace_stop(void)
+{
+	if (gpu_trace_file) {
+		flush_gp0();
+		if (gpu_trace_file)
+			fclose(gpu_trace_file);
+		gpu_trace_file = NULL;
+	}
+
+	free(freeze_buf);
+	freeze_buf = NULL;
+}
+
+/* Record full GPU state, which also flushes the command buffer */
+void gpu_trace_state(void)
+{
+	if (!gpu_trace_file || !gpu.vram)
+		return;
+
+	GPU_freeze(1, freeze_buf);
+
+	flush_gp0();
+	write_tag(GPU_TRACE_STATE, GPU_TRACE_STATE_LEN);
+	write_words(&freeze_buf->ulStatus, 1);
+	write_words(&freeze_buf->ulControl[0], 16);
+	write_words(&freeze_buf->ulControl[0xe0], 8);
+	write_words((uint32_t *)freeze_buf->psxVRam, 1024*512/2);
+}
+
+void gpu_trace_gp0(uint32_t data)
+{
+	gp0_buf[gp0_cnt++] = data;
+	if (gp0_cnt == GP0_BUF_LEN)
+		flush_gp0();
+}
+
+void gpu_trace_words(int type, const uint32_t *data, int count)
+{
+	flush_gp0();
+	write_tag(type, count);
+	write_words(data, count);
+}
+
+void gpu_trace_dma_end(void)
+{
+	flush_gp0();
+	write_tag(GPU_TRACE_DMA_END, 0);
+}
+
+void gpu_trace_gp1(uint32_t data)
+{
+	flush_gp0();
+	write_tag(GPU_TRACE_GP1, 1);
+	write_words(&data, 1);
+}
+
+void gpu_trace_read(int count)
+{
+	uint32_t val = count;
+	flush_gp0();
+	write_tag(GPU_TRACE_READ, 1);
+	write_words(&val, 1);
+}
+
+void gpu_trace_vblank(int is_vblank, int lcf)
+{
+	const uint32_t vals[2] = { (uint32_t)is_vblank, (uint32_t)lcf };
+	flush_gp0();
+	write_tag(GPU_TRACE_VBLANK, 2);
+	write_words(vals, 2);
+}
+
+void gpu_trace_frame(void)
+{
+	const uint32_t vals[2] = { *gpu.state.frame_count, gpu_trace_vram_hash(gpu.vram) };
+	flush_gp0();
+	write_tag(GPU_TRACE_FRAME, 2);
+	write_words(vals, 2);
+}
+
+uint32_t gpu_trace_vram_hash(const uint16_t *vram)
+{
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < 1024*512; i++) {
+		hash ^= vram[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,87 @@
+/*
+ * GPU command-stream capture for gpulib
+ *
+ * Records everything that reaches gpulib from the CPU side (GP0/GP1 writes,
+ * DMA chains, VRAM reads, vblank, frame flips) so the stream can be fed to a
+ * renderer again without the rest of the emulator, see gpu_replay.c.
+ *
+ * This work is licensed under the terms of any of these licenses
+ * (at your option):
+ *  - GNU GPL, version 2 or later.
+ *  - GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef GPULIB_GPU_TRACE_H
+#define GPULIB_GPU_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Trace file layout (all values are host-endian uint32_t words):
+ *
+ *  Header:  "PCSXGPUT" magic (2 words), version, 0
+ *  Records: tag = (type << 24) | payload length in words, then payload
+ *
+ *  STATE       status, regs[16], ex_regs[8], VRAM (1024*512 halfwords)
+ *  GP0         words written one at a time with GPU_writeData()
+ *  GP0_MEM     words of one GPU_writeDataMem() call
+ *  DMA_NODE    words of one GPU_dmaChain() list node
+ *  DMA_END     none: ends the GPU_dmaChain() call the DMA_NODEs belong to
+ *  GP1         GPU_writeStatus() value
+ *  READ        # of words read from VRAM by GPU_readData/GPU_readDataMem
+ *  VBLANK      is_vblank, lcf args of GPU_vBlank()
+ *  FRAME       frame counter, hash of VRAM after GPU_updateLace()
+ */
+
+#define GPU_TRACE_MAGIC0        0x58534350  /* "PCSX" */
+#define GPU_TRACE_MAGIC1        0x54555047  /* "GPUT" */
+#define GPU_TRACE_VERSION       1
+
+enum {
+	GPU_TRACE_STATE = 1,
+	GPU_TRACE_GP0,
+	GPU_TRACE_GP0_MEM,
+	GPU_TRACE_DMA_NODE,
+	GPU_TRACE_DMA_END,
+	GPU_TRACE_GP1,
+	GPU_TRACE_READ,
+	GPU_TRACE_VBLANK,
+	GPU_TRACE_FRAME
+};
+
+#define GPU_TRACE_TAG(type, len)  (((uint32_t)(type) << 24) | ((len) & 0xffffff))
+#define GPU_TRACE_TYPE(tag)       ((tag) >> 24)
+#define GPU_TRACE_LEN(tag)        ((tag) & 0xffffff)
+
+/* Words in a STATE record */
+#define GPU_TRACE_STATE_LEN       (1 + 16 + 8 + 1024*512/2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Non-NULL while a trace is being recorded */
+extern FILE *gpu_trace_file;
+
+int  gpu_trace_start(const char *filename);
+void gpu_trace_stop(void);
+
+void gpu_trace_state(void);
+void gpu_trace_gp0(uint32_t data);
+void gpu_trace_words(int type, const uint32_t *data, int count);
+void gpu_trace_dma_end(void);
+void gpu_trace_gp1(uint32_t data);
+void gpu_trace_read(int count);
+void gpu_trace_vblank(int is_vblank, int lcf);
+void gpu_trace_frame(void);
+
+/* FNV-1a hash of VRAM, recorded with each frame to verify replays */
+uint32_t gpu_trace_vram_hash(const uint16_t *vram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPULIB_GPU_TRACE_H
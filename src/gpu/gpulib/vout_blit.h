@@ -0,0 +1,705 @@
+/*
+ * Line blitters/scalers for vout_port.c
+ *
+ *   Copyright (C) 2016 PCSX4ALL Team
+ *   Copyright (C) 2016 Senquack (dansilsby <AT> gmail <DOT> com)
+ *   Copyright (C) 2010 Unai
+ *
+ * This work is licensed under the terms of any of these licenses
+ * (at your option):
+ *  - GNU GPL, version 2 or later.
+ *  - GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef GPULIB_VOUT_BLIT_H
+#define GPULIB_VOUT_BLIT_H
+
+#include <stdint.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// BLITTERS TAKEN FROM gpu_unai/gpu_blit.h
+// GPU Blitting code with rescale and interlace support.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef USE_BGR15
+#define RGB24(R,G,B)	(((((R)&0xF8)<<8)|(((G)&0xFC)<<3)|(((B)&0xF8)>>3)))
+#define RGB16X2(C)		(((C)&(0x1f001f<<10))>>10) | (((C)&(0x1f001f<<5))<<1) | (((C)&(0x1f001f<<0))<<11)
+#define RGB16(C)		(((C)&(0x1f<<10))>>10) | (((C)&(0x1f<<5))<<1) | (((C)&(0x1f<<0))<<11)
+#else
+#define RGB24(R,G,B)  	((((R)&0xF8)>>3)|(((G)&0xF8)<<2)|(((B)&0xF8)<<7))
+#endif
+
+#ifdef USE_MEMCPY32
+static inline void *memcpy32 (void * restrict dest, const void * restrict src, size_t len)
+{
+	uint32_t * restrict d = (uint32_t* restrict)dest;
+	const uint32_t * restrict s = (const uint32_t* restrict)src;
+	while (len--) {
+		*d++ = *s++;
+	}
+	return dest;
+}
+#define MEMCPY(d, s, l) memcpy32((d), (s), (l) >> 2)
+#else
+#define MEMCPY memcpy
+#endif
+
+static inline void GPU_BlitWW(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
+{
+	uint32_t uCount;
+	if (!isRGB24)
+	{
+#ifndef USE_BGR15
+		uCount = 20;
+		const uint32_t* restrict src32 = (const uint32_t* restrict) src;
+		uint32_t* restrict dst32 = (uint32_t* restrict)(void*) dst16;
+		do {
+			dst32[0] = RGB16X2(src32[0]);
+			dst32[1] = RGB16X2(src32[1]);
+			dst32[2] = RGB16X2(src32[2]);
+			dst32[3] = RGB16X2(src32[3]);
+			dst32[4] = RGB16X2(src32[4]);
+			dst32[5] = RGB16X2(src32[5]);
+			dst32[6] = RGB16X2(src32[6]);
+			dst32[7] = RGB16X2(src32[7]);
+			dst32 += 8;
+			src32 += 8;
+		} while(--uCount);
+#else
+		MEMCPY(dst16, src, 640);
+#endif
+	} else
+	{
+		uCount = 20;
+		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
+		do{
+			dst16[ 0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
+			dst16[ 1] = RGB24(src8[ 3], src8[ 4], src8[ 5] );
+			dst16[ 2] = RGB24(src8[ 6], src8[ 7], src8[ 8] );
+			dst16[ 3] = RGB24(src8[ 9], src8[10], src8[11] );
+			dst16[ 4] = RGB24(src8[12], src8[13], src8[14] );
+			dst16[ 5] = RGB24(src8[15], src8[16], src8[17] );
+			dst16[ 6] = RGB24(src8[18], src8[19], src8[20] );
+			dst16[ 7] = RGB24(src8[21], src8[22], src8[23] );
+
+			dst16[ 8] = RGB24(src8[24], src8[25], src8[26] );
+			dst16[ 9] = RGB24(src8[27], src8[28], src8[29] );
+			dst16[10] = RGB24(src8[30], src8[31], src8[32] );
+			dst16[11] = RGB24(src8[33], src8[34], src8[35] );
+			dst16[12] = RGB24(src8[36], src8[37], src8[38] );
+			dst16[13] = RGB24(src8[39], src8[40], src8[41] );
+			dst16[14] = RGB24(src8[42], src8[43], src8[44] );
+			dst16[15] = RGB24(src8[45], src8[46], src8[47] );
+			dst16 += 16;
+			src8  += 48;
+		} while (--uCount);
+	}
+}
+
+static inline void GPU_BlitWWSWWSWS(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
+{
+	uint32_t uCount;
+	if (!isRGB24)
+	{
+#ifndef USE_BGR15
+		uCount = 64;
+		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
+		do {
+			dst16[0] = RGB16(src16[0]);
+			dst16[1] = RGB16(src16[1]);
+			dst16[2] = RGB16(src16[3]);
+			dst16[3] = RGB16(src16[4]);
+			dst16[4] = RGB16(src16[6]);
+			dst16 += 5;
+			src16 += 8;
+		} while (--uCount);
+#else
+		uCount = 64;
+		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
+		do {
+			dst16[0] = src16[0];
+			dst16[1] = src16[1];
+			dst16[2] = src16[3];
+			dst16[3] = src16[4];
+			dst16[4] = src16[6];
+			dst16 += 5;
+			src16 += 8;
+		} while (--uCount);
+#endif
+	} else
+	{
+		uCount = 32;
+		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
+		do {
+			dst16[ 0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
+			dst16[ 1] = RGB24(src8[ 3], src8[ 4], src8[ 5] );
+			dst16[ 2] = RGB24(src8[ 9], src8[10], src8[11] );
+			dst16[ 3] = RGB24(src8[12], src8[13], src8[14] );
+			dst16[ 4] = RGB24(src8[18], src8[19], src8[20] );
+
+			dst16[ 5] = RGB24(src8[24], src8[25], src8[26] );
+			dst16[ 6] = RGB24(src8[27], src8[28], src8[29] );
+			dst16[ 7] = RGB24(src8[33], src8[34], src8[35] );
+			dst16[ 8] = RGB24(src8[36], src8[37], src8[38] );
+			dst16[ 9] = RGB24(src8[42], src8[43], src8[44] );
+
+			dst16 += 10;
+			src8  += 48;
+		} while (--uCount);
+	}
+}
+
+static inline void GPU_BlitWWWWWS(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
+{
+	uint32_t uCount;
+	if (!isRGB24)
+	{
+#ifndef USE_BGR15
+		uCount = 32;
+		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
+		do {
+			dst16[ 0] = RGB16(src16[0]);
+			dst16[ 1] = RGB16(src16[1]);
+			dst16[ 2] = RGB16(src16[2]);
+			dst16[ 3] = RGB16(src16[3]);
+			dst16[ 4] = RGB16(src16[4]);
+			dst16[ 5] = RGB16(src16[6]);
+			dst16[ 6] = RGB16(src16[7]);
+			dst16[ 7] = RGB16(src16[8]);
+			dst16[ 8] = RGB16(src16[9]);
+			dst16[ 9] = RGB16(src16[10]);
+			dst16 += 10;
+			src16 += 12;
+		} while (--uCount);
+#else
+		uCount = 64;
+		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
+		do {
+			MEMCPY(dst16, src16, 2 * 5);
+			dst16 += 5;
+			src16 += 6;
+		} while (--uCount);
+#endif
+	} else
+	{
+		uCount = 32;
+		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
+		do {
+			dst16[0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
+			dst16[1] = RGB24(src8[ 3], src8[ 4], src8[ 5] );
+			dst16[2] = RGB24(src8[ 6], src8[ 7], src8[ 8] );
+			dst16[3] = RGB24(src8[ 9], src8[10], src8[11] );
+			dst16[4] = RGB24(src8[12], src8[13], src8[14] );
+			dst16[5] = RGB24(src8[18], src8[19], src8[20] );
+			dst16[6] = RGB24(src8[21], src8[22], src8[23] );
+			dst16[7] = RGB24(src8[24], src8[25], src8[26] );
+			dst16[8] = RGB24(src8[27], src8[28], src8[29] );
+			dst16[9] = RGB24(src8[30], src8[31], src8[32] );
+			dst16 += 10;
+			src8  += 36;
+		} while (--uCount);
+	}
+}
+
+static inline void GPU_BlitWWWWWWWWS(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24, uint32_t uClip_src)
+{
+	uint32_t uCount;
+	if (!isRGB24)
+	{
+#ifndef USE_BGR15
+		uCount = 20;
+		const uint16_t* restrict src16 = ((const uint16_t* restrict) src) + uClip_src;
+		do {
+			dst16[ 0] = RGB16(src16[0]);
+			dst16[ 1] = RGB16(src16[1]);
+			dst16[ 2] = RGB16(src16[2]);
+			dst16[ 3] = RGB16(src16[3]);
+			dst16[ 4] = RGB16(src16[4]);
+			dst16[ 5] = RGB16(src16[5]);
+			dst16[ 6] = RGB16(src16[6]);
+			dst16[ 7] = RGB16(src16[7]);
+
+			dst16[ 8] = RGB16(src16[9]);
+			dst16[ 9] = RGB16(src16[10]);
+			dst16[10] = RGB16(src16[11]);
+			dst16[11] = RGB16(src16[12]);
+			dst16[12] = RGB16(src16[13]);
+			dst16[13] = RGB16(src16[14]);
+			dst16[14] = RGB16(src16[15]);
+			dst16[15] = RGB16(src16[16]);
+			dst16 += 16;
+			src16 += 18;
+		} while (--uCount);
+#else
+		uCount = 40;
+		const uint16_t* restrict src16 = ((const uint16_t* restrict) src) + uClip_src;
+		do {
+			MEMCPY(dst16, src16, 2 * 8);
+			dst16 += 8;
+			src16 += 9;
+		} while (--uCount);
+#endif
+	} else
+	{
+		uCount = 20;
+		const uint8_t* restrict src8 = (const uint8_t* restrict)src + (uClip_src<<1) + uClip_src;
+		do {
+			dst16[ 0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
+			dst16[ 1] = RGB24(src8[ 3], src8[ 4], src8[ 5] );
+			dst16[ 2] = RGB24(src8[ 6], src8[ 7], src8[ 8] );
+			dst16[ 3] = RGB24(src8[ 9], src8[10], src8[11] );
+			dst16[ 4] = RGB24(src8[12], src8[13], src8[14] );
+			dst16[ 5] = RGB24(src8[15], src8[16], src8[17] );
+			dst16[ 6] = RGB24(src8[18], src8[19], src8[20] );
+			dst16[ 7] = RGB24(src8[21], src8[22], src8[23] );
+
+			dst16[ 8] = RGB24(src8[27], src8[28], src8[29] );
+			dst16[ 9] = RGB24(src8[30], src8[31], src8[32] );
+			dst16[10] = RGB24(src8[33], src8[34], src8[35] );
+			dst16[11] = RGB24(src8[36], src8[37], src8[38] );
+			dst16[12] = RGB24(src8[39], src8[40], src8[41] );
+			dst16[13] = RGB24(src8[42], src8[43], src8[44] );
+			dst16[14] = RGB24(src8[45], src8[46], src8[47] );
+			dst16[15] = RGB24(src8[48], src8[49], src8[50] );
+			dst16 += 16;
+			src8  += 54;
+		} while (--uCount);
+	}
+}
+
+static inline void GPU_BlitWWDWW(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
+{
+	uint32_t uCount;
+	if (!isRGB24)
+	{
+#ifndef USE_BGR15
+		uCount = 32;
+		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
+		do {
+			dst16[ 0] = RGB16(src16[0]);
+			dst16[ 1] = RGB16(src16[1]);
+			dst16[ 2] = dst16[1];
+			dst16[ 3] = RGB16(src16[2]);
+			dst16[ 4] = RGB16(src16[3]);
+			dst16[ 5] = RGB16(src16[4]);
+			dst16[ 6] = RGB16(src16[5]);
+			dst16[ 7] = dst16[6];
+			dst16[ 8] = RGB16(src16[6]);
+			dst16[ 9] = RGB16(src16[7]);
+			dst16 += 10;
+			src16 +=  8;
+		} while (--uCount);
+#else
+		uCount = 64;
+		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
+		do {
+			*dst16++ = *src16++;
+			*dst16++ = *src16;
+			*dst16++ = *src16++;
+			*dst16++ = *src16++;
+			*dst16++ = *src16++;
+		} while (--uCount);
+#endif
+	} else
+	{
+		uCount = 32;
+		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
+		do {
+			dst16[ 0] = RGB24(src8[0], src8[ 1], src8[ 2] );
+			dst16[ 1] = RGB24(src8[3], src8[ 4], src8[ 5] );
+			dst16[ 2] = dst16[1];
+			dst16[ 3] = RGB24(src8[6], src8[ 7], src8[ 8] );
+			dst16[ 4] = RGB24(src8[9], src8[10], src8[11] );
+
+			dst16[ 5] = RGB24(src8[12], src8[13], src8[14] );
+			dst16[ 6] = RGB24(src8[15], src8[16], src8[17] );
+			dst16[ 7] = dst16[6];
+			dst16[ 8] = RGB24(src8[18], src8[19], src8[20] );
+			dst16[ 9] = RGB24(src8[21], src8[22], src8[23] );
+			dst16 += 10;
+			src8  += 24;
+		} while (--uCount);
+	}
+}
+
+
+static inline void GPU_BlitWS(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
+{
+	uint32_t uCount;
+	if (!isRGB24) {
+#ifndef USE_BGR15
+		uCount = 20;
+		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
+		do {
+			dst16[ 0] = RGB16(src16[0]);
+			dst16[ 1] = RGB16(src16[2]);
+			dst16[ 2] = RGB16(src16[4]);
+			dst16[ 3] = RGB16(src16[6]);
+
+			dst16[ 4] = RGB16(src16[8]);
+			dst16[ 5] = RGB16(src16[10]);
+			dst16[ 6] = RGB16(src16[12]);
+			dst16[ 7] = RGB16(src16[14]);
+
+			dst16[ 8] = RGB16(src16[16]);
+			dst16[ 9] = RGB16(src16[18]);
+			dst16[10] = RGB16(src16[20]);
+			dst16[11] = RGB16(src16[22]);
+
+			dst16[12] = RGB16(src16[24]);
+			dst16[13] = RGB16(src16[26]);
+			dst16[14] = RGB16(src16[28]);
+			dst16[15] = RGB16(src16[30]);
+
+			dst16 += 16;
+			src16 += 32;
+		} while (--uCount);
+#else
+		uCount = 320;
+		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
+		do {
+			*dst16++ = *src16;
+			src16 += 2;
+		} while (--uCount);
+#endif
+	} else
+	{
+		uCount = 20;
+		const uint8_t* restrict src8 = (const uint8_t* restrict) src;
+		do {
+			dst16[ 0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
+			dst16[ 1] = RGB24(src8[ 6], src8[ 7], src8[ 8] );
+			dst16[ 2] = RGB24(src8[12], src8[13], src8[14] );
+			dst16[ 3] = RGB24(src8[18], src8[19], src8[20] );
+
+			dst16[ 4] = RGB24(src8[24], src8[25], src8[26] );
+			dst16[ 5] = RGB24(src8[30], src8[31], src8[32] );
+			dst16[ 6] = RGB24(src8[36], src8[37], src8[38] );
+			dst16[ 7] = RGB24(src8[42], src8[43], src8[44] );
+
+			dst16[ 8] = RGB24(src8[48], src8[49], src8[50] );
+			dst16[ 9] = RGB24(src8[54], src8[55], src8[56] );
+			dst16[10] = RGB24(src8[60], src8[61], src8[62] );
+			dst16[11] = RGB24(src8[66], src8[67], src8[68] );
+
+			dst16[12] = RGB24(src8[72], src8[73], src8[74] );
+			dst16[13] = RGB24(src8[78], src8[79], src8[80] );
+			dst16[14] = RGB24(src8[84], src8[85], src8[86] );
+			dst16[15] = RGB24(src8[90], src8[91], src8[92] );
+
+			dst16 += 16;
+			src8  += 96;
+		} while(--uCount);
+	}
+}
+
+
+static inline void GPU_BlitCopy(const void* restrict src, uint16_t* restrict dst16, int w, uint_fast8_t isRGB24)
+{
+	uint32_t uCount;
+	if (!isRGB24)
+	{
+#ifndef USE_BGR15
+		uCount = w / 2;
+		const uint32_t* restrict src32 = (const uint32_t* restrict) src;
+		uint32_t* restrict dst32 = (uint32_t* restrict)(void*) dst16;
+		do {
+			uint32_t s = *src32++;
+			*dst32++ = RGB16X2(s);
+		} while(--uCount);
+#else
+		MEMCPY(dst16, src, w * 2);
+#endif
+	} else
+	{
+		uCount = w;
+		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
+		do{
+			*dst16++ = RGB24(src8[ 0], src8[ 1], src8[ 2] );
+			src8  += 3;
+		} while (--uCount);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Table-driven line scaler: vout_blit_select() picks the blitter for the
+//  display width/depth once, when they change, vout_blit_line() then blits
+//  each line without any per-line or per-pixel decisions.
+//
+// Every PS1 width maps to 320 screen pixels with a repeating pattern of
+//  source pixels, which the fused scalar blitters above hard-code. With
+//  SSE2/NEON, some widths instead convert with SIMD: straight into the
+//  screen line, or into a temp line the pattern is then applied to from a
+//  precomputed index table. Each table entry only uses SIMD where it was
+//  measured faster than the scalar blitter.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef USE_BGR15
+#if defined(__SSE2__)
+#define VOUT_USE_SSE2
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VOUT_USE_NEON
+#include <arm_neon.h>
+#endif
+#endif // !USE_BGR15
+
+typedef void (*vout_line_fn)(const void* restrict src, uint16_t* restrict dst16);
+typedef void (*vout_copy_fn)(const void* restrict src, uint16_t* restrict dst16, int w);
+
+#define VOUT_BLIT_WRAPPERS(name, ...) \
+	static void name##_15(const void* restrict src, uint16_t* restrict dst16) \
+	{ GPU_Blit##name(src, dst16, 0, ##__VA_ARGS__); } \
+	static void name##_24(const void* restrict src, uint16_t* restrict dst16) \
+	{ GPU_Blit##name(src, dst16, 1, ##__VA_ARGS__); }
+
+VOUT_BLIT_WRAPPERS(WWDWW)
+VOUT_BLIT_WRAPPERS(WW)
+VOUT_BLIT_WRAPPERS(WWWWWWWWS, 4)
+VOUT_BLIT_WRAPPERS(WWWWWS)
+VOUT_BLIT_WRAPPERS(WWSWWSWS)
+VOUT_BLIT_WRAPPERS(WS)
+
+static void vout_copy_15(const void* restrict src, uint16_t* restrict dst16, int w)
+{
+	GPU_BlitCopy(src, dst16, w, 0);
+}
+
+#if !defined(VOUT_USE_SSE2) && !defined(VOUT_USE_NEON)
+static void vout_copy_24(const void* restrict src, uint16_t* restrict dst16, int w)
+{
+	GPU_BlitCopy(src, dst16, w, 1);
+}
+#endif
+
+static uint16_t vout_xmap[320];       // Source pixel of each screen pixel
+static int vout_src_count;            // Source pixels needed for one line
+
+#if defined(VOUT_USE_SSE2) || defined(VOUT_USE_NEON)
+#define VOUT_SIMD(fn) fn
+
+// 24bpp conversion needs a byte shuffle, without SSSE3 it is scalar
+#if defined(VOUT_USE_NEON) || defined(__SSSE3__)
+#define VOUT_SIMD24(fn) fn
+#else
+#define VOUT_SIMD24(fn) NULL
+#endif
+
+// Convert w 15bpp PS1 pixels to RGB565
+static void vout_conv_15(const void* restrict src, uint16_t* restrict dst16, int w)
+{
+	const uint16_t* restrict src16 = (const uint16_t* restrict)src;
+	int i = 0;
+#if defined(VOUT_USE_SSE2)
+	const __m128i g_msk = _mm_set1_epi16(0x07c0);
+	const __m128i b_msk = _mm_set1_epi16(0x001f);
+	for (; i + 8 <= w; i += 8) {
+		__m128i p = _mm_loadu_si128((const __m128i*)(src16 + i));
+		__m128i r = _mm_slli_epi16(p, 11);
+		__m128i g = _mm_and_si128(_mm_slli_epi16(p, 1), g_msk);
+		__m128i b = _mm_and_si128(_mm_srli_epi16(p, 10), b_msk);
+		_mm_storeu_si128((__m128i*)(dst16 + i), _mm_or_si128(r, _mm_or_si128(g, b)));
+	}
+#else
+	const uint16x8_t g_msk = vdupq_n_u16(0x07c0);
+	const uint16x8_t b_msk = vdupq_n_u16(0x001f);
+	for (; i + 8 <= w; i += 8) {
+		uint16x8_t p = vld1q_u16(src16 + i);
+		uint16x8_t r = vshlq_n_u16(p, 11);
+		uint16x8_t g = vandq_u16(vshlq_n_u16(p, 1), g_msk);
+		uint16x8_t b = vandq_u16(vshrq_n_u16(p, 10), b_msk);
+		vst1q_u16(dst16 + i, vorrq_u16(r, vorrq_u16(g, b)));
+	}
+#endif
+	for (; i < w; i++)
+		dst16[i] = RGB16(src16[i]);
+}
+
+// Convert w 24bpp (R,G,B byte order) PS1 pixels to RGB565
+static void vout_conv_24(const void* restrict src, uint16_t* restrict dst16, int w)
+{
+	const uint8_t* restrict src8 = (const uint8_t* restrict)src;
+	int i = 0;
+#if defined(VOUT_USE_SSE2) && defined(__SSSE3__)
+	// Spread each 3-byte pixel of 4 into a 32-bit lane
+	const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+	                                     6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i r_msk = _mm_set1_epi32(0xf800);
+	const __m128i g_msk = _mm_set1_epi32(0x07e0);
+	const __m128i b_msk = _mm_set1_epi32(0x001f);
+	// 16-byte load at +12 reads 4 bytes past the 8 pixels, leave room for it
+	for (; i + 10 <= w; i += 8) {
+		const uint8_t *s = src8 + i * 3;
+		__m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), spread);
+		__m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s + 12)), spread);
+		lo = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(lo, 8), r_msk),
+		     _mm_or_si128(_mm_and_si128(_mm_srli_epi32(lo, 5), g_msk),
+		                  _mm_and_si128(_mm_srli_epi32(lo, 19), b_msk)));
+		hi = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(hi, 8), r_msk),
+		     _mm_or_si128(_mm_and_si128(_mm_srli_epi32(hi, 5), g_msk),
+		                  _mm_and_si128(_mm_srli_epi32(hi, 19), b_msk)));
+		// Sign-extend so signed-saturating pack keeps values above 0x7fff
+		lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+		hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+		_mm_storeu_si128((__m128i*)(dst16 + i), _mm_packs_epi32(lo, hi));
+	}
+#elif defined(VOUT_USE_NEON)
+	const uint16x8_t r_msk = vdupq_n_u16(0xf800);
+	const uint16x8_t g_msk = vdupq_n_u16(0x07e0);
+	for (; i + 16 <= w; i += 16) {
+		uint8x16x3_t p = vld3q_u8(src8 + i * 3);
+		uint16x8_t lo = vandq_u16(vshll_n_u8(vget_low_u8(p.val[0]), 8), r_msk);
+		uint16x8_t hi = vandq_u16(vshll_n_u8(vget_high_u8(p.val[0]), 8), r_msk);
+		lo = vorrq_u16(lo, vandq_u16(vshll_n_u8(vget_low_u8(p.val[1]), 3), g_msk));
+		hi = vorrq_u16(hi, vandq_u16(vshll_n_u8(vget_high_u8(p.val[1]), 3), g_msk));
+		lo = vorrq_u16(lo, vmovl_u8(vshr_n_u8(vget_low_u8(p.val[2]), 3)));
+		hi = vorrq_u16(hi, vmovl_u8(vshr_n_u8(vget_high_u8(p.val[2]), 3)));
+		vst1q_u16(dst16 + i, lo);
+		vst1q_u16(dst16 + i + 8, hi);
+	}
+#endif
+	for (src8 += i * 3; i < w; i++, src8 += 3)
+		dst16[i] = RGB24(src8[0], src8[1], src8[2]);
+}
+
+#if defined(VOUT_USE_NEON) || defined(__SSSE3__)
+static uint16_t vout_tmp_line[640 + 8] __attribute__((aligned(16)));
+
+static inline void vout_apply_xmap(const uint16_t* restrict tmp, uint16_t* restrict dst16)
+{
+	const uint16_t* restrict xmap = vout_xmap;
+	for (int i = 0; i < 320; i += 4) {
+		dst16[i + 0] = tmp[xmap[i + 0]];
+		dst16[i + 1] = tmp[xmap[i + 1]];
+		dst16[i + 2] = tmp[xmap[i + 2]];
+		dst16[i + 3] = tmp[xmap[i + 3]];
+	}
+}
+#endif
+
+static void vout_simd_320_15(const void* restrict src, uint16_t* restrict dst16)
+{
+	vout_conv_15(src, dst16, 320);
+}
+
+#if defined(VOUT_USE_NEON) || defined(__SSSE3__)
+static void vout_simd_320_24(const void* restrict src, uint16_t* restrict dst16)
+{
+	vout_conv_24(src, dst16, 320);
+}
+#endif
+
+// 640 -> 320: keep even pixels
+static void vout_simd_640_15(const void* restrict src, uint16_t* restrict dst16)
+{
+	const uint16_t* restrict src16 = (const uint16_t* restrict)src;
+#if defined(VOUT_USE_SSE2)
+	const __m128i g_msk = _mm_set1_epi16(0x07c0);
+	const __m128i b_msk = _mm_set1_epi16(0x001f);
+	for (int i = 0; i < 320; i += 8) {
+		__m128i p0 = _mm_loadu_si128((const __m128i*)(src16 + i * 2));
+		__m128i p1 = _mm_loadu_si128((const __m128i*)(src16 + i * 2 + 8));
+		// Sign-extend even pixels to 32 bits so signed pack keeps them intact
+		p0 = _mm_srai_epi32(_mm_slli_epi32(p0, 16), 16);
+		p1 = _mm_srai_epi32(_mm_slli_epi32(p1, 16), 16);
+		__m128i p = _mm_packs_epi32(p0, p1);
+		__m128i r = _mm_slli_epi16(p, 11);
+		__m128i g = _mm_and_si128(_mm_slli_epi16(p, 1), g_msk);
+		__m128i b = _mm_and_si128(_mm_srli_epi16(p, 10), b_msk);
+		_mm_storeu_si128((__m128i*)(dst16 + i), _mm_or_si128(r, _mm_or_si128(g, b)));
+	}
+#else
+	const uint16x8_t g_msk = vdupq_n_u16(0x07c0);
+	const uint16x8_t b_msk = vdupq_n_u16(0x001f);
+	for (int i = 0; i < 320; i += 8) {
+		uint16x8_t p = vld2q_u16(src16 + i * 2).val[0];
+		uint16x8_t r = vshlq_n_u16(p, 11);
+		uint16x8_t g = vandq_u16(vshlq_n_u16(p, 1), g_msk);
+		uint16x8_t b = vandq_u16(vshrq_n_u16(p, 10), b_msk);
+		vst1q_u16(dst16 + i, vorrq_u16(r, vorrq_u16(g, b)));
+	}
+#endif
+}
+
+#if defined(VOUT_USE_NEON) || defined(__SSSE3__)
+static void vout_simd_xmap_24(const void* restrict src, uint16_t* restrict dst16)
+{
+	vout_conv_24(src, vout_tmp_line, vout_src_count);
+	vout_apply_xmap(vout_tmp_line, dst16);
+}
+#endif
+#else
+#define VOUT_SIMD(fn) NULL
+#define VOUT_SIMD24(fn) NULL
+#endif // VOUT_USE_SSE2 || VOUT_USE_NEON
+
+struct vout_scaler {
+	uint16_t hres;
+	uint8_t  src_period;    // Pattern repeats every src_period source pixels..
+	uint8_t  dst_period;    // ..producing dst_period screen pixels
+	uint8_t  clip;          // Source pixels skipped at left edge
+	uint8_t  pattern[10];   // Source pixel of each screen pixel within period
+	vout_line_fn blit15, blit24;      // Fused scalar blitters
+	vout_line_fn simd15, simd24;      // SIMD blitters, if faster
+};
+
+static const struct vout_scaler vout_scalers[] = {
+	{ 256, 8, 10, 0, { 0, 1, 1, 2, 3, 4, 5, 5, 6, 7 }, WWDWW_15,     WWDWW_24,
+	  NULL,                        VOUT_SIMD24(vout_simd_xmap_24) },
+	{ 320, 1,  1, 0, { 0 },                            WW_15,        WW_24,
+	  VOUT_SIMD(vout_simd_320_15), VOUT_SIMD24(vout_simd_320_24) },
+	{ 368, 9,  8, 4, { 0, 1, 2, 3, 4, 5, 6, 7 },       WWWWWWWWS_15, WWWWWWWWS_24,
+	  NULL,                        VOUT_SIMD24(vout_simd_xmap_24) },
+	{ 384, 6,  5, 0, { 0, 1, 2, 3, 4 },                WWWWWS_15,    WWWWWS_24,
+	  NULL,                        VOUT_SIMD24(vout_simd_xmap_24) },
+	{ 512, 8,  5, 0, { 0, 1, 3, 4, 6 },                WWSWWSWS_15,  WWSWWSWS_24,
+	  NULL,                        NULL },
+	{ 640, 2,  1, 0, { 0 },                            WS_15,        WS_24,
+	  VOUT_SIMD(vout_simd_640_15), NULL },
+};
+
+static vout_line_fn vout_blit_line;
+static vout_copy_fn vout_copy_line = vout_copy_15;
+static int vout_blit_hres = -1, vout_blit_rgb24 = -1;
+
+// Select line blitter for display width 'hres' and depth. Sets
+//  vout_blit_line to NULL if width is not supported.
+static void vout_blit_select(int hres, int rgb24)
+{
+	const struct vout_scaler *sc = NULL;
+
+	vout_blit_hres = hres;
+	vout_blit_rgb24 = rgb24;
+	vout_blit_line = NULL;
+
+#if defined(VOUT_USE_SSE2) || defined(VOUT_USE_NEON)
+	vout_copy_line = rgb24 ? vout_conv_24 : vout_conv_15;
+#else
+	vout_copy_line = rgb24 ? vout_copy_24 : vout_copy_15;
+#endif
+
+	for (unsigned i = 0; i < sizeof(vout_scalers) / sizeof(vout_scalers[0]); i++) {
+		if (vout_scalers[i].hres == hres) {
+			sc = &vout_scalers[i];
+			break;
+		}
+	}
+	if (!sc)
+		return;
+
+	for (int x = 0; x < 320; x++)
+		vout_xmap[x] = sc->clip + (x / sc->dst_period) * sc->src_period +
+		               sc->pattern[x % sc->dst_period];
+	vout_src_count = vout_xmap[319] + 1;
+
+	if (rgb24)
+		vout_blit_line = sc->simd24 ? sc->simd24 : sc->blit24;
+	else
+		vout_blit_line = sc->simd15 ? sc->simd15 : sc->blit15;
+}
+
+#endif // GPULIB_VOUT_BLIT_H
@@ -15,416 +15,127 @@
 #include <psxcommon.h>
 #include "port.h"
 #include "gpu.h"
-
-///////////////////////////////////////////////////////////////////////////////
-// BLITTERS TAKEN FROM gpu_unai/gpu_blit.h
-// GPU Blitting code with rescale and interlace support.
-///////////////////////////////////////////////////////////////////////////////
-#ifndef USE_BGR15
-#define RGB24(R,G,B)	(((((R)&0xF8)<<8)|(((G)&0xFC)<<3)|(((B)&0xF8)>>3)))
-#define RGB16X2(C)		(((C)&(0x1f001f<<10))>>10) | (((C)&(0x1f001f<<5))<<1) | (((C)&(0x1f001f<<0))<<11)
-#define RGB16(C)		(((C)&(0x1f<<10))>>10) | (((C)&(0x1f<<5))<<1) | (((C)&(0x1f<<0))<<11)
-#else
-#define RGB24(R,G,B)  	((((R)&0xF8)>>3)|(((G)&0xF8)<<2)|(((B)&0xF8)<<7))
-#endif
-
-#ifdef USE_MEMCPY32
-static inline void *memcpy32 (void * restrict dest, const void * restrict src, size_t len)
+#include "plugin_lib.h"
+
+// Only re-blit display rows whose VRAM rows were written since the screen
+//  buffer being drawn to was last updated, and skip the flip entirely when
+//  nothing on display changed (see gpulib_mark_dirty())
+#define USE_VOUT_DIRTY_LINES
+
+#include "vout_blit.h"
+
+#ifdef USE_VOUT_DIRTY_LINES
+// SDL can flip between up to 3 screen buffers, each is tracked separately
+#define VOUT_BUFFERS 3
+
+struct vout_params {
+	int x, y, w, h, hres, vres;
+	int rgb24, scaling, ntsc_fix;
+};
+
+static struct vout_buffer {
+	uint16_t *pixels;
+	int valid;                     // Holds display area as of 'params'
+	struct vout_params params;
+	uint32_t dirty_lines[512 / 32];  // VRAM rows changed since last blit
+} vout_buffers[VOUT_BUFFERS];
+static int vout_buffer_next;
+static struct vout_buffer *vout_front;  // Last one flipped to display
+
+// Screen buffer contents were changed outside of vout_update()
+void vout_invalidate(void)
 {
-	uint32_t * restrict d = (uint32_t* restrict)dest;
-	const uint32_t * restrict s = (const uint32_t* restrict)src;
-	while (len--) {
-		*d++ = *s++;
-	}
-	return dest;
+	for (int i = 0; i < VOUT_BUFFERS; i++)
+		vout_buffers[i].valid = 0;
 }
-#define MEMCPY(d, s, l) memcpy32((d), (s), (l) >> 2)
-#else
-#define MEMCPY memcpy
-#endif
 
-static inline void GPU_BlitWW(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
+// Returns dirty-line bitmap for the screen buffer about to be blitted to,
+//  or NULL if it needs a full redraw
+static const uint32_t *vout_dirty_begin(struct vout_buffer **buf)
 {
-	uint32_t uCount;
-	if (!isRGB24)
-	{
-#ifndef USE_BGR15
-		uCount = 20;
-		const uint32_t* restrict src32 = (const uint32_t* restrict) src;
-		uint32_t* restrict dst32 = (uint32_t* restrict)(void*) dst16;
-		do {
-			dst32[0] = RGB16X2(src32[0]);
-			dst32[1] = RGB16X2(src32[1]);
-			dst32[2] = RGB16X2(src32[2]);
-			dst32[3] = RGB16X2(src32[3]);
-			dst32[4] = RGB16X2(src32[4]);
-			dst32[5] = RGB16X2(src32[5]);
-			dst32[6] = RGB16X2(src32[6]);
-			dst32[7] = RGB16X2(src32[7]);
-			dst32 += 8;
-			src32 += 8;
-		} while(--uCount);
-#else
-		MEMCPY(dst16, src, 640);
-#endif
-	} else
-	{
-		uCount = 20;
-		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
-		do{
-			dst16[ 0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
-			dst16[ 1] = RGB24(src8[ 3], src8[ 4], src8[ 5] );
-			dst16[ 2] = RGB24(src8[ 6], src8[ 7], src8[ 8] );
-			dst16[ 3] = RGB24(src8[ 9], src8[10], src8[11] );
-			dst16[ 4] = RGB24(src8[12], src8[13], src8[14] );
-			dst16[ 5] = RGB24(src8[15], src8[16], src8[17] );
-			dst16[ 6] = RGB24(src8[18], src8[19], src8[20] );
-			dst16[ 7] = RGB24(src8[21], src8[22], src8[23] );
-
-			dst16[ 8] = RGB24(src8[24], src8[25], src8[26] );
-			dst16[ 9] = RGB24(src8[27], src8[28], src8[29] );
-			dst16[10] = RGB24(src8[30], src8[31], src8[32] );
-			dst16[11] = RGB24(src8[33], src8[34], src8[35] );
-			dst16[12] = RGB24(src8[36], src8[37], src8[38] );
-			dst16[13] = RGB24(src8[39], src8[40], src8[41] );
-			dst16[14] = RGB24(src8[42], src8[43], src8[44] );
-			dst16[15] = RGB24(src8[45], src8[46], src8[47] );
-			dst16 += 16;
-			src8  += 48;
-		} while (--uCount);
+	struct vout_buffer *vb = NULL;
+	struct vout_params params;
+	int i, j;
+
+	// New VRAM writes are pending for every buffer
+	for (i = 0; i < VOUT_BUFFERS; i++)
+		for (j = 0; j < 512 / 32; j++)
+			vout_buffers[i].dirty_lines[j] |= gpu.state.dirty_lines[j];
+	memset(gpu.state.dirty_lines, 0, sizeof(gpu.state.dirty_lines));
+
+	for (i = 0; i < VOUT_BUFFERS; i++) {
+		if (vout_buffers[i].pixels == SCREEN) {
+			vb = &vout_buffers[i];
+			break;
+		}
 	}
-}
-
-static inline void GPU_BlitWWSWWSWS(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
-{
-	uint32_t uCount;
-	if (!isRGB24)
-	{
-#ifndef USE_BGR15
-		uCount = 64;
-		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
-		do {
-			dst16[0] = RGB16(src16[0]);
-			dst16[1] = RGB16(src16[1]);
-			dst16[2] = RGB16(src16[3]);
-			dst16[3] = RGB16(src16[4]);
-			dst16[4] = RGB16(src16[6]);
-			dst16 += 5;
-			src16 += 8;
-		} while (--uCount);
-#else
-		uCount = 64;
-		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
-		do {
-			dst16[0] = src16[0];
-			dst16[1] = src16[1];
-			dst16[2] = src16[3];
-			dst16[3] = src16[4];
-			dst16[4] = src16[6];
-			dst16 += 5;
-			src16 += 8;
-		} while (--uCount);
-#endif
-	} else
-	{
-		uCount = 32;
-		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
-		do {
-			dst16[ 0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
-			dst16[ 1] = RGB24(src8[ 3], src8[ 4], src8[ 5] );
-			dst16[ 2] = RGB24(src8[ 9], src8[10], src8[11] );
-			dst16[ 3] = RGB24(src8[12], src8[13], src8[14] );
-			dst16[ 4] = RGB24(src8[18], src8[19], src8[20] );
-
-			dst16[ 5] = RGB24(src8[24], src8[25], src8[26] );
-			dst16[ 6] = RGB24(src8[27], src8[28], src8[29] );
-			dst16[ 7] = RGB24(src8[33], src8[34], src8[35] );
-			dst16[ 8] = RGB24(src8[36], src8[37], src8[38] );
-			dst16[ 9] = RGB24(src8[42], src8[43], src8[44] );
-
-			dst16 += 10;
-			src8  += 48;
-		} while (--uCount);
+	if (!vb) {
+		vb = &vout_buffers[vout_buffer_next];
+		vout_buffer_next = (vout_buffer_next + 1) % VOUT_BUFFERS;
+		vb->pixels = SCREEN;
+		vb->valid = 0;
 	}
-}
-
-static inline void GPU_BlitWWWWWS(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
-{
-	uint32_t uCount;
-	if (!isRGB24)
-	{
-#ifndef USE_BGR15
-		uCount = 32;
-		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
-		do {
-			dst16[ 0] = RGB16(src16[0]);
-			dst16[ 1] = RGB16(src16[1]);
-			dst16[ 2] = RGB16(src16[2]);
-			dst16[ 3] = RGB16(src16[3]);
-			dst16[ 4] = RGB16(src16[4]);
-			dst16[ 5] = RGB16(src16[6]);
-			dst16[ 6] = RGB16(src16[7]);
-			dst16[ 7] = RGB16(src16[8]);
-			dst16[ 8] = RGB16(src16[9]);
-			dst16[ 9] = RGB16(src16[10]);
-			dst16 += 10;
-			src16 += 12;
-		} while (--uCount);
-#else
-		uCount = 64;
-		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
-		do {
-			MEMCPY(dst16, src16, 2 * 5);
-			dst16 += 5;
-			src16 += 6;
-		} while (--uCount);
-#endif
-	} else
-	{
-		uCount = 32;
-		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
-		do {
-			dst16[0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
-			dst16[1] = RGB24(src8[ 3], src8[ 4], src8[ 5] );
-			dst16[2] = RGB24(src8[ 6], src8[ 7], src8[ 8] );
-			dst16[3] = RGB24(src8[ 9], src8[10], src8[11] );
-			dst16[4] = RGB24(src8[12], src8[13], src8[14] );
-			dst16[5] = RGB24(src8[18], src8[19], src8[20] );
-			dst16[6] = RGB24(src8[21], src8[22], src8[23] );
-			dst16[7] = RGB24(src8[24], src8[25], src8[26] );
-			dst16[8] = RGB24(src8[27], src8[28], src8[29] );
-			dst16[9] = RGB24(src8[30], src8[31], src8[32] );
-			dst16 += 10;
-			src8  += 36;
-		} while (--uCount);
+	*buf = vb;
+
+	params.x = gpu.screen.x;
+	params.y = gpu.screen.y;
+	params.w = gpu.screen.w;
+	params.h = gpu.screen.h;
+	params.hres = gpu.screen.hres;
+	params.vres = gpu.screen.vres;
+	params.rgb24 = gpu.status.rgb24;
+	params.scaling = Config.VideoScaling;
+	params.ntsc_fix = gpu_unai_config_ext.ntsc_fix;
+	if (memcmp(&params, &vb->params, sizeof(params)) != 0) {
+		vb->params = params;
+		vb->valid = 0;
 	}
-}
 
-static inline void GPU_BlitWWWWWWWWS(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24, uint32_t uClip_src)
-{
-	uint32_t uCount;
-	if (!isRGB24)
-	{
-#ifndef USE_BGR15
-		uCount = 20;
-		const uint16_t* restrict src16 = ((const uint16_t* restrict) src) + uClip_src;
-		do {
-			dst16[ 0] = RGB16(src16[0]);
-			dst16[ 1] = RGB16(src16[1]);
-			dst16[ 2] = RGB16(src16[2]);
-			dst16[ 3] = RGB16(src16[3]);
-			dst16[ 4] = RGB16(src16[4]);
-			dst16[ 5] = RGB16(src16[5]);
-			dst16[ 6] = RGB16(src16[6]);
-			dst16[ 7] = RGB16(src16[7]);
-
-			dst16[ 8] = RGB16(src16[9]);
-			dst16[ 9] = RGB16(src16[10]);
-			dst16[10] = RGB16(src16[11]);
-			dst16[11] = RGB16(src16[12]);
-			dst16[12] = RGB16(src16[13]);
-			dst16[13] = RGB16(src16[14]);
-			dst16[14] = RGB16(src16[15]);
-			dst16[15] = RGB16(src16[16]);
-			dst16 += 16;
-			src16 += 18;
-		} while (--uCount);
-#else
-		uCount = 40;
-		const uint16_t* restrict src16 = ((const uint16_t* restrict) src) + uClip_src;
-		do {
-			MEMCPY(dst16, src16, 2 * 8);
-			dst16 += 8;
-			src16 += 9;
-		} while (--uCount);
-#endif
-	} else
-	{
-		uCount = 20;
-		const uint8_t* restrict src8 = (const uint8_t* restrict)src + (uClip_src<<1) + uClip_src;
-		do {
-			dst16[ 0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
-			dst16[ 1] = RGB24(src8[ 3], src8[ 4], src8[ 5] );
-			dst16[ 2] = RGB24(src8[ 6], src8[ 7], src8[ 8] );
-			dst16[ 3] = RGB24(src8[ 9], src8[10], src8[11] );
-			dst16[ 4] = RGB24(src8[12], src8[13], src8[14] );
-			dst16[ 5] = RGB24(src8[15], src8[16], src8[17] );
-			dst16[ 6] = RGB24(src8[18], src8[19], src8[20] );
-			dst16[ 7] = RGB24(src8[21], src8[22], src8[23] );
-
-			dst16[ 8] = RGB24(src8[27], src8[28], src8[29] );
-			dst16[ 9] = RGB24(src8[30], src8[31], src8[32] );
-			dst16[10] = RGB24(src8[33], src8[34], src8[35] );
-			dst16[11] = RGB24(src8[36], src8[37], src8[38] );
-			dst16[12] = RGB24(src8[39], src8[40], src8[41] );
-			dst16[13] = RGB24(src8[42], src8[43], src8[44] );
-			dst16[14] = RGB24(src8[45], src8[46], src8[47] );
-			dst16[15] = RGB24(src8[48], src8[49], src8[50] );
-			dst16 += 16;
-			src8  += 54;
-		} while (--uCount);
-	}
-}
+	// FPS overlay is drawn over the image. Rows wrapping around at right
+	//  edge of VRAM would also read the next row.
+	if (!vb->valid || Config.ShowFps ||
+	    params.x + (params.rgb24 ? params.hres * 3 / 2 : params.hres) > 1024)
+		return NULL;
 
-static inline void GPU_BlitWWDWW(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
-{
-	uint32_t uCount;
-	if (!isRGB24)
-	{
-#ifndef USE_BGR15
-		uCount = 32;
-		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
-		do {
-			dst16[ 0] = RGB16(src16[0]);
-			dst16[ 1] = RGB16(src16[1]);
-			dst16[ 2] = dst16[1];
-			dst16[ 3] = RGB16(src16[2]);
-			dst16[ 4] = RGB16(src16[3]);
-			dst16[ 5] = RGB16(src16[4]);
-			dst16[ 6] = RGB16(src16[5]);
-			dst16[ 7] = dst16[6];
-			dst16[ 8] = RGB16(src16[6]);
-			dst16[ 9] = RGB16(src16[7]);
-			dst16 += 10;
-			src16 +=  8;
-		} while (--uCount);
-#else
-		uCount = 64;
-		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
-		do {
-			*dst16++ = *src16++;
-			*dst16++ = *src16;
-			*dst16++ = *src16++;
-			*dst16++ = *src16++;
-			*dst16++ = *src16++;
-		} while (--uCount);
-#endif
-	} else
-	{
-		uCount = 32;
-		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
-		do {
-			dst16[ 0] = RGB24(src8[0], src8[ 1], src8[ 2] );
-			dst16[ 1] = RGB24(src8[3], src8[ 4], src8[ 5] );
-			dst16[ 2] = dst16[1];
-			dst16[ 3] = RGB24(src8[6], src8[ 7], src8[ 8] );
-			dst16[ 4] = RGB24(src8[9], src8[10], src8[11] );
-
-			dst16[ 5] = RGB24(src8[12], src8[13], src8[14] );
-			dst16[ 6] = RGB24(src8[15], src8[16], src8[17] );
-			dst16[ 7] = dst16[6];
-			dst16[ 8] = RGB24(src8[18], src8[19], src8[20] );
-			dst16[ 9] = RGB24(src8[21], src8[22], src8[23] );
-			dst16 += 10;
-			src8  += 24;
-		} while (--uCount);
-	}
+	return vb->dirty_lines;
 }
 
-
-static inline void GPU_BlitWS(const void* restrict src, uint16_t* restrict dst16, uint_fast8_t isRGB24)
+static void vout_dirty_end(struct vout_buffer *vb)
 {
-	uint32_t uCount;
-	if (!isRGB24) {
-#ifndef USE_BGR15
-		uCount = 20;
-		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
-		do {
-			dst16[ 0] = RGB16(src16[0]);
-			dst16[ 1] = RGB16(src16[2]);
-			dst16[ 2] = RGB16(src16[4]);
-			dst16[ 3] = RGB16(src16[6]);
-
-			dst16[ 4] = RGB16(src16[8]);
-			dst16[ 5] = RGB16(src16[10]);
-			dst16[ 6] = RGB16(src16[12]);
-			dst16[ 7] = RGB16(src16[14]);
-
-			dst16[ 8] = RGB16(src16[16]);
-			dst16[ 9] = RGB16(src16[18]);
-			dst16[10] = RGB16(src16[20]);
-			dst16[11] = RGB16(src16[22]);
-
-			dst16[12] = RGB16(src16[24]);
-			dst16[13] = RGB16(src16[26]);
-			dst16[14] = RGB16(src16[28]);
-			dst16[15] = RGB16(src16[30]);
-
-			dst16 += 16;
-			src16 += 32;
-		} while (--uCount);
-#else
-		uCount = 320;
-		const uint16_t* restrict src16 = (const uint16_t* restrict) src;
-		do {
-			*dst16++ = *src16;
-			src16 += 2;
-		} while (--uCount);
-#endif
-	} else
-	{
-		uCount = 20;
-		const uint8_t* restrict src8 = (const uint8_t* restrict) src;
-		do {
-			dst16[ 0] = RGB24(src8[ 0], src8[ 1], src8[ 2] );
-			dst16[ 1] = RGB24(src8[ 6], src8[ 7], src8[ 8] );
-			dst16[ 2] = RGB24(src8[12], src8[13], src8[14] );
-			dst16[ 3] = RGB24(src8[18], src8[19], src8[20] );
-
-			dst16[ 4] = RGB24(src8[24], src8[25], src8[26] );
-			dst16[ 5] = RGB24(src8[30], src8[31], src8[32] );
-			dst16[ 6] = RGB24(src8[36], src8[37], src8[38] );
-			dst16[ 7] = RGB24(src8[42], src8[43], src8[44] );
-
-			dst16[ 8] = RGB24(src8[48], src8[49], src8[50] );
-			dst16[ 9] = RGB24(src8[54], src8[55], src8[56] );
-			dst16[10] = RGB24(src8[60], src8[61], src8[62] );
-			dst16[11] = RGB24(src8[66], src8[67], src8[68] );
-
-			dst16[12] = RGB24(src8[72], src8[73], src8[74] );
-			dst16[13] = RGB24(src8[78], src8[79], src8[80] );
-			dst16[14] = RGB24(src8[84], src8[85], src8[86] );
-			dst16[15] = RGB24(src8[90], src8[91], src8[92] );
-
-			dst16 += 16;
-			src8  += 96;
-		} while(--uCount);
-	}
+	vb->valid = 1;
+	memset(vb->dirty_lines, 0, sizeof(vb->dirty_lines));
+	vout_front = vb;
 }
 
-
-static inline void GPU_BlitCopy(const void* restrict src, uint16_t* restrict dst16, int w, uint_fast8_t isRGB24)
+// Returns true if the displayed buffer already shows VRAM rows y..y+h-1
+//  (wrapping at 512) as they are now, so blit and flip can be skipped.
+//  Front buffer was blitted after the one we're about to draw to, so if
+//  no row changed for this one, none changed for the front buffer either.
+static int vout_unchanged(const uint32_t *dirty, const struct vout_buffer *vb, int y, int h)
 {
-	uint32_t uCount;
-	if (!isRGB24)
-	{
-#ifndef USE_BGR15
-		uCount = w / 2;
-		const uint32_t* restrict src32 = (const uint32_t* restrict) src;
-		uint32_t* restrict dst32 = (uint32_t* restrict)(void*) dst16;
-		do {
-			uint32_t s = *src32++;
-			*dst32++ = RGB16X2(s);
-		} while(--uCount);
-#else
-		MEMCPY(dst16, src, w * 2);
-#endif
-	} else
-	{
-		uCount = w;
-		const uint8_t* restrict src8 = (const uint8_t* restrict)src;
-		do{
-			*dst16++ = RGB24(src8[ 0], src8[ 1], src8[ 2] );
-			src8  += 3;
-		} while (--uCount);
+	const struct vout_buffer *front = vout_front;
+	if (!dirty || !front || !front->valid ||
+	    memcmp(&front->params, &vb->params, sizeof(vb->params)) != 0)
+		return 0;
+
+	for (; h > 0; y++, h--) {
+		y &= 511;
+		if (dirty[y >> 5] & (1u << (y & 31)))
+			return 0;
 	}
+	return 1;
 }
 
+#define ROW_CLEAN(offs) \
+	(dirty && !(dirty[((offs) >> 15) & 15] & (1u << (((offs) >> 10) & 31))))
+#else
+#define ROW_CLEAN(offs) 0
+#endif // USE_VOUT_DIRTY_LINES
 
 // Basically an adaption of old gpu_unai/gpu.cpp's gpuVideoOutput() that
 //  assumes 320x240 destination resolution (for now)
 // TODO: clean up / improve / add HW scaling support
-void vout_update(void)
+static void vout_update_screen(void)
 {
 	//Debugging:
 #if 0
@@ -451,7 +162,15 @@ void vout_update(void)
 	if (w0 == 0 || h0 == 0)
 		return;
 
+#ifdef USE_VOUT_DIRTY_LINES
+	struct vout_buffer *vb;
+	const uint32_t *dirty = vout_dirty_begin(&vb);
+#endif
+
 	uint_fast8_t isRGB24 = gpu.status.rgb24;
+	if (w0 != vout_blit_hres || isRGB24 != vout_blit_rgb24)
+		vout_blit_select(w0, isRGB24);
+
 	uint16_t* dst16 = SCREEN;
 	uint16_t* src16 = (uint16_t*)gpu.vram;
 
@@ -477,65 +196,27 @@ void vout_update(void)
 			dst16 += ((h0 - h1) >> sizeShift) * SCREEN_WIDTH;
 		}
 
+#ifdef USE_VOUT_DIRTY_LINES
+		if (vout_unchanged(dirty, vb, src16_offs >> 10, h1))
+			return;
+#endif
+
 		int incY = (h0 == 480) ? 2 : 1;
 		h0 = ((h0 == 480) ? 2048 : 1024);
 
-		switch (w0) {
-			case 256: {
-				for (int y1 = y0 + h1; y0 < y1; y0 += incY) {
-					GPU_BlitWWDWW(src16 + src16_offs, dst16, isRGB24);
-					dst16 += SCREEN_WIDTH;
-					src16_offs = (src16_offs + h0) & src16_offs_msk;
-				}
-			}
-				break;
-
-			case 368: {
-				for (int y1 = y0 + h1; y0 < y1; y0 += incY) {
-					GPU_BlitWWWWWWWWS(src16 + src16_offs, dst16, isRGB24, 4);
-					dst16 += SCREEN_WIDTH;
-					src16_offs = (src16_offs + h0) & src16_offs_msk;
-				}
-			}
-				break;
-
-			case 320: {
-				// Ensure 32-bit alignment for GPU_BlitWW() blitter:
-				src16_offs &= ~1;
-				for (int y1 = y0 + h1; y0 < y1; y0 += incY) {
-					GPU_BlitWW(src16 + src16_offs, dst16, isRGB24);
-					dst16 += SCREEN_WIDTH;
-					src16_offs = (src16_offs + h0) & src16_offs_msk;
-				}
-			}
-				break;
-
-			case 384: {
-				for (int y1 = y0 + h1; y0 < y1; y0 += incY) {
-					GPU_BlitWWWWWS(src16 + src16_offs, dst16, isRGB24);
-					dst16 += SCREEN_WIDTH;
-					src16_offs = (src16_offs + h0) & src16_offs_msk;
-				}
-			}
-				break;
-
-			case 512: {
-				for (int y1 = y0 + h1; y0 < y1; y0 += incY) {
-					GPU_BlitWWSWWSWS(src16 + src16_offs, dst16, isRGB24);
-					dst16 += SCREEN_WIDTH;
-					src16_offs = (src16_offs + h0) & src16_offs_msk;
-				}
-			}
-				break;
-
-			case 640: {
-				for (int y1 = y0 + h1; y0 < y1; y0 += incY) {
-					GPU_BlitWS(src16 + src16_offs, dst16, isRGB24);
-					dst16 += SCREEN_WIDTH;
-					src16_offs = (src16_offs + h0) & src16_offs_msk;
-				}
-			}
-				break;
+		// No blitter for unsupported widths: screen is left as is, but
+		//  still flipped below.
+		const vout_line_fn blit_line = vout_blit_line;
+
+		// Ensure 32-bit alignment for GPU_BlitWW() blitter:
+		if (w0 == 320)
+			src16_offs &= ~1;
+
+		for (int y1 = y0 + h1; blit_line && y0 < y1; y0 += incY) {
+			if (!ROW_CLEAN(src16_offs))
+				blit_line(src16 + src16_offs, dst16);
+			dst16 += SCREEN_WIDTH;
+			src16_offs = (src16_offs + h0) & src16_offs_msk;
 		}
 	} 
 #ifndef NO_HWSCALE
@@ -553,17 +234,38 @@ void vout_update(void)
 			dst16 += (w0 - w1) / 2;
 		}
 
+#ifdef USE_VOUT_DIRTY_LINES
+		if (vout_unchanged(dirty, vb, src16_offs >> 10, h1))
+			return;
+#endif
+
 		src16_offs &= ~1u;
 		for (int y1 = y0+h1; y0<y1; y0++) {
-			GPU_BlitCopy(src16+src16_offs, dst16, w1, isRGB24);
+			if (!ROW_CLEAN(src16_offs))
+				vout_copy_line(src16+src16_offs, dst16, w1);
 			dst16 += SCREEN_WIDTH;
 			src16_offs = (src16_offs+1024) & src16_offs_msk;
 		}
 	}
 #endif
+
+#ifdef USE_VOUT_DIRTY_LINES
+	vout_dirty_end(vb);
+#endif
 	video_flip();
 }
 
+void vout_update(void)
+{
+#ifdef USE_FMV_STATS
+	const unsigned start = pl_fmv_clock();
+	vout_update_screen();
+	pl_fmv_add(PL_FMV_VOUT, pl_fmv_clock() - start);
+#else
+	vout_update_screen();
+#endif
+}
+
 int vout_init(void)
 {
 	return 0;
@@ -582,3 +284,9 @@ void vout_blank(void)
 void vout_set_config(const struct gpulib_config_t *config)
 {
 }
+
+#ifndef USE_VOUT_DIRTY_LINES
+void vout_invalidate(void)
+{
+}
+#endif
@@ -36,21 +36,49 @@
 #define PARANOID_OVERFLOW_CHECKING
 #endif
 
+// Use SIMD for the 3x3 matrix-vector products and RTPT's three divides when
+//  the host has SSE4.1 or NEON. Results are bit-exact with the scalar code.
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#if defined(__SSE4_1__)
+#define GTE_USE_SSE4
+#include <smmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GTE_USE_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+// gte_nf.c builds this file a second time with FLAGLESS defined, producing
+//  gteXXX_nf() versions of all GTE commands that never update the FLAG reg.
+//  Callers that know FLAG is overwritten before being read can use those.
+#ifdef FLAGLESS
+#define gteRTPS  gteRTPS_nf
+#define gteOP    gteOP_nf
+#define gteNCLIP gteNCLIP_nf
+#define gteDPCS  gteDPCS_nf
+#define gteINTPL gteINTPL_nf
+#define gteMVMVA gteMVMVA_nf
+#define gteNCDS  gteNCDS_nf
+#define gteNCDT  gteNCDT_nf
+#define gteCDP   gteCDP_nf
+#define gteNCCS  gteNCCS_nf
+#define gteCC    gteCC_nf
+#define gteNCS   gteNCS_nf
+#define gteNCT   gteNCT_nf
+#define gteSQR   gteSQR_nf
+#define gteDCPL  gteDCPL_nf
+#define gteDPCT  gteDPCT_nf
+#define gteAVSZ3 gteAVSZ3_nf
+#define gteAVSZ4 gteAVSZ4_nf
+#define gteRTPT  gteRTPT_nf
+#define gteGPF   gteGPF_nf
+#define gteGPL   gteGPL_nf
+#define gteNCCT  gteNCCT_nf
+#endif
+
 #define VX(n) (n < 3 ? psxRegs.CP2D.p[n << 1].sw.l : psxRegs.CP2D.p[9].sw.l)
 #define VY(n) (n < 3 ? psxRegs.CP2D.p[n << 1].sw.h : psxRegs.CP2D.p[10].sw.l)
 #define VZ(n) (n < 3 ? psxRegs.CP2D.p[(n << 1) + 1].sw.l : psxRegs.CP2D.p[11].sw.l)
-#define MX11(n) (n < 3 ? psxRegs.CP2C.p[(n << 3)].sw.l : 0)
-#define MX12(n) (n < 3 ? psxRegs.CP2C.p[(n << 3)].sw.h : 0)
-#define MX13(n) (n < 3 ? psxRegs.CP2C.p[(n << 3) + 1].sw.l : 0)
-#define MX21(n) (n < 3 ? psxRegs.CP2C.p[(n << 3) + 1].sw.h : 0)
-#define MX22(n) (n < 3 ? psxRegs.CP2C.p[(n << 3) + 2].sw.l : 0)
-#define MX23(n) (n < 3 ? psxRegs.CP2C.p[(n << 3) + 2].sw.h : 0)
-#define MX31(n) (n < 3 ? psxRegs.CP2C.p[(n << 3) + 3].sw.l : 0)
-#define MX32(n) (n < 3 ? psxRegs.CP2C.p[(n << 3) + 3].sw.h : 0)
-#define MX33(n) (n < 3 ? psxRegs.CP2C.p[(n << 3) + 4].sw.l : 0)
-#define CV1(n) (n < 3 ? (int32_t)psxRegs.CP2C.r[(n << 3) + 5] : 0)
-#define CV2(n) (n < 3 ? (int32_t)psxRegs.CP2C.r[(n << 3) + 6] : 0)
-#define CV3(n) (n < 3 ? (int32_t)psxRegs.CP2C.r[(n << 3) + 7] : 0)
 
 #define fSX(n) ((psxRegs.CP2D.p)[((n) + 12)].sw.l)
 #define fSY(n) ((psxRegs.CP2D.p)[((n) + 12)].sw.h)
@@ -174,6 +202,14 @@
 #define gteZSF4 (psxRegs.CP2C.p[30].sw.l)
 #define gteFLAG (psxRegs.CP2C.r[31])
 
+// Matrix and translation vector operands of gteMulMatrix()
+#define gteRMatrix   (&psxRegs.CP2C.p[0])
+#define gteLMatrix   (&psxRegs.CP2C.p[8])
+#define gteLCMatrix  (&psxRegs.CP2C.p[16])
+#define gteTRVector  ((const int32_t *)&psxRegs.CP2C.r[5])
+#define gteBKVector  ((const int32_t *)&psxRegs.CP2C.r[13])
+#define gteFCVector  ((const int32_t *)&psxRegs.CP2C.r[21])
+
 // Some GTE instructions encode various parameters in their 32-bit opcode.
 //  Rather than passing the opcode value through the psxRegisters 'opcode'
 //  field, we pass it to GTE funcs as an argument *pre-shifted* right by 10
@@ -185,6 +221,7 @@
 #define GTE_CV(op) ((op >>  3)  & 3)
 #define GTE_LM(op) ((op >>  0)  & 1)
 
+#ifndef FLAGLESS
 //senquack-Don't try to optimize return value to int32_t like PCSX Rearmed did here:
 //it's why as of Nov. 2016, PC build has gfx glitches in 1st level of 'Driver'
 INLINE int64_t BOUNDS(int64_t n_value, int64_t n_max, int n_maxflag, int64_t n_min, int n_minflag) {
@@ -207,6 +244,16 @@ INLINE int32_t LIM(int32_t value, int32_t max, int32_t min, uint32_t flag) {
 	}
 	return ret;
 }
+#else
+// No-flags build: saturation still happens, but FLAG is left alone
+#define BOUNDS(n_value, n_max, n_maxflag, n_min, n_minflag) (n_value)
+
+INLINE int32_t LIM(int32_t value, int32_t max, int32_t min, uint32_t flag) {
+	if (value > max) return max;
+	if (value < min) return min;
+	return value;
+}
+#endif // FLAGLESS
 
 #define A1(a) BOUNDS((a), 0x7fffffff, (1 << 30), -(int64_t)0x80000000, (1 << 31) | (1 << 27))
 #define A2(a) BOUNDS((a), 0x7fffffff, (1 << 29), -(int64_t)0x80000000, (1 << 31) | (1 << 26))
@@ -221,7 +268,9 @@ INLINE int32_t LIM(int32_t value, int32_t max, int32_t min, uint32_t flag) {
 
 INLINE uint32_t limE(uint32_t result) {
 	if (result > 0x1ffff) {
+#ifndef FLAGLESS
 		gteFLAG |= (1 << 31) | (1 << 17);
+#endif
 		return 0x1ffff;
 	}
 
@@ -258,10 +307,60 @@ INLINE uint32_t DIVIDE(uint16_t n, uint16_t d) {
 	}
 	return 0xffffffff;
 }
+
+INLINE void DIVIDE3(uint32_t *q, uint16_t n, const uint16_t *d) {
+	q[0] = DIVIDE(n, d[0]);
+	q[1] = DIVIDE(n, d[1]);
+	q[2] = DIVIDE(n, d[2]);
+}
 #else
 #include "gte_divide.h"
 #endif // GTE_USE_NATIVE_DIVIDE
 
+// Multiply 3x3 matrix 'm' (first of the five CP2C pairs holding it) by vector
+//  (vx,vy,vz), adding translation vector 't' shifted left 12 (if not NULL).
+//  Vector components must be in int16_t range. Each 16x16 product fits in 32
+//  bits, but their sum does not, so sums are 64-bit like the scalar code.
+INLINE void gteMulMatrix(int64_t *mac, const PAIR *m, const int32_t *t,
+                         int32_t vx, int32_t vy, int32_t vz) {
+#if defined(GTE_USE_SSE4)
+	const int16_t *m16 = (const int16_t *)m;
+	__m128i p0 = _mm_mullo_epi32(_mm_setr_epi32(m16[0], m16[3], m16[6], 0), _mm_set1_epi32(vx));
+	__m128i p1 = _mm_mullo_epi32(_mm_setr_epi32(m16[1], m16[4], m16[7], 0), _mm_set1_epi32(vy));
+	__m128i p2 = _mm_mullo_epi32(_mm_setr_epi32(m16[2], m16[5], m16[8], 0), _mm_set1_epi32(vz));
+	__m128i lo = _mm_add_epi64(_mm_add_epi64(_mm_cvtepi32_epi64(p0), _mm_cvtepi32_epi64(p1)),
+	                           _mm_cvtepi32_epi64(p2));
+	__m128i hi = _mm_add_epi64(_mm_add_epi64(_mm_cvtepi32_epi64(_mm_srli_si128(p0, 8)),
+	                                         _mm_cvtepi32_epi64(_mm_srli_si128(p1, 8))),
+	                           _mm_cvtepi32_epi64(_mm_srli_si128(p2, 8)));
+	_mm_storeu_si128((__m128i *)mac, lo);
+	_mm_storel_epi64((__m128i *)(mac + 2), hi);
+#elif defined(GTE_USE_NEON)
+	const int16_t *m16 = (const int16_t *)m;
+	const int16_t c0[4] = { m16[0], m16[3], m16[6], 0 };
+	const int16_t c1[4] = { m16[1], m16[4], m16[7], 0 };
+	const int16_t c2[4] = { m16[2], m16[5], m16[8], 0 };
+	int32x4_t p0 = vmull_n_s16(vld1_s16(c0), (int16_t)vx);
+	int32x4_t p1 = vmull_n_s16(vld1_s16(c1), (int16_t)vy);
+	int32x4_t p2 = vmull_n_s16(vld1_s16(c2), (int16_t)vz);
+	int64x2_t lo = vaddw_s32(vaddl_s32(vget_low_s32(p0), vget_low_s32(p1)), vget_low_s32(p2));
+	int64x2_t hi = vaddw_s32(vaddl_s32(vget_high_s32(p0), vget_high_s32(p1)), vget_high_s32(p2));
+	vst1q_s64(mac, lo);
+	mac[2] = vgetq_lane_s64(hi, 0);
+#else
+	mac[0] = (int64_t)(m[0].sw.l * vx) + (m[0].sw.h * vy) + (m[1].sw.l * vz);
+	mac[1] = (int64_t)(m[1].sw.h * vx) + (m[2].sw.l * vy) + (m[2].sw.h * vz);
+	mac[2] = (int64_t)(m[3].sw.l * vx) + (m[3].sw.h * vy) + (m[4].sw.l * vz);
+#endif
+	if (t) {
+		mac[0] += (int64_t)t[0] << 12;
+		mac[1] += (int64_t)t[1] << 12;
+		mac[2] += (int64_t)t[2] << 12;
+	}
+}
+
+#ifndef FLAGLESS
+
 //senquack - Applied fixes from PCSX Rearmed 7384197d8a5fd20a4d94f3517a6462f7fe86dd4c
 // Case 28 now falls through to case 29, and don't return 0 for case 30
 // Fixes main menu freeze in 'Lego Racers'
@@ -398,9 +497,11 @@ void gteSWC2(void) {
 	//psxRegs.cycle += 1;
 	psxMemWrite32(_oB_, gtecalcMFC2(_Rt_));
 }
+#endif // !FLAGLESS
 
 void gteRTPS(void) {
 	int quotient;
+	int64_t mac[3];
 
 #ifdef GTE_LOG
 	GTE_LOG("GTE RTPS\n");
@@ -408,9 +509,10 @@ void gteRTPS(void) {
 	psxRegs.cycle += 15;
 	gteFLAG = 0;
 
-	gteMAC1 = A1((((int64_t)gteTRX << 12) + (gteR11 * gteVX0) + (gteR12 * gteVY0) + (gteR13 * gteVZ0)) >> 12);
-	gteMAC2 = A2((((int64_t)gteTRY << 12) + (gteR21 * gteVX0) + (gteR22 * gteVY0) + (gteR23 * gteVZ0)) >> 12);
-	gteMAC3 = A3((((int64_t)gteTRZ << 12) + (gteR31 * gteVX0) + (gteR32 * gteVY0) + (gteR33 * gteVZ0)) >> 12);
+	gteMulMatrix(mac, gteRMatrix, gteTRVector, gteVX0, gteVY0, gteVZ0);
+	gteMAC1 = A1(mac[0] >> 12);
+	gteMAC2 = A2(mac[1] >> 12);
+	gteMAC3 = A3(mac[2] >> 12);
 	gteIR1 = limB1(gteMAC1, 0);
 	gteIR2 = limB2(gteMAC2, 0);
 	gteIR3 = limB3(gteMAC3, 0);
@@ -436,7 +538,10 @@ void gteRTPS(void) {
 void gteRTPT(void) {
 	int quotient;
 	int v;
-	int32_t vx, vy, vz;
+	int64_t mac[3];
+	int32_t ir1[3], ir2[3];
+	uint16_t sz[3];
+	uint32_t q[3];
 
 #ifdef GTE_LOG
 	GTE_LOG("GTE RTPT\n");
@@ -444,21 +549,26 @@ void gteRTPT(void) {
 	psxRegs.cycle += 23;
 	gteFLAG = 0;
 
+	// Vertices are independent of each other, so transform all three first,
+	//  then do the three perspective divides together.
 	gteSZ0 = gteSZ3;
 	for (v = 0; v < 3; v++) {
-		vx = VX(v);
-		vy = VY(v);
-		vz = VZ(v);
-		gteMAC1 = A1((((int64_t)gteTRX << 12) + (gteR11 * vx) + (gteR12 * vy) + (gteR13 * vz)) >> 12);
-		gteMAC2 = A2((((int64_t)gteTRY << 12) + (gteR21 * vx) + (gteR22 * vy) + (gteR23 * vz)) >> 12);
-		gteMAC3 = A3((((int64_t)gteTRZ << 12) + (gteR31 * vx) + (gteR32 * vy) + (gteR33 * vz)) >> 12);
-		gteIR1 = limB1(gteMAC1, 0);
-		gteIR2 = limB2(gteMAC2, 0);
+		gteMulMatrix(mac, gteRMatrix, gteTRVector, VX(v), VY(v), VZ(v));
+		gteMAC1 = A1(mac[0] >> 12);
+		gteMAC2 = A2(mac[1] >> 12);
+		gteMAC3 = A3(mac[2] >> 12);
+		ir1[v] = gteIR1 = limB1(gteMAC1, 0);
+		ir2[v] = gteIR2 = limB2(gteMAC2, 0);
 		gteIR3 = limB3(gteMAC3, 0);
-		fSZ(v) = limD(gteMAC3);
-		quotient = limE(DIVIDE(gteH, fSZ(v)));
-		fSX(v) = limG1(F((int64_t)gteOFX + ((int64_t)gteIR1 * quotient)) >> 16);
-		fSY(v) = limG2(F((int64_t)gteOFY + ((int64_t)gteIR2 * quotient)) >> 16);
+		sz[v] = fSZ(v) = limD(gteMAC3);
+	}
+
+	DIVIDE3(q, gteH, sz);
+
+	for (v = 0; v < 3; v++) {
+		quotient = limE(q[v]);
+		fSX(v) = limG1(F((int64_t)gteOFX + ((int64_t)ir1[v] * quotient)) >> 16);
+		fSY(v) = limG2(F((int64_t)gteOFY + ((int64_t)ir2[v] * quotient)) >> 16);
 	}
 
 	// See note in gteRTPS()
@@ -474,9 +584,8 @@ void gteMVMVA(uint32_t gteop) {
 	int v = GTE_V(gteop);
 	int cv = GTE_CV(gteop);
 	int lm = GTE_LM(gteop);
-	int32_t vx = VX(v);
-	int32_t vy = VY(v);
-	int32_t vz = VZ(v);
+	static const PAIR zero_matrix[5];
+	int64_t mac[3];
 
 #ifdef GTE_LOG
 	GTE_LOG("GTE MVMVA\n");
@@ -484,9 +593,13 @@ void gteMVMVA(uint32_t gteop) {
 	psxRegs.cycle += 8;
 	gteFLAG = 0;
 
-	gteMAC1 = A1((((int64_t)CV1(cv) << 12) + (MX11(mx) * vx) + (MX12(mx) * vy) + (MX13(mx) * vz)) >> shift);
-	gteMAC2 = A2((((int64_t)CV2(cv) << 12) + (MX21(mx) * vx) + (MX22(mx) * vy) + (MX23(mx) * vz)) >> shift);
-	gteMAC3 = A3((((int64_t)CV3(cv) << 12) + (MX31(mx) * vx) + (MX32(mx) * vy) + (MX33(mx) * vz)) >> shift);
+	gteMulMatrix(mac,
+	             mx < 3 ? &psxRegs.CP2C.p[mx << 3] : zero_matrix,
+	             cv < 3 ? (const int32_t *)&psxRegs.CP2C.r[(cv << 3) + 5] : NULL,
+	             VX(v), VY(v), VZ(v));
+	gteMAC1 = A1(mac[0] >> shift);
+	gteMAC2 = A2(mac[1] >> shift);
+	gteMAC3 = A3(mac[2] >> shift);
 
 	gteIR1 = limB1(gteMAC1, lm);
 	gteIR2 = limB2(gteMAC2, lm);
@@ -547,21 +660,25 @@ void gteSQR(uint32_t gteop) {
 }
 
 void gteNCCS(void) {
+	int64_t mac[3];
+
 #ifdef GTE_LOG
 	GTE_LOG("GTE NCCS\n");
 #endif
 	psxRegs.cycle += 17;
 	gteFLAG = 0;
 
-	gteMAC1 = ((int64_t)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
-	gteMAC2 = ((int64_t)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
-	gteMAC3 = ((int64_t)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
+	gteMulMatrix(mac, gteLMatrix, NULL, gteVX0, gteVY0, gteVZ0);
+	gteMAC1 = mac[0] >> 12;
+	gteMAC2 = mac[1] >> 12;
+	gteMAC3 = mac[2] >> 12;
 	gteIR1 = limB1(gteMAC1, 1);
 	gteIR2 = limB2(gteMAC2, 1);
 	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = A1((((int64_t)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((int64_t)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((int64_t)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteMulMatrix(mac, gteLCMatrix, gteBKVector, gteIR1, gteIR2, gteIR3);
+	gteMAC1 = A1(mac[0] >> 12);
+	gteMAC2 = A2(mac[1] >> 12);
+	gteMAC3 = A3(mac[2] >> 12);
 	gteIR1 = limB1(gteMAC1, 1);
 	gteIR2 = limB2(gteMAC2, 1);
 	gteIR3 = limB3(gteMAC3, 1);
@@ -582,7 +699,7 @@ void gteNCCS(void) {
 
 void gteNCCT(void) {
 	int v;
-	int32_t vx, vy, vz;
+	int64_t mac[3];
 
 #ifdef GTE_LOG
 	GTE_LOG("GTE NCCT\n");
@@ -591,18 +708,17 @@ void gteNCCT(void) {
 	gteFLAG = 0;
 
 	for (v = 0; v < 3; v++) {
-		vx = VX(v);
-		vy = VY(v);
-		vz = VZ(v);
-		gteMAC1 = ((int64_t)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
-		gteMAC2 = ((int64_t)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
-		gteMAC3 = ((int64_t)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
+		gteMulMatrix(mac, gteLMatrix, NULL, VX(v), VY(v), VZ(v));
+		gteMAC1 = mac[0] >> 12;
+		gteMAC2 = mac[1] >> 12;
+		gteMAC3 = mac[2] >> 12;
 		gteIR1 = limB1(gteMAC1, 1);
 		gteIR2 = limB2(gteMAC2, 1);
 		gteIR3 = limB3(gteMAC3, 1);
-		gteMAC1 = A1((((int64_t)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-		gteMAC2 = A2((((int64_t)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-		gteMAC3 = A3((((int64_t)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+		gteMulMatrix(mac, gteLCMatrix, gteBKVector, gteIR1, gteIR2, gteIR3);
+		gteMAC1 = A1(mac[0] >> 12);
+		gteMAC2 = A2(mac[1] >> 12);
+		gteMAC3 = A3(mac[2] >> 12);
 		gteIR1 = limB1(gteMAC1, 1);
 		gteIR2 = limB2(gteMAC2, 1);
 		gteIR3 = limB3(gteMAC3, 1);
@@ -623,21 +739,25 @@ void gteNCCT(void) {
 }
 
 void gteNCDS(void) {
+	int64_t mac[3];
+
 #ifdef GTE_LOG
 	GTE_LOG("GTE NCDS\n");
 #endif
 	psxRegs.cycle += 19;
 	gteFLAG = 0;
 
-	gteMAC1 = ((int64_t)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
-	gteMAC2 = ((int64_t)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
-	gteMAC3 = ((int64_t)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
+	gteMulMatrix(mac, gteLMatrix, NULL, gteVX0, gteVY0, gteVZ0);
+	gteMAC1 = mac[0] >> 12;
+	gteMAC2 = mac[1] >> 12;
+	gteMAC3 = mac[2] >> 12;
 	gteIR1 = limB1(gteMAC1, 1);
 	gteIR2 = limB2(gteMAC2, 1);
 	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = A1((((int64_t)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((int64_t)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((int64_t)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteMulMatrix(mac, gteLCMatrix, gteBKVector, gteIR1, gteIR2, gteIR3);
+	gteMAC1 = A1(mac[0] >> 12);
+	gteMAC2 = A2(mac[1] >> 12);
+	gteMAC3 = A3(mac[2] >> 12);
 	gteIR1 = limB1(gteMAC1, 1);
 	gteIR2 = limB2(gteMAC2, 1);
 	gteIR3 = limB3(gteMAC3, 1);
@@ -658,7 +778,7 @@ void gteNCDS(void) {
 
 void gteNCDT(void) {
 	int v;
-	int32_t vx, vy, vz;
+	int64_t mac[3];
 
 #ifdef GTE_LOG
 	GTE_LOG("GTE NCDT\n");
@@ -667,18 +787,17 @@ void gteNCDT(void) {
 	gteFLAG = 0;
 
 	for (v = 0; v < 3; v++) {
-		vx = VX(v);
-		vy = VY(v);
-		vz = VZ(v);
-		gteMAC1 = ((int64_t)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
-		gteMAC2 = ((int64_t)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
-		gteMAC3 = ((int64_t)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
+		gteMulMatrix(mac, gteLMatrix, NULL, VX(v), VY(v), VZ(v));
+		gteMAC1 = mac[0] >> 12;
+		gteMAC2 = mac[1] >> 12;
+		gteMAC3 = mac[2] >> 12;
 		gteIR1 = limB1(gteMAC1, 1);
 		gteIR2 = limB2(gteMAC2, 1);
 		gteIR3 = limB3(gteMAC3, 1);
-		gteMAC1 = A1((((int64_t)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-		gteMAC2 = A2((((int64_t)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-		gteMAC3 = A3((((int64_t)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+		gteMulMatrix(mac, gteLCMatrix, gteBKVector, gteIR1, gteIR2, gteIR3);
+		gteMAC1 = A1(mac[0] >> 12);
+		gteMAC2 = A2(mac[1] >> 12);
+		gteMAC3 = A3(mac[2] >> 12);
 		gteIR1 = limB1(gteMAC1, 1);
 		gteIR2 = limB2(gteMAC2, 1);
 		gteIR3 = limB3(gteMAC3, 1);
@@ -831,6 +950,51 @@ void gteDPCT(void) {
 	psxRegs.cycle += 17;
 	gteFLAG = 0;
 
+#if defined(FLAGLESS) && (defined(GTE_USE_SSE4) || defined(GTE_USE_NEON))
+	// With no flags to keep, each colour's three channels are done together.
+	//  Each pass depth-cues the oldest entry of the RGB FIFO, i.e. RGB0,
+	//  RGB1, RGB2 of the FIFO as it was on entry.
+	{
+		uint32_t rgb[3] = { gteRGB0, gteRGB1, gteRGB2 };
+		uint32_t code = (uint32_t)gteCODE << 24;
+		int32_t mac[4];
+#if defined(GTE_USE_SSE4)
+		__m128i fc = _mm_setr_epi32(gteRFC, gteGFC, gteBFC, 0);
+		__m128i ir0 = _mm_set1_epi32(gteIR0);
+		__m128i m = _mm_setzero_si128();
+		for (v = 0; v < 3; v++) {
+			__m128i c = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(rgb[v]));
+			__m128i d = _mm_sub_epi32(fc, _mm_slli_epi32(c, 4));
+			d = _mm_max_epi32(_mm_min_epi32(d, _mm_set1_epi32(0x7fff)), _mm_set1_epi32(-0x8000));
+			m = _mm_srai_epi32(_mm_add_epi32(_mm_slli_epi32(c, 16), _mm_mullo_epi32(ir0, d)), 12);
+			__m128i out = _mm_srai_epi32(m, 4);
+			out = _mm_packus_epi16(_mm_packs_epi32(out, out), _mm_setzero_si128());
+			rgb[v] = ((uint32_t)_mm_cvtsi128_si32(out) & 0xffffff) | code;
+		}
+		_mm_storeu_si128((__m128i *)mac, m);
+#else
+		const int32_t fc_[4] = { gteRFC, gteGFC, gteBFC, 0 };
+		int32x4_t fc = vld1q_s32(fc_);
+		int32x4_t m = vdupq_n_s32(0);
+		for (v = 0; v < 3; v++) {
+			int32x4_t c = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(vmovl_u8(
+			                  vreinterpret_u8_u32(vdup_n_u32(rgb[v]))))));
+			int32x4_t d = vsubq_s32(fc, vshlq_n_s32(c, 4));
+			d = vmaxq_s32(vminq_s32(d, vdupq_n_s32(0x7fff)), vdupq_n_s32(-0x8000));
+			m = vshrq_n_s32(vmlaq_n_s32(vshlq_n_s32(c, 16), d, gteIR0), 12);
+			uint8x8_t out = vqmovn_u16(vcombine_u16(vqmovun_s32(vshrq_n_s32(m, 4)), vdup_n_u16(0)));
+			rgb[v] = (vget_lane_u32(vreinterpret_u32_u8(out), 0) & 0xffffff) | code;
+		}
+		vst1q_s32(mac, m);
+#endif
+		gteRGB0 = rgb[0];
+		gteRGB1 = rgb[1];
+		gteRGB2 = rgb[2];
+		gteMAC1 = mac[0];
+		gteMAC2 = mac[1];
+		gteMAC3 = mac[2];
+	}
+#else
 	for (v = 0; v < 3; v++) {
 		gteMAC1 = ((gteR0 << 16) + (gteIR0 * limB1(A1U((int64_t)gteRFC - (gteR0 << 4)), 0))) >> 12;
 		gteMAC2 = ((gteG0 << 16) + (gteIR0 * limB1(A2U((int64_t)gteGFC - (gteG0 << 4)), 0))) >> 12;
@@ -843,27 +1007,32 @@ void gteDPCT(void) {
 		gteG2 = limC2(gteMAC2 >> 4);
 		gteB2 = limC3(gteMAC3 >> 4);
 	}
+#endif
 	gteIR1 = limB1(gteMAC1, 0);
 	gteIR2 = limB2(gteMAC2, 0);
 	gteIR3 = limB3(gteMAC3, 0);
 }
 
 void gteNCS(void) {
+	int64_t mac[3];
+
 #ifdef GTE_LOG
 	GTE_LOG("GTE NCS\n");
 #endif
 	psxRegs.cycle += 14;
 	gteFLAG = 0;
 
-	gteMAC1 = ((int64_t)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
-	gteMAC2 = ((int64_t)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
-	gteMAC3 = ((int64_t)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
+	gteMulMatrix(mac, gteLMatrix, NULL, gteVX0, gteVY0, gteVZ0);
+	gteMAC1 = mac[0] >> 12;
+	gteMAC2 = mac[1] >> 12;
+	gteMAC3 = mac[2] >> 12;
 	gteIR1 = limB1(gteMAC1, 1);
 	gteIR2 = limB2(gteMAC2, 1);
 	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = A1((((int64_t)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((int64_t)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((int64_t)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteMulMatrix(mac, gteLCMatrix, gteBKVector, gteIR1, gteIR2, gteIR3);
+	gteMAC1 = A1(mac[0] >> 12);
+	gteMAC2 = A2(mac[1] >> 12);
+	gteMAC3 = A3(mac[2] >> 12);
 	gteIR1 = limB1(gteMAC1, 1);
 	gteIR2 = limB2(gteMAC2, 1);
 	gteIR3 = limB3(gteMAC3, 1);
@@ -878,7 +1047,7 @@ void gteNCS(void) {
 
 void gteNCT(void) {
 	int v;
-	int32_t vx, vy, vz;
+	int64_t mac[3];
 
 #ifdef GTE_LOG
 	GTE_LOG("GTE NCT\n");
@@ -887,18 +1056,17 @@ void gteNCT(void) {
 	gteFLAG = 0;
 
 	for (v = 0; v < 3; v++) {
-		vx = VX(v);
-		vy = VY(v);
-		vz = VZ(v);
-		gteMAC1 = ((int64_t)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
-		gteMAC2 = ((int64_t)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
-		gteMAC3 = ((int64_t)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
+		gteMulMatrix(mac, gteLMatrix, NULL, VX(v), VY(v), VZ(v));
+		gteMAC1 = mac[0] >> 12;
+		gteMAC2 = mac[1] >> 12;
+		gteMAC3 = mac[2] >> 12;
 		gteIR1 = limB1(gteMAC1, 1);
 		gteIR2 = limB2(gteMAC2, 1);
 		gteIR3 = limB3(gteMAC3, 1);
-		gteMAC1 = A1((((int64_t)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-		gteMAC2 = A2((((int64_t)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-		gteMAC3 = A3((((int64_t)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+		gteMulMatrix(mac, gteLCMatrix, gteBKVector, gteIR1, gteIR2, gteIR3);
+		gteMAC1 = A1(mac[0] >> 12);
+		gteMAC2 = A2(mac[1] >> 12);
+		gteMAC3 = A3(mac[2] >> 12);
 		gteRGB0 = gteRGB1;
 		gteRGB1 = gteRGB2;
 		gteCODE2 = gteCODE;
@@ -912,15 +1080,18 @@ void gteNCT(void) {
 }
 
 void gteCC(void) {
+	int64_t mac[3];
+
 #ifdef GTE_LOG
 	GTE_LOG("GTE CC\n");
 #endif
 	psxRegs.cycle += 11;
 	gteFLAG = 0;
 
-	gteMAC1 = A1((((int64_t)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((int64_t)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((int64_t)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteMulMatrix(mac, gteLCMatrix, gteBKVector, gteIR1, gteIR2, gteIR3);
+	gteMAC1 = A1(mac[0] >> 12);
+	gteMAC2 = A2(mac[1] >> 12);
+	gteMAC3 = A3(mac[2] >> 12);
 	gteIR1 = limB1(gteMAC1, 1);
 	gteIR2 = limB2(gteMAC2, 1);
 	gteIR3 = limB3(gteMAC3, 1);
@@ -965,15 +1136,18 @@ void gteINTPL(uint32_t gteop) {
 }
 
 void gteCDP(void) {
+	int64_t mac[3];
+
 #ifdef GTE_LOG
 	GTE_LOG("GTE CDP\n");
 #endif
 	psxRegs.cycle += 13;
 	gteFLAG = 0;
 
-	gteMAC1 = A1((((int64_t)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((int64_t)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((int64_t)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteMulMatrix(mac, gteLCMatrix, gteBKVector, gteIR1, gteIR2, gteIR3);
+	gteMAC1 = A1(mac[0] >> 12);
+	gteMAC2 = A2(mac[1] >> 12);
+	gteMAC3 = A3(mac[2] >> 12);
 	gteIR1 = limB1(gteMAC1, 1);
 	gteIR2 = limB2(gteMAC2, 1);
 	gteIR3 = limB3(gteMAC3, 1);
@@ -54,6 +54,30 @@ void gteGPF(uint32_t gteop);
 void gteGPL(uint32_t gteop);
 void gteNCCT(void);
 
+// Same as above, but FLAG is not computed (gte_nf.c)
+void gteRTPS_nf(void);
+void gteOP_nf(uint32_t gteop);
+void gteNCLIP_nf(void);
+void gteDPCS_nf(uint32_t gteop);
+void gteINTPL_nf(uint32_t gteop);
+void gteMVMVA_nf(uint32_t gteop);
+void gteNCDS_nf(void);
+void gteNCDT_nf(void);
+void gteCDP_nf(void);
+void gteNCCS_nf(void);
+void gteCC_nf(void);
+void gteNCS_nf(void);
+void gteNCT_nf(void);
+void gteSQR_nf(uint32_t gteop);
+void gteDCPL_nf(uint32_t gteop);
+void gteDPCT_nf(void);
+void gteAVSZ3_nf(void);
+void gteAVSZ4_nf(void);
+void gteRTPT_nf(void);
+void gteGPF_nf(uint32_t gteop);
+void gteGPL_nf(uint32_t gteop);
+void gteNCCT_nf(void);
+
 // for the recompiler
 uint32_t gtecalcMFC2(int reg);
 void gtecalcMTC2(uint32_t value, int reg);
@@ -36,7 +36,7 @@ static const uint8_t table[] =
 	0x00
 };
 
-uint32_t DIVIDE(uint16_t numerator, uint16_t denominator)
+INLINE uint32_t DIVIDE(uint16_t numerator, uint16_t denominator)
 {
 	if (numerator < (denominator * 2)) {
 		int32_t shift = __builtin_clz(denominator) - 16;
@@ -52,4 +52,58 @@ uint32_t DIVIDE(uint16_t numerator, uint16_t denominator)
 	return 0xffffffff;
 }
 
+// Three divides by the same numerator, as done by RTPT. The table lookups stay
+//  scalar, the Newton-Raphson step and final multiply are done for all three
+//  denominators at once when SIMD is available.
+INLINE void DIVIDE3(uint32_t *q, uint16_t numerator, const uint16_t *denominator)
+{
+#if defined(GTE_USE_SSE4) || defined(GTE_USE_NEON)
+	int32_t r1[4] = { 0, 0, 0, 0 }, r2[4] = { 0, 0, 0, 0 };
+	uint32_t n[4] = { 0, 0, 0, 0 }, res[4];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		if (numerator < (denominator[i] * 2)) {
+			int32_t shift = __builtin_clz(denominator[i]) - 16;
+			r1[i] = (denominator[i] << shift) & 0x7fff;
+			r2[i] = table[(r1[i] + 0x40) >> 7] + 0x101;
+			n[i] = numerator << shift;
+		}
+	}
+
+#if defined(GTE_USE_SSE4)
+	__m128i vr1 = _mm_loadu_si128((const __m128i *)r1);
+	__m128i vr2 = _mm_loadu_si128((const __m128i *)r2);
+	__m128i vn  = _mm_loadu_si128((const __m128i *)n);
+	__m128i r3 = _mm_and_si128(_mm_srai_epi32(_mm_sub_epi32(_mm_set1_epi32(0x80),
+	                 _mm_mullo_epi32(vr2, _mm_add_epi32(vr1, _mm_set1_epi32(0x8000)))), 8),
+	                 _mm_set1_epi32(0x1ffff));
+	__m128i rcp = _mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(vr2, r3), _mm_set1_epi32(0x80)), 8);
+	__m128i round = _mm_set_epi32(0, 0x8000, 0, 0x8000);
+	__m128i even = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(rcp, vn), round), 16);
+	__m128i odd  = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(rcp, 32),
+	                                                          _mm_srli_epi64(vn, 32)), round), 16);
+	_mm_storeu_si128((__m128i *)res, _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xcc));
+#else
+	int32x4_t vr1 = vld1q_s32(r1);
+	int32x4_t vr2 = vld1q_s32(r2);
+	uint32x4_t vn = vld1q_u32(n);
+	int32x4_t r3 = vandq_s32(vshrq_n_s32(vsubq_s32(vdupq_n_s32(0x80),
+	                   vmulq_s32(vr2, vaddq_s32(vr1, vdupq_n_s32(0x8000)))), 8),
+	                   vdupq_n_s32(0x1ffff));
+	uint32x4_t rcp = vshrq_n_u32(vreinterpretq_u32_s32(vaddq_s32(vmulq_s32(vr2, r3), vdupq_n_s32(0x80))), 8);
+	uint64x2_t lo = vshrq_n_u64(vmlal_u32(vdupq_n_u64(0x8000), vget_low_u32(rcp), vget_low_u32(vn)), 16);
+	uint64x2_t hi = vshrq_n_u64(vmlal_u32(vdupq_n_u64(0x8000), vget_high_u32(rcp), vget_high_u32(vn)), 16);
+	vst1q_u32(res, vcombine_u32(vmovn_u64(lo), vmovn_u64(hi)));
+#endif
+
+	for (i = 0; i < 3; i++)
+		q[i] = (numerator < (denominator[i] * 2)) ? res[i] : 0xffffffff;
+#else
+	q[0] = DIVIDE(numerator, denominator[0]);
+	q[1] = DIVIDE(numerator, denominator[1]);
+	q[2] = DIVIDE(numerator, denominator[2]);
+#endif
+}
+
 #endif // GTE_DIVIDE_H
@@ -0,0 +1,7 @@
+/*
+ * GTE functions without FLAG register updates (gteXXX_nf()), for callers that
+ * know FLAG is overwritten before it is next read. See FLAGLESS in gte.c.
+ */
+
+#define FLAGLESS
+#include "gte.c"
@@ -0,0 +1,291 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Write-behind file I/O thread, see iothread.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "iothread.h"
+
+// Buffers up to this size go back to the pool when freed, bigger ones
+//  (savestates) are released right away: RAM is tight on some devices.
+#define IO_POOL_BUF_MAX  (128 * 1024)
+#define IO_POOL_MAX      16
+
+struct io_buf {
+	size_t cap;
+	struct io_buf *next;
+	uint64_t data[];      // uint64_t for alignment
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+	pthread_t thread;
+	pthread_cond_t cond_avail, cond_idle;
+	struct io_job *head, *tail;
+	io_job_func running;  // Func of job being run, NULL if idle
+	uint8_t started, exit_thread;
+} io_thread;
+
+static struct io_buf *pool;
+static int pool_len;
+
+static char error_path[256];
+static uint8_t error_pending;
+
+static void io_run_job(struct io_job *job)
+{
+	if (job->func(job) != 0) {
+		printf("I/O error: writing %s failed\n", job->path ? job->path : "");
+		pthread_mutex_lock(&lock);
+		snprintf(error_path, sizeof(error_path), "%s", job->path ? job->path : "");
+		error_pending = 1;
+		pthread_mutex_unlock(&lock);
+	}
+
+	free(job->path);
+	ioBufFree(job->buf);
+	free(job);
+}
+
+#ifdef USE_IO_THREAD
+static void *io_worker_thread(void *unused)
+{
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		while (!io_thread.head && !io_thread.exit_thread)
+			pthread_cond_wait(&io_thread.cond_avail, &lock);
+		if (!io_thread.head)
+			break;   // Exit only once queue is drained
+
+		struct io_job *job = io_thread.head;
+		if (!(io_thread.head = job->next))
+			io_thread.tail = NULL;
+		io_thread.running = job->func;
+		pthread_mutex_unlock(&lock);
+
+		io_run_job(job);
+
+		pthread_mutex_lock(&lock);
+		io_thread.running = NULL;
+		pthread_cond_broadcast(&io_thread.cond_idle);
+	}
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+#endif
+
+void ioThreadInit(void)
+{
+#ifdef USE_IO_THREAD
+	// Started on single-core devices too: the thread mostly sleeps in
+	//  fsync(), which is what the emu thread shouldn't wait for.
+	if (io_thread.started)
+		return;
+
+	if (pthread_cond_init(&io_thread.cond_avail, NULL) != 0)
+		goto fail_cond_avail;
+	if (pthread_cond_init(&io_thread.cond_idle, NULL) != 0)
+		goto fail_cond_idle;
+	if (pthread_create(&io_thread.thread, NULL, io_worker_thread, NULL) != 0)
+		goto fail_thread;
+
+	io_thread.started = 1;
+	return;
+
+fail_thread:
+	pthread_cond_destroy(&io_thread.cond_idle);
+fail_cond_idle:
+	pthread_cond_destroy(&io_thread.cond_avail);
+fail_cond_avail:
+	printf("Could not start I/O thread, writing files synchronously\n");
+#endif
+}
+
+void ioThreadShutdown(void)
+{
+#ifdef USE_IO_THREAD
+	if (io_thread.started) {
+		pthread_mutex_lock(&lock);
+		io_thread.exit_thread = 1;
+		pthread_cond_signal(&io_thread.cond_avail);
+		pthread_mutex_unlock(&lock);
+
+		pthread_join(io_thread.thread, NULL);
+		pthread_cond_destroy(&io_thread.cond_idle);
+		pthread_cond_destroy(&io_thread.cond_avail);
+		io_thread.exit_thread = 0;
+		io_thread.started = 0;
+	}
+#endif
+
+	pthread_mutex_lock(&lock);
+	while (pool) {
+		struct io_buf *b = pool;
+		pool = b->next;
+		free(b);
+	}
+	pool_len = 0;
+	pthread_mutex_unlock(&lock);
+}
+
+int ioQueue(io_job_func func, const char *path, void *buf, size_t size,
+            uint32_t arg0, uint32_t arg1)
+{
+	struct io_job *job = (struct io_job *)calloc(1, sizeof(*job));
+
+	if (!job || (path && !(job->path = strdup(path)))) {
+		printf("Error in %s(): out of memory\n", __func__);
+		free(job);
+		ioBufFree(buf);
+		return -1;
+	}
+
+	job->func = func;
+	job->buf = buf;
+	job->size = size;
+	job->arg[0] = arg0;
+	job->arg[1] = arg1;
+
+	if (!io_thread.started) {
+		io_run_job(job);
+		return 0;
+	}
+
+	pthread_mutex_lock(&lock);
+	if (io_thread.tail)
+		io_thread.tail->next = job;
+	else
+		io_thread.head = job;
+	io_thread.tail = job;
+	pthread_cond_signal(&io_thread.cond_avail);
+	pthread_mutex_unlock(&lock);
+	return 0;
+}
+
+void ioSync(void)
+{
+	if (!io_thread.started)
+		return;
+
+	pthread_mutex_lock(&lock);
+	while (io_thread.head || io_thread.running)
+		pthread_cond_wait(&io_thread.cond_idle, &lock);
+	pthread_mutex_unlock(&lock);
+}
+
+// Call with lock held
+static int io_func_pending(io_job_func func)
+{
+	if (io_thread.running == func)
+		return 1;
+	for (struct io_job *job = io_thread.head; job; job = job->next)
+		if (job->func == func)
+			return 1;
+	return 0;
+}
+
+void ioSyncFunc(io_job_func func)
+{
+	if (!io_thread.started)
+		return;
+
+	pthread_mutex_lock(&lock);
+	while (io_func_pending(func))
+		pthread_cond_wait(&io_thread.cond_idle, &lock);
+	pthread_mutex_unlock(&lock);
+}
+
+int ioGetError(char *path, size_t len)
+{
+	int ret;
+
+	pthread_mutex_lock(&lock);
+	ret = error_pending;
+	if (ret && path)
+		snprintf(path, len, "%s", error_path);
+	error_pending = 0;
+	pthread_mutex_unlock(&lock);
+	return ret;
+}
+
+void *ioBufAlloc(size_t size)
+{
+	struct io_buf *b = NULL, **prev;
+
+	if (size <= IO_POOL_BUF_MAX) {
+		pthread_mutex_lock(&lock);
+		for (prev = &pool; *prev; prev = &(*prev)->next) {
+			if ((*prev)->cap >= size) {
+				b = *prev;
+				*prev = b->next;
+				pool_len--;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&lock);
+		if (b)
+			return b->data;
+	}
+
+	if (!(b = (struct io_buf *)malloc(sizeof(*b) + size)))
+		return NULL;
+	b->cap = size;
+	return b->data;
+}
+
+void *ioBufRealloc(void *buf, size_t size)
+{
+	struct io_buf *b;
+
+	if (!buf)
+		return ioBufAlloc(size);
+
+	b = (struct io_buf *)((uint8_t *)buf - offsetof(struct io_buf, data));
+	if (b->cap >= size)
+		return buf;
+	if (!(b = (struct io_buf *)realloc(b, sizeof(*b) + size)))
+		return NULL;
+	b->cap = size;
+	return b->data;
+}
+
+void ioBufFree(void *buf)
+{
+	struct io_buf *b;
+
+	if (!buf)
+		return;
+
+	b = (struct io_buf *)((uint8_t *)buf - offsetof(struct io_buf, data));
+	if (b->cap <= IO_POOL_BUF_MAX) {
+		pthread_mutex_lock(&lock);
+		if (pool_len < IO_POOL_MAX) {
+			b->next = pool;
+			pool = b;
+			pool_len++;
+			b = NULL;
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	free(b);
+}
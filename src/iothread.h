@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Write-behind file I/O thread
+ *
+ * Memcard and savestate writes are queued as jobs holding a copy of the
+ * data, so the emu thread never waits on write(), zlib or fsync(), which
+ * can stall for 100ms+ on SD cards. Jobs run one at a time in the order
+ * queued. Failures are printed and remembered for the frontend to show,
+ * see ioGetError().
+ *
+ * Without USE_IO_THREAD, or if the thread can't be started, jobs run
+ * synchronously when queued.
+ */
+
+#ifndef __IOTHREAD_H__
+#define __IOTHREAD_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define USE_IO_THREAD
+
+struct io_job;
+
+// Job function, runs on I/O thread. Returns 0 on success, -1 on error.
+typedef int (*io_job_func)(struct io_job *job);
+
+struct io_job {
+	io_job_func func;
+	struct io_job *next;
+	char *path;           // File the job is about, for error reports
+	void *buf;            // Data of job, from ioBufAlloc()
+	size_t size;
+	uint32_t arg[2];      // Job specific
+};
+
+void ioThreadInit(void);
+
+// Runs all jobs still queued before stopping thread
+void ioThreadShutdown(void);
+
+// Queue job 'func' for 'path', taking ownership of 'buf' (ioBufAlloc()'d
+//  or NULL). Returns -1 if job couldn't be created, 'buf' is freed then.
+int ioQueue(io_job_func func, const char *path, void *buf, size_t size,
+            uint32_t arg0, uint32_t arg1);
+
+// Wait until all queued jobs are done
+void ioSync(void);
+
+// Wait until no job of 'func' is queued or running
+void ioSyncFunc(io_job_func func);
+
+// Returns 1 and the path of the last failed job if a job failed since
+//  last call, 0 otherwise.
+int ioGetError(char *path, size_t len);
+
+// Pool of job buffers: small ones (memcard frames) are kept for reuse
+void *ioBufAlloc(size_t size);
+void *ioBufRealloc(void *buf, size_t size);
+void ioBufFree(void *buf);
+
+#endif /* __IOTHREAD_H__ */
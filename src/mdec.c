@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include "mdec.h"
+#include "plugin_lib.h"
 
 /* memory speed is 1 byte per MDEC_BIAS psx clock
  * That mean (PSXCLK / MDEC_BIAS) B/s
@@ -40,6 +41,29 @@
  * */
 #define MDEC_BIAS 10
 
+// idct() and yuv2rgb15/24() have SSE2/NEON versions, see further below
+#if !defined(__BIGENDIAN__)
+#if defined(__SSE2__)
+#define MDEC_USE_SSE2
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MDEC_USE_NEON
+#include <arm_neon.h>
+#endif
+#endif // !__BIGENDIAN__
+
+// Decode on a worker thread on multi-core devices (see mdec_start())
+#define MDEC_USE_THREAD
+
+#ifdef MDEC_USE_THREAD
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#endif
+
 #define DSIZE			8
 #define DSIZE2			(DSIZE * DSIZE)
 
@@ -86,6 +110,7 @@ static inline void fillrow(int *blk, int val) {
 		= blk[4] = blk[5] = blk[6] = blk[7] = val;
 }
 
+#if !defined(MDEC_USE_SSE2) && !defined(MDEC_USE_NEON)
 static void idct(int *block,int used_col) {
 	int tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
 	int z5, z10, z11, z12, z13;
@@ -205,6 +230,229 @@ static void idct(int *block,int used_col) {
 		}
 	}
 }
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// SIMD IDCT and color conversion (SSE2/NEON)
+//
+// Same integer math as the scalar idct() and yuv2rgb15/24() above, four
+//  32-bit lanes at a time, so output is bit-exact: multiplies wrap like C
+//  int ones, and clamping is done after saturating to 16 bits, which
+//  doesn't change results as clamp ranges lie well within 16 bits.
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(MDEC_USE_SSE2)
+
+typedef __m128i v4si;
+#define V4_LOAD(p)        _mm_loadu_si128((const __m128i *)(p))
+#define V4_STORE(p, v)    _mm_storeu_si128((__m128i *)(p), v)
+#define V4_DUP(c)         _mm_set1_epi32(c)
+#define V4_ADD(a, b)      _mm_add_epi32(a, b)
+#define V4_SUB(a, b)      _mm_sub_epi32(a, b)
+#define V4_SRA(a, n)      _mm_srai_epi32(a, n)
+#define V4_SHL(a, n)      _mm_slli_epi32(a, n)
+#define V4_DUPLO(a)       _mm_unpacklo_epi32(a, a)    // a0 a0 a1 a1
+#define V4_DUPHI(a)       _mm_unpackhi_epi32(a, a)    // a2 a2 a3 a3
+
+// Low 32 bits of product, like a C int multiply
+static inline v4si V4_MUL(v4si a, int c)
+{
+#if defined(__SSE4_1__)
+	return _mm_mullo_epi32(a, _mm_set1_epi32(c));
+#else
+	const __m128i k = _mm_set1_epi32(c);
+	const __m128i even = _mm_mul_epu32(a, k);
+	const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), k);
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+	                          _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+
+static inline void V4_TRANSPOSE(v4si *a, v4si *b, v4si *c, v4si *d)
+{
+	const __m128i t0 = _mm_unpacklo_epi32(*a, *b), t1 = _mm_unpacklo_epi32(*c, *d);
+	const __m128i t2 = _mm_unpackhi_epi32(*a, *b), t3 = _mm_unpackhi_epi32(*c, *d);
+	*a = _mm_unpacklo_epi64(t0, t1);
+	*b = _mm_unpackhi_epi64(t0, t1);
+	*c = _mm_unpacklo_epi64(t2, t3);
+	*d = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Clamp 8 lanes of two vectors to lo..hi, then add bias, as 16-bit lanes
+typedef __m128i v8hi;
+static inline v8hi V8_CLAMP(v4si a, v4si b, int lo, int hi, int bias)
+{
+	__m128i v = _mm_packs_epi32(a, b);
+	v = _mm_min_epi16(_mm_max_epi16(v, _mm_set1_epi16(lo)), _mm_set1_epi16(hi));
+	return _mm_add_epi16(v, _mm_set1_epi16(bias));
+}
+#define V8_DUP(c)         _mm_set1_epi16(c)
+#define V8_OR(a, b)       _mm_or_si128(a, b)
+#define V8_SHL(a, n)      _mm_slli_epi16(a, n)
+#define V8_STORE(p, v)    _mm_storeu_si128((__m128i *)(p), v)
+
+// Store 8 RGB24 pixels from 16-bit lanes holding 0..255
+static inline void V8_STORE_RGB24(uint8_t *image, v8hi r, v8hi g, v8hi b)
+{
+	uint8_t c[3][16];
+	int i;
+	_mm_storeu_si128((__m128i *)c[0], _mm_packus_epi16(r, r));
+	_mm_storeu_si128((__m128i *)c[1], _mm_packus_epi16(g, g));
+	_mm_storeu_si128((__m128i *)c[2], _mm_packus_epi16(b, b));
+	for (i = 0; i < 8; i++, image += 3) {
+		image[0] = c[0][i];
+		image[1] = c[1][i];
+		image[2] = c[2][i];
+	}
+}
+
+#elif defined(MDEC_USE_NEON)
+
+typedef int32x4_t v4si;
+#define V4_LOAD(p)        vld1q_s32((const int32_t *)(p))
+#define V4_STORE(p, v)    vst1q_s32((int32_t *)(p), v)
+#define V4_DUP(c)         vdupq_n_s32(c)
+#define V4_ADD(a, b)      vaddq_s32(a, b)
+#define V4_SUB(a, b)      vsubq_s32(a, b)
+#define V4_SRA(a, n)      vshrq_n_s32(a, n)
+#define V4_SHL(a, n)      vshlq_n_s32(a, n)
+#define V4_MUL(a, c)      vmulq_n_s32(a, c)
+#define V4_DUPLO(a)       vzipq_s32(a, a).val[0]
+#define V4_DUPHI(a)       vzipq_s32(a, a).val[1]
+
+static inline void V4_TRANSPOSE(v4si *a, v4si *b, v4si *c, v4si *d)
+{
+	const int32x4x2_t p = vtrnq_s32(*a, *b), q = vtrnq_s32(*c, *d);
+	*a = vcombine_s32(vget_low_s32(p.val[0]), vget_low_s32(q.val[0]));
+	*b = vcombine_s32(vget_low_s32(p.val[1]), vget_low_s32(q.val[1]));
+	*c = vcombine_s32(vget_high_s32(p.val[0]), vget_high_s32(q.val[0]));
+	*d = vcombine_s32(vget_high_s32(p.val[1]), vget_high_s32(q.val[1]));
+}
+
+typedef int16x8_t v8hi;
+static inline v8hi V8_CLAMP(v4si a, v4si b, int lo, int hi, int bias)
+{
+	int16x8_t v = vcombine_s16(vqmovn_s32(a), vqmovn_s32(b));
+	v = vminq_s16(vmaxq_s16(v, vdupq_n_s16(lo)), vdupq_n_s16(hi));
+	return vaddq_s16(v, vdupq_n_s16(bias));
+}
+#define V8_DUP(c)         vdupq_n_s16(c)
+#define V8_OR(a, b)       vorrq_s16(a, b)
+#define V8_SHL(a, n)      vshlq_n_s16(a, n)
+#define V8_STORE(p, v)    vst1q_s16((int16_t *)(p), v)
+
+// Store 8 RGB24 pixels from 16-bit lanes holding 0..255
+static inline void V8_STORE_RGB24(uint8_t *image, v8hi r, v8hi g, v8hi b)
+{
+	uint8x8x3_t c;
+	c.val[0] = vmovn_u16(vreinterpretq_u16_s16(r));
+	c.val[1] = vmovn_u16(vreinterpretq_u16_s16(g));
+	c.val[2] = vmovn_u16(vreinterpretq_u16_s16(b));
+	vst3_u8(image, c);
+}
+
+#endif
+
+#if defined(MDEC_USE_SSE2) || defined(MDEC_USE_NEON)
+
+// One 1-D IDCT pass over 4 rows or columns at once, see idct()
+static inline void idct_1d_simd(v4si *p)
+{
+	v4si z5, z10, z11, z12, z13;
+	v4si tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+
+	z10 = V4_ADD(p[0], p[4]);
+	z11 = V4_SUB(p[0], p[4]);
+	z13 = V4_ADD(p[2], p[6]);
+	z12 = V4_SUB(V4_SRA(V4_MUL(V4_SUB(p[2], p[6]), FIX_1_414213562), AAN_CONST_BITS), z13);
+
+	tmp0 = V4_ADD(z10, z13);
+	tmp3 = V4_SUB(z10, z13);
+	tmp1 = V4_ADD(z11, z12);
+	tmp2 = V4_SUB(z11, z12);
+
+	z13 = V4_ADD(p[3], p[5]);
+	z10 = V4_SUB(p[3], p[5]);
+	z11 = V4_ADD(p[1], p[7]);
+	z12 = V4_SUB(p[1], p[7]);
+
+	tmp7 = V4_ADD(z11, z13);
+	z5 = V4_MUL(V4_SUB(z12, z10), FIX_1_847759065);
+	tmp6 = V4_SUB(V4_SRA(V4_ADD(V4_MUL(z10, FIX_2_613125930), z5), AAN_CONST_BITS), tmp7);
+	tmp5 = V4_SUB(V4_SRA(V4_MUL(V4_SUB(z11, z13), FIX_1_414213562), AAN_CONST_BITS), tmp6);
+	tmp4 = V4_ADD(V4_SRA(V4_SUB(V4_MUL(z12, FIX_1_082392200), z5), AAN_CONST_BITS), tmp5);
+
+	p[0] = V4_ADD(tmp0, tmp7);
+	p[7] = V4_SUB(tmp0, tmp7);
+	p[1] = V4_ADD(tmp1, tmp6);
+	p[6] = V4_SUB(tmp1, tmp6);
+	p[2] = V4_ADD(tmp2, tmp5);
+	p[5] = V4_SUB(tmp2, tmp5);
+	p[4] = V4_ADD(tmp3, tmp4);
+	p[3] = V4_SUB(tmp3, tmp4);
+}
+
+static void idct_simd(int *block, int used_col)
+{
+	v4si v[8];
+	int half, i;
+
+	// the block has only the DC coefficient
+	if (used_col == -1) {
+		const v4si dc = V4_DUP(block[0]);
+		for (i = 0; i < DSIZE2; i += 4) V4_STORE(block + i, dc);
+		return;
+	}
+
+	// Column pass, for columns 0..3 then 4..7. A column with nothing but
+	//  its DC coefficient just gets filled with it, as in idct().
+	for (half = 0; half < 2; half++) {
+		int *ptr = block + half * 4;
+		if (used_col & (0xf << (half * 4))) {
+			for (i = 0; i < 8; i++) v[i] = V4_LOAD(ptr + DSIZE * i);
+			idct_1d_simd(v);
+			for (i = 0; i < 8; i++) V4_STORE(ptr + DSIZE * i, v[i]);
+		} else {
+			const v4si dc = V4_LOAD(ptr);
+			for (i = 1; i < 8; i++) V4_STORE(ptr + DSIZE * i, dc);
+		}
+	}
+
+	// Row pass on 4 rows at a time, transposed so lanes are rows.
+	//  Columns 1..7 all being zero is the common case: rows become their
+	//  first value then, see idct().
+	if ((used_col & 0xfe) == 0) {
+		int dc_cols = 0;
+		for (i = 1; i < 8; i++) dc_cols |= block[i];
+		if (dc_cols == 0) {
+			for (i = 0; i < DSIZE; i++)
+				fillrow(block + DSIZE * i, block[DSIZE * i]);
+			return;
+		}
+	}
+
+	for (half = 0; half < 2; half++) {
+		int *ptr = block + half * 4 * DSIZE;
+		for (i = 0; i < 4; i++) {
+			v[i] = V4_LOAD(ptr + DSIZE * i);
+			v[i + 4] = V4_LOAD(ptr + DSIZE * i + 4);
+		}
+		V4_TRANSPOSE(&v[0], &v[1], &v[2], &v[3]);
+		V4_TRANSPOSE(&v[4], &v[5], &v[6], &v[7]);
+		idct_1d_simd(v);
+		V4_TRANSPOSE(&v[0], &v[1], &v[2], &v[3]);
+		V4_TRANSPOSE(&v[4], &v[5], &v[6], &v[7]);
+		for (i = 0; i < 4; i++) {
+			V4_STORE(ptr + DSIZE * i, v[i]);
+			V4_STORE(ptr + DSIZE * i + 4, v[i + 4]);
+		}
+	}
+}
+
+#define IDCT idct_simd
+#else
+#define IDCT idct
+#endif
 
 // mdec0: command register
 #define MDEC0_STP			0x02000000
@@ -233,6 +481,10 @@ static struct {
 	uint8_t * block_buffer_pos;
 	uint8_t block_buffer[16*16*3];
 	struct _pending_dma1 pending_dma1;
+	uint32_t out_adr, out_end;   // RAM range of last DMA1 output
+#ifdef USE_FMV_STATS
+	unsigned decode_usecs;
+#endif
 } mdec;
 
 static int iq_y[DSIZE2], iq_uv[DSIZE2];
@@ -304,7 +556,7 @@ static unsigned short *rl2blk(int *blk, unsigned short *mdec_rl) {
 		// at least one non zero cofficient in the rows 1-7
 		// single coefficients in row 0 are treted specially 
 		// in the idtc function
-		idct(blk, used_col);
+		IDCT(blk, used_col);
 		blk += DSIZE2;
 	}
 	return mdec_rl;
@@ -359,12 +611,69 @@ static inline void putquadrgb15(uint16_t *image, int *Yblk, int Cr, int Cb) {
 	image[17] = MAKERGB15(CLAMP_SCALE5(Y + R), CLAMP_SCALE5(Y + G), CLAMP_SCALE5(Y + B), A);
 }
 
+#if defined(MDEC_USE_SSE2) || defined(MDEC_USE_NEON)
+
+// Color conversion of a 16x16 macroblock, 8 pixels of a line at a time:
+//  left half from Y1/Y3 and right half from Y2/Y4 blocks, with the 4 chroma
+//  values of each half computed once for both lines sharing them. Output
+//  is the same as putquadrgb15/24(), the depth is picked by 'rgb24'.
+static inline void yuv2rgb_simd(int *blk, void *image, int rgb24)
+{
+	const v4si round = V4_DUP(rgb24 ? 1 << 19 : 1 << 22);
+	const v8hi A = V8_DUP((mdec.reg0 & MDEC0_STP) ? (int16_t)0x8000 : 0);
+	int y, half, line;
+
+	for (y = 0; y < 16; y += 2) {
+		const int *Yblk = blk + DSIZE2 * ((y < 8) ? 2 : 4) + (y & 7) * DSIZE;
+		const int *Crblk = blk + (y >> 1) * DSIZE;
+		const int *Cbblk = Crblk + DSIZE2;
+
+		for (half = 0; half < 2; half++, Yblk += DSIZE2) {
+			const v4si Cr = V4_LOAD(Crblk + half * 4);
+			const v4si Cb = V4_LOAD(Cbblk + half * 4);
+			const v4si R = V4_ADD(V4_MUL(Cr, 1434), round);
+			const v4si G = V4_ADD(V4_SUB(V4_MUL(Cb, -351), V4_MUL(Cr, 728)), round);
+			const v4si B = V4_ADD(V4_MUL(Cb, 1807), round);
+			const v4si R_lo = V4_DUPLO(R), R_hi = V4_DUPHI(R);
+			const v4si G_lo = V4_DUPLO(G), G_hi = V4_DUPHI(G);
+			const v4si B_lo = V4_DUPLO(B), B_hi = V4_DUPHI(B);
+
+			for (line = 0; line < 2; line++) {
+				const v4si Y_lo = V4_SHL(V4_LOAD(Yblk + line * DSIZE), 10);
+				const v4si Y_hi = V4_SHL(V4_LOAD(Yblk + line * DSIZE + 4), 10);
+				const int offs = (y + line) * 16 + half * 8;
+
+				if (!rgb24) {
+					const v8hi r = V8_CLAMP(V4_SRA(V4_ADD(Y_lo, R_lo), 23), V4_SRA(V4_ADD(Y_hi, R_hi), 23), -16, 15, 16);
+					const v8hi g = V8_CLAMP(V4_SRA(V4_ADD(Y_lo, G_lo), 23), V4_SRA(V4_ADD(Y_hi, G_hi), 23), -16, 15, 16);
+					const v8hi b = V8_CLAMP(V4_SRA(V4_ADD(Y_lo, B_lo), 23), V4_SRA(V4_ADD(Y_hi, B_hi), 23), -16, 15, 16);
+					V8_STORE((uint16_t *)image + offs,
+					         V8_OR(V8_OR(r, V8_SHL(g, 5)), V8_OR(V8_SHL(b, 10), A)));
+				} else {
+					const v8hi r = V8_CLAMP(V4_SRA(V4_ADD(Y_lo, R_lo), 20), V4_SRA(V4_ADD(Y_hi, R_hi), 20), -128, 127, 128);
+					const v8hi g = V8_CLAMP(V4_SRA(V4_ADD(Y_lo, G_lo), 20), V4_SRA(V4_ADD(Y_hi, G_hi), 20), -128, 127, 128);
+					const v8hi b = V8_CLAMP(V4_SRA(V4_ADD(Y_lo, B_lo), 20), V4_SRA(V4_ADD(Y_hi, B_hi), 20), -128, 127, 128);
+					V8_STORE_RGB24((uint8_t *)image + offs * 3, r, g, b);
+				}
+			}
+		}
+	}
+}
+#endif
+
 static inline void yuv2rgb15(int *blk, unsigned short *image) {
 	int x, y;
 	int *Yblk = blk + DSIZE2 * 2;
 	int *Crblk = blk;
 	int *Cbblk = blk + DSIZE2;
 
+#if defined(MDEC_USE_SSE2) || defined(MDEC_USE_NEON)
+	if (!Config.Mdec) {
+		yuv2rgb_simd(blk, image, 0);
+		return;
+	}
+#endif
+
 	if (!Config.Mdec) {
 		for (y = 0; y < 16; y += 2, Crblk += 4, Cbblk += 4, Yblk += 8, image += 24) {
 			if (y == 8) Yblk += DSIZE2;
@@ -424,6 +733,13 @@ static void yuv2rgb24(int *blk, uint8_t *image) {
 	int *Crblk = blk;
 	int *Cbblk = blk + DSIZE2;
 
+#if defined(MDEC_USE_SSE2) || defined(MDEC_USE_NEON)
+	if (!Config.Mdec) {
+		yuv2rgb_simd(blk, image, 1);
+		return;
+	}
+#endif
+
 	if (!Config.Mdec) {
 		for (y = 0; y < 16; y += 2, Crblk += 4, Cbblk += 4, Yblk += 8, image += 8 * 3 * 3) {
 			if (y == 8) Yblk += DSIZE2;
@@ -441,15 +757,210 @@ static void yuv2rgb24(int *blk, uint8_t *image) {
 	}
 }
 
+#define SIZE_OF_24B_BLOCK (16*16*3)
+#define SIZE_OF_16B_BLOCK (16*16*2)
+
+// Decode from mdec.rl to size bytes of image, continuing a partial block
+//  left over from the last call. Runs on worker thread if there is one.
+static void mdec_decode(uint8_t *image, int size)
+{
+	int blk[DSIZE2 * 6];
+#ifdef USE_FMV_STATS
+	const unsigned start = pl_fmv_clock();
+#endif
+
+	if (mdec.reg0 & MDEC0_RGB24) {
+		/* 16 bits decoding
+		 * block are 16 px * 16 px, each px are 2 byte
+		 */
+
+		/* there is some partial block pending ? */
+		if(mdec.block_buffer_pos != 0) {
+			int n = mdec.block_buffer - mdec.block_buffer_pos + SIZE_OF_16B_BLOCK;
+			/* TODO: check if partial block do not  larger than size */
+			memcpy(image, mdec.block_buffer_pos, n);
+			image += n;
+			size -= n;
+			mdec.block_buffer_pos = 0;
+		}
+
+		while(size >= SIZE_OF_16B_BLOCK) {
+			mdec.rl = rl2blk(blk, mdec.rl);
+			yuv2rgb15(blk, (uint16_t *)image);
+			image += SIZE_OF_16B_BLOCK;
+			size -= SIZE_OF_16B_BLOCK;
+		}
+
+		if(size != 0) {
+			mdec.rl = rl2blk(blk, mdec.rl);
+			yuv2rgb15(blk, (uint16_t *)mdec.block_buffer);
+			memcpy(image, mdec.block_buffer, size);
+			mdec.block_buffer_pos = mdec.block_buffer + size;
+		}
+
+	} else {
+		/* 24 bits decoding
+		 * block are 16 px * 16 px, each px are 3 byte
+		 */
+
+		/* there is some partial block pending ? */
+		if(mdec.block_buffer_pos != 0) {
+			int n = mdec.block_buffer - mdec.block_buffer_pos + SIZE_OF_24B_BLOCK;
+			/* TODO: check if partial block do not  larger than size */
+			memcpy(image, mdec.block_buffer_pos, n);
+			image += n;
+			size -= n;
+			mdec.block_buffer_pos = 0;
+		}
+
+		while(size >= SIZE_OF_24B_BLOCK) {
+			mdec.rl = rl2blk(blk, mdec.rl);
+			yuv2rgb24(blk, image);
+			image += SIZE_OF_24B_BLOCK;
+			size -= SIZE_OF_24B_BLOCK;
+		}
+
+		if(size != 0) {
+			mdec.rl = rl2blk(blk, mdec.rl);
+			yuv2rgb24(blk, mdec.block_buffer);
+			memcpy(image, mdec.block_buffer, size);
+			mdec.block_buffer_pos = mdec.block_buffer + size;
+		}
+	}
+
+#ifdef USE_FMV_STATS
+	mdec.decode_usecs += pl_fmv_clock() - start;
+#endif
+}
+
+#ifdef MDEC_USE_THREAD
+/* Worker thread decoding. A DMA1 transfer is decoded in one job, which
+ * starts as soon as both DMA0 input and DMA1 output are set up, and
+ * only has to be finished by the time its mdec1Interrupt() fires: the
+ * decode then overlaps with the CPU emulation in between.
+ * Until mdec_wait() returns, the worker owns mdec.rl, mdec.block_buffer*,
+ * the iq tables and the output area in psxM, so anything touching those
+ * or mdec.reg0 must call it first.
+ */
+static struct {
+	pthread_t thread;
+	sem_t sem_avail, sem_done;
+	uint8_t *image;
+	int size;
+	uint8_t started, busy, exit_thread;
+} mdec_thread;
+
+static void *mdec_worker_thread(void *unused)
+{
+	for (;;) {
+		sem_wait(&mdec_thread.sem_avail);
+		if (mdec_thread.exit_thread)
+			break;
+		mdec_decode(mdec_thread.image, mdec_thread.size);
+		sem_post(&mdec_thread.sem_done);
+	}
+	return NULL;
+}
+
+static void mdec_wait(void)
+{
+	if (mdec_thread.busy) {
+#ifdef USE_FMV_STATS
+		const unsigned start = pl_fmv_clock();
+		sem_wait(&mdec_thread.sem_done);
+		pl_fmv_add(PL_FMV_WAIT, pl_fmv_clock() - start);
+#else
+		sem_wait(&mdec_thread.sem_done);
+#endif
+		mdec_thread.busy = 0;
+	}
+}
+
+static void mdec_start(uint8_t *image, int size)
+{
+	if (!mdec_thread.started) {
+		mdec_decode(image, size);
+		return;
+	}
+	mdec_thread.image = image;
+	mdec_thread.size = size;
+	mdec_thread.busy = 1;
+	sem_post(&mdec_thread.sem_avail);
+}
+
+static void mdec_thread_init(void)
+{
+	// Nothing to gain on single-core devices, decode synchronously there
+	if (mdec_thread.started || sysconf(_SC_NPROCESSORS_ONLN) <= 1)
+		return;
+
+	if (sem_init(&mdec_thread.sem_avail, 0, 0) != 0)
+		goto fail_sem_avail;
+	if (sem_init(&mdec_thread.sem_done, 0, 0) != 0)
+		goto fail_sem_done;
+	if (pthread_create(&mdec_thread.thread, NULL, mdec_worker_thread, NULL) != 0)
+		goto fail_thread;
+
+	mdec_thread.started = 1;
+	printf("MDEC: decoding on worker thread\n");
+	return;
+
+fail_thread:
+	sem_destroy(&mdec_thread.sem_done);
+fail_sem_done:
+	sem_destroy(&mdec_thread.sem_avail);
+fail_sem_avail:
+	printf("MDEC: could not start worker thread, decoding synchronously\n");
+}
+
+static void mdec_thread_exit(void)
+{
+	if (!mdec_thread.started)
+		return;
+
+	mdec_wait();
+	mdec_thread.exit_thread = 1;
+	sem_post(&mdec_thread.sem_avail);
+	pthread_join(mdec_thread.thread, NULL);
+	sem_destroy(&mdec_thread.sem_done);
+	sem_destroy(&mdec_thread.sem_avail);
+	mdec_thread.exit_thread = 0;
+	mdec_thread.started = 0;
+}
+#else
+static inline void mdec_wait(void) {}
+static inline void mdec_start(uint8_t *image, int size) { mdec_decode(image, size); }
+static inline void mdec_thread_init(void) {}
+static inline void mdec_thread_exit(void) {}
+#endif // MDEC_USE_THREAD
+
 void mdecInit(void) {
+	mdec_wait();
 	memset(&mdec, 0, sizeof(mdec));
 	memset(iq_y, 0, sizeof(iq_y));
 	memset(iq_uv, 0, sizeof(iq_uv));
 	mdec.rl = (uint16_t *)&psxM[0x100000];
+	mdec_thread_init();
+}
+
+void mdecShutdown(void) {
+	mdec_thread_exit();
+}
+
+void mdecSync(void) {
+	mdec_wait();
+}
+
+// Is adr inside the output area of the last DMA1? FMV players DMA2 MDEC
+//  output to VRAM as soon as it's decoded, see psxDma2().
+int mdecIsOutput(uint32_t adr) {
+	adr &= 0x1fffff;
+	return adr >= mdec.out_adr && adr < mdec.out_end;
 }
 
 // command register
 void mdecWrite0(uint32_t data) {
+	mdec_wait();
 	mdec.reg0 = data;
 }
 
@@ -460,6 +971,7 @@ uint32_t mdecRead0(void) {
 // status register
 void mdecWrite1(uint32_t data) {
 	if (data & MDEC1_RESET) { // mdec reset
+		mdec_wait();
 		mdec.reg0 = 0;
 		mdec.reg1 = 0;
 		mdec.pending_dma1.adr = 0;
@@ -485,6 +997,8 @@ void psxDma0(uint32_t adr, uint32_t bcr, uint32_t chcr) {
 
 	size = (bcr >> 16) * (bcr & 0xffff);
 
+	mdec_wait();
+
 	switch (cmd >> 28) {
 		case 0x3: // decode
 			mdec.rl = (uint16_t *) PSXM(adr);
@@ -543,12 +1057,7 @@ void mdec0Interrupt()
 	}
 }
 
-#define SIZE_OF_24B_BLOCK (16*16*3)
-#define SIZE_OF_16B_BLOCK (16*16*2)
-
 void psxDma1(uint32_t adr, uint32_t bcr, uint32_t chcr) {
-	int blk[DSIZE2 * 6];
-	uint8_t * image;
 	int size;
 	uint32_t words;
 
@@ -565,66 +1074,10 @@ void psxDma1(uint32_t adr, uint32_t bcr, uint32_t chcr) {
 		mdec.pending_dma1.chcr = chcr;
 		/* do not free the dma */
 	} else {
-		image = (uint8_t *)PSXM(adr);
-
-		if (mdec.reg0 & MDEC0_RGB24) {
-			/* 16 bits decoding
-			 * block are 16 px * 16 px, each px are 2 byte
-			 */
-
-			/* there is some partial block pending ? */
-			if(mdec.block_buffer_pos != 0) {
-				int n = mdec.block_buffer - mdec.block_buffer_pos + SIZE_OF_16B_BLOCK;
-				/* TODO: check if partial block do not  larger than size */
-				memcpy(image, mdec.block_buffer_pos, n);
-				image += n;
-				size -= n;
-				mdec.block_buffer_pos = 0;
-			}
-
-			while(size >= SIZE_OF_16B_BLOCK) {
-				mdec.rl = rl2blk(blk, mdec.rl);
-				yuv2rgb15(blk, (uint16_t *)image);
-				image += SIZE_OF_16B_BLOCK;
-				size -= SIZE_OF_16B_BLOCK;
-			}
-
-			if(size != 0) {
-				mdec.rl = rl2blk(blk, mdec.rl);
-				yuv2rgb15(blk, (uint16_t *)mdec.block_buffer);
-				memcpy(image, mdec.block_buffer, size);
-				mdec.block_buffer_pos = mdec.block_buffer + size;
-			}
-
-		} else {
-			/* 24 bits decoding
-			 * block are 16 px * 16 px, each px are 3 byte
-			 */
-
-			/* there is some partial block pending ? */
-			if(mdec.block_buffer_pos != 0) {
-				int n = mdec.block_buffer - mdec.block_buffer_pos + SIZE_OF_24B_BLOCK;
-				/* TODO: check if partial block do not  larger than size */
-				memcpy(image, mdec.block_buffer_pos, n);
-				image += n;
-				size -= n;
-				mdec.block_buffer_pos = 0;
-			}
-
-			while(size >= SIZE_OF_24B_BLOCK) {
-				mdec.rl = rl2blk(blk, mdec.rl);
-				yuv2rgb24(blk, image);
-				image += SIZE_OF_24B_BLOCK;
-				size -= SIZE_OF_24B_BLOCK;
-			}
-
-			if(size != 0) {
-				mdec.rl = rl2blk(blk, mdec.rl);
-				yuv2rgb24(blk, mdec.block_buffer);
-				memcpy(image, mdec.block_buffer, size);
-				mdec.block_buffer_pos = mdec.block_buffer + size;
-			}
-		}
+		mdec_wait();
+		mdec.out_adr = adr & 0x1fffff;
+		mdec.out_end = mdec.out_adr + size;
+		mdec_start((uint8_t *)PSXM(adr), size);
 
 		/* define the power of mdec */
 		MDECOUTDMA_INT(words * MDEC_BIAS);
@@ -656,6 +1109,12 @@ void mdec1Interrupt() {
 	 *
 	 */
 
+	mdec_wait();
+#ifdef USE_FMV_STATS
+	pl_fmv_add(PL_FMV_DECODE, mdec.decode_usecs);
+	mdec.decode_usecs = 0;
+#endif
+
 	/* MDEC_END_OF_DATA avoids read outside memory */
 	if (mdec.rl >= mdec.rl_end || SWAP16(*(mdec.rl)) == MDEC_END_OF_DATA) {
 		mdec.reg1 &= ~(MDEC1_STP|MDEC1_BUSY);
@@ -678,6 +1137,8 @@ int mdecFreeze(void* f, enum FreezeMode mode)
 	uint8_t *base = (uint8_t *)&psxM[0x100000];
 	uint32_t v;
 
+	mdec_wait();
+
 	if ( freeze_rw(f, mode, &mdec.reg0, sizeof(mdec.reg0)) ||
 	     freeze_rw(f, mode, &mdec.reg1, sizeof(mdec.reg1)) )
 		return -1;
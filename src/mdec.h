@@ -27,6 +27,9 @@
 #include "psxdma.h"
 
 void mdecInit(void);
+void mdecShutdown(void);
+void mdecSync(void);
+int  mdecIsOutput(uint32_t adr);
 void mdecWrite0(uint32_t data);
 void mdecWrite1(uint32_t data);
 uint32_t  mdecRead0(void);
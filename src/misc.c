@@ -32,6 +32,9 @@
 #include "plugin_lib.h"
 #include "ppf.h"
 #include "psxevents.h"
+#include "psxhlesig.h"
+#include "iothread.h"
+#include "statefile.h"
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -261,6 +264,7 @@ int LoadCdrom() {
 
 	tmpHead.t_size = SWAP32(tmpHead.t_size);
 	tmpHead.t_addr = SWAP32(tmpHead.t_addr);
+	const uint32_t t_addr = tmpHead.t_addr, t_size = tmpHead.t_size;
 
 #ifdef PSXREC
 	psxCpu->Clear(tmpHead.t_addr, tmpHead.t_size / 4);
@@ -279,6 +283,7 @@ int LoadCdrom() {
 		tmpHead.t_addr += 2048;
 	}
 
+	psxHleSigScan(t_addr, t_size);
 	return 0;
 }
 
@@ -327,6 +332,7 @@ int LoadCdromFile(const char *filename, EXE_HEADER *head) {
 		addr += 2048;
 	}
 
+	psxHleSigScan(head->t_addr, head->t_size);
 	return 0;
 }
 
@@ -490,6 +496,7 @@ int Load(const char *ExePath) {
 #ifdef PSXREC
 					psxCpu->Clear(section_address, section_size / 4);
 #endif
+					psxHleSigScan(section_address, section_size);
 				}
 				psxRegs.pc = SWAP32(tmpHead.pc0);
 				psxRegs.GPR.n.gp = SWAP32(tmpHead.gp0);
@@ -684,6 +691,129 @@ struct PcsxSaveFuncs SaveFuncs = {
 #endif
 };
 
+/* SaveState() writes through these to a memory buffer, which a job on the
+ *  I/O thread (see iothread.h) compresses and writes to file: the emu
+ *  thread only pays for copying the state. */
+static struct {
+	uint8_t *buf;
+	size_t size, cap;
+} mem_state;
+
+// Initial size of buffer, about what a state takes uncompressed
+#define MEM_STATE_SIZE (5 * 1024 * 1024)
+
+static void *mem_open(const char *name, uint_fast8_t writing)
+{
+	if (!writing || mem_state.buf)
+		return NULL;
+	if ((mem_state.buf = (uint8_t *)ioBufAlloc(MEM_STATE_SIZE)) == NULL)
+		return NULL;
+	mem_state.size = 0;
+	mem_state.cap = MEM_STATE_SIZE;
+	return &mem_state;
+}
+
+static int mem_read(void *file, void *buf, uint32_t len)
+{
+	return -1;
+}
+
+static int mem_write(void *file, const void *buf, uint32_t len)
+{
+	if (mem_state.size + len > mem_state.cap) {
+		size_t cap = mem_state.cap * 2;
+		while (cap < mem_state.size + len)
+			cap *= 2;
+		uint8_t *p = (uint8_t *)ioBufRealloc(mem_state.buf, cap);
+		if (!p)
+			return -1;
+		mem_state.buf = p;
+		mem_state.cap = cap;
+	}
+	memcpy(mem_state.buf + mem_state.size, buf, len);
+	mem_state.size += len;
+	return len;
+}
+
+static long mem_seek(void *file, long offs, int whence)
+{
+	return -1;
+}
+
+// Buffer is handed to I/O thread or freed by SaveState()
+static int mem_close(void *file)
+{
+	return 0;
+}
+
+static const struct PcsxSaveFuncs MemSaveFuncs = {
+	mem_open, mem_read, mem_write, mem_seek, mem_close
+#if !(defined(_WIN32) && !defined(__CYGWIN__))
+	, -1, -1
+#endif
+};
+
+// I/O thread job writing the savestate in job->buf to job->path as chunked
+//  container (statefile.h), with first job->arg[0] bytes left uncompressed.
+//  It's written to a temporary file first, so a failed write never
+//  destroys an older savestate of the same name.
+static int state_write_job(struct io_job *job)
+{
+	char tmpname[MAXPATHLEN + 4];
+
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", job->path);
+
+	if (StateFileWrite(tmpname, job->buf, job->size, job->arg[0]) == 0) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+		remove(job->path);
+#endif
+		if (rename(tmpname, job->path) == 0)
+			return 0;
+		perror(__func__);
+	}
+
+	printf("Error in %s() writing savestate file %s\n", __func__, job->path);
+	printf("..no free space left on filesystem?\n");
+	remove(tmpname);
+	return -1;
+}
+
+/* LoadState() and CheckState() read chunked savestates through these,
+ *  older gzip ones through zlib_*(). */
+static void *chunked_open(const char *name, uint_fast8_t writing)
+{
+	if (writing)
+		return NULL;
+	return StateFileOpen(name);
+}
+
+static int chunked_read(void *file, void *buf, uint32_t len)
+{
+	return StateFileRead((struct state_file *)file, buf, len);
+}
+
+static int chunked_write(void *file, const void *buf, uint32_t len)
+{
+	return -1;
+}
+
+static long chunked_seek(void *file, long offs, int whence)
+{
+	return StateFileSeek((struct state_file *)file, offs, whence);
+}
+
+static int chunked_close(void *file)
+{
+	return StateFileClose((struct state_file *)file);
+}
+
+static const struct PcsxSaveFuncs ChunkedSaveFuncs = {
+	chunked_open, chunked_read, chunked_write, chunked_seek, chunked_close
+#if !(defined(_WIN32) && !defined(__CYGWIN__))
+	, -1, -1
+#endif
+};
+
 static const char PcsxHeader[32] = "STv4 PCSX v" PACKAGE_VERSION;
 
 // Savestate Versioning!
@@ -712,14 +842,22 @@ static const uint32_t SaveVersionEarliestSupported = 0x8b410004;
 //                 DATA LAYOUT CHANGE:
 //                 * Embedded screenshot data area is expanded a bit and now
 //                   used for rgb565 160x120x2 image (38400 bytes)
+// NOTE: Savestates are now written as chunked container (statefile.h)
+//       instead of one gzip stream. Data inside is laid out as before,
+//       so SaveVersion is unchanged and gzip savestates still load.
 
-int SaveState(const char *file) {
+// Header, version, HLE flag and screenshot: stored uncompressed in
+//  chunked savestates, so CheckState() reads them without inflating.
+#define STATE_STORED_SIZE (32 + sizeof(uint32_t) + sizeof(uint_fast8_t) + 160*120*2)
+
+static int save_state(const char *file) {
 	void* f;
 	GPUFreeze_t *gpufP = NULL;
 	SPUFreeze_t *spufP = NULL;
 	unsigned char *pMem = NULL;
 	uint32_t Size;
 	uint_fast8_t close_error = false;
+	int mem_error;
 
 	if ((f = SaveFuncs.open(file, true)) == NULL) {
 		printf("Error opening savestate file for writing: %s\n", file);
@@ -745,7 +883,14 @@ int SaveState(const char *file) {
 	if (Config.HLE)
 		psxBiosFreeze(1);
 
-	if ( freeze_rw(f, FREEZE_SAVE, psxM, 0x00200000)  ||
+	// MDEC worker thread may still be writing to psxM
+	mdecSync();
+
+	psxHleSigUnpatch();
+	mem_error = freeze_rw(f, FREEZE_SAVE, psxM, 0x00200000);
+	psxHleSigRepatch();
+
+	if ( mem_error                                    ||
 	     freeze_rw(f, FREEZE_SAVE, psxR, 0x00080000)  ||
 	     freeze_rw(f, FREEZE_SAVE, psxH, 0x00010000)  ||
 	     freeze_rw(f, FREEZE_SAVE, (void*)&psxRegs, sizeof(psxRegs)) )
@@ -802,7 +947,31 @@ error:
 	return -1;
 }
 
-int LoadState(const char *file) {
+// Savestate is snapshot to memory, then written to file by the I/O thread.
+//  Returns 0 if it was queued, errors writing the file are reported
+//  through ioGetError().
+int SaveState(const char *file) {
+	const struct PcsxSaveFuncs file_funcs = SaveFuncs;
+	int ret;
+
+	// Each queued savestate holds a 5MB+ buffer: on devices with little
+	//  RAM, quick saves in a row must not pile them up.
+	ioSyncFunc(state_write_job);
+
+	SaveFuncs = MemSaveFuncs;
+	ret = save_state(file);
+	SaveFuncs = file_funcs;
+
+	if (ret == 0)
+		ret = ioQueue(state_write_job, file, mem_state.buf, mem_state.size,
+		              STATE_STORED_SIZE, 0);
+	else
+		ioBufFree(mem_state.buf);
+	memset(&mem_state, 0, sizeof(mem_state));
+	return ret;
+}
+
+static int load_state(const char *file) {
 	void* f;
 	GPUFreeze_t *gpufP = NULL;
 	SPUFreeze_t *spufP = NULL;
@@ -830,6 +999,7 @@ int LoadState(const char *file) {
 		goto error;
 
 	psxCpu->Reset();
+	mdecSync();
 
 	// XXX - Save versions before 0x8b410006 had smaller area
 	//       reserved for screenshot data, which was unused.
@@ -909,6 +1079,7 @@ int LoadState(const char *file) {
 skip_missing_data_hack:
 
 	SaveFuncs.close(f);
+	psxHleSigRepatch();
 	pl_reset();  // Reset plugin_lib
 	return 0;
 
@@ -919,18 +1090,27 @@ error:
 	return -1;
 }
 
+int LoadState(const char *file) {
+	const struct PcsxSaveFuncs file_funcs = SaveFuncs;
+	int ret;
+
+	// File might still be being written
+	ioSync();
+
+	if (StateFileIsChunked(file))
+		SaveFuncs = ChunkedSaveFuncs;
+	ret = load_state(file);
+	SaveFuncs = file_funcs;
+	return ret;
+}
+
 // Checks if sstate 'file' contains a valid header and version.
 // If 'get_sshot' is true, it will check if it contains screenshot data.
 // If 'get_sshot' is true and 'sshot_image' is not NULL, it will copy
 //  the 160*120 rgb565 sshot data at sshot_image ptr.
 // Returns 0 for success, negative CHECKSTATE_ERR_* value for errors (misc.h)
-int CheckState(const char *file, uint_fast8_t *uses_hle, uint_fast8_t get_sshot, uint16_t *sshot_image)
+static int check_state(const char *file, uint_fast8_t *uses_hle, uint_fast8_t get_sshot, uint16_t *sshot_image)
 {
-	if (!file || file[0] == '\0') {
-		printf("Error in %s(): NULL ptr or empty savestate filename string\n", __func__);
-		return -1;
-	}
-
 	void *f = NULL;
 	char header[32];
 	uint32_t version;
@@ -993,6 +1173,110 @@ int CheckState(const char *file, uint_fast8_t *uses_hle, uint_fast8_t get_sshot,
 	return CHECKSTATE_SUCCESS;
 }
 
+int CheckState(const char *file, uint_fast8_t *uses_hle, uint_fast8_t get_sshot, uint16_t *sshot_image)
+{
+	const struct PcsxSaveFuncs file_funcs = SaveFuncs;
+	int ret;
+
+	if (!file || file[0] == '\0') {
+		printf("Error in %s(): NULL ptr or empty savestate filename string\n", __func__);
+		return -1;
+	}
+
+	// File might still be being written
+	ioSync();
+
+	if (StateFileIsChunked(file))
+		SaveFuncs = ChunkedSaveFuncs;
+	ret = check_state(file, uses_hle, get_sshot, sshot_image);
+	SaveFuncs = file_funcs;
+	return ret;
+}
+
+///////////////////////////////
+// BIOS boot state cache     //
+///////////////////////////////
+
+// Running BIOS init through psxExecuteBios() takes a while on slow devices,
+//  but always ends in the same state for a given BIOS image. That state is
+//  saved as a regular savestate the first time and loaded on later boots.
+//  File name is keyed by a hash of the BIOS image, savestate version,
+//  psxRegs layout and region, so a cache from another BIOS or another
+//  build is never loaded.
+#define BOOTCACHE_NAME_MAX (MAXPATHLEN + 32)  // Config.BootCacheDir + file name
+
+// Returns 0 on success, -1 if the name doesn't fit
+static int BootCacheFilename(char *name, size_t size)
+{
+	uint32_t key[3] = { SaveVersion, sizeof(psxRegs), Config.PsxType };
+	uLong crc = crc32(0L, Z_NULL, 0);
+	crc = crc32(crc, (const Bytef *)psxR, 0x80000);
+	crc = crc32(crc, (const Bytef *)key, sizeof(key));
+	int len = snprintf(name, size, "%s/bootcache_%08x.sav", Config.BootCacheDir, (unsigned)crc);
+	if (len < 0 || (size_t)len >= size) {
+		printf("BIOS boot cache path too long, boot cache disabled\n");
+		return -1;
+	}
+	return 0;
+}
+
+// Returns 0 if cached state was loaded, -1 if there is none (machine state
+//  is untouched), 1 if loading failed partway (machine needs a reset).
+//  A bad cache that can't be removed is ignored from then on.
+int BootCacheLoad(void)
+{
+	static char bad_name[BOOTCACHE_NAME_MAX];
+	char name[BOOTCACHE_NAME_MAX];
+	struct ps1_controller pads[2];
+
+	if (Config.BootCacheDir[0] == '\0')
+		return -1;
+
+	if (BootCacheFilename(name, sizeof(name)) != 0)
+		return -1;
+	ioSync();
+	if (!FileExists(name) || strcmp(name, bad_name) == 0)
+		return -1;
+
+	// Controller setup belongs to the current session, not to the cache
+	memcpy(pads, player_controller, sizeof(pads));
+	int ret = LoadState(name);
+	memcpy(player_controller, pads, sizeof(pads));
+
+	if (ret != 0) {
+		printf("Removing bad BIOS boot cache %s\n", name);
+		if (remove(name) != 0) {
+			perror(__func__);
+			snprintf(bad_name, sizeof(bad_name), "%s", name);
+		}
+		return 1;
+	}
+
+	printf("Loaded BIOS boot cache %s\n", name);
+	return 0;
+}
+
+// Save state right after psxExecuteBios(). SaveState() writes through a
+//  temporary file, so an interrupted save never leaves a truncated cache.
+int BootCacheSave(void)
+{
+	char name[BOOTCACHE_NAME_MAX];
+
+	if (Config.BootCacheDir[0] == '\0')
+		return -1;
+
+	if (BootCacheFilename(name, sizeof(name)) != 0)
+		return -1;
+
+	if (SaveState(name) != 0) {
+		printf("Error saving BIOS boot cache %s\n", name);
+		return -1;
+	}
+
+	printf("Saving BIOS boot cache %s\n", name);
+	return 0;
+}
+
 ////////////////////////////
 // Misc utility functions //
 ////////////////////////////
@@ -73,6 +73,10 @@ int SaveState(const char *file);
 int LoadState(const char *file);
 int CheckState(const char *file, uint_fast8_t *uses_hle, uint_fast8_t get_sshot, uint16_t *sshot_image);
 
+// Cache of machine state after BIOS init, see misc.c
+int BootCacheLoad(void);
+int BootCacheSave(void);
+
 enum {
 	CHECKSTATE_SUCCESS        = 0,
 	CHECKSTATE_ERR_OPEN       = -1,
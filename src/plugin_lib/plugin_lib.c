@@ -32,6 +32,7 @@
 #include "plugin_lib.h"
 #include "perfmon.h"
 #include "plugins.h"
+#include "psxtrace.h"
 
 #ifdef USE_GPULIB
 #include "gpu/gpulib/gpu.h"
@@ -39,21 +40,99 @@
 
 extern void gpulib_frameskip_prepare(void);
 extern void gpulib_set_config(const struct gpulib_config_t *config);
+extern uint32_t gpulib_take_raster_work(void);
 
 static void pl_frameskip_prepare(void);
 static void pl_stats_update(void);
 
 #define MAX_LAG_FRAMES 3
 
+/* Auto frameskip controller tuning */
+#define FSKIP_ALPHA    (1.0f / 16)  /* Weight of newest vsync in averages */
+#define FSKIP_ENTER    1.0f         /* Start skipping when predicted cost of a
+                                       rendered frame exceeds frame time.. */
+#define FSKIP_LEAVE    0.85f        /* ..stop once it stays below this part */
+#define FSKIP_HOLD     30           /*    of frame time for this many vsyncs */
+
+/* Auto frameskip controller state */
+static struct {
+	struct timeval tv_busy_start;   /* When emu resumed after frame limiting */
+	struct timeval tv_flip_start;
+	int flip_usec;                  /* Time spent in frontend screen flips */
+	float busy_avg, work_avg;       /* Averages of busy usecs and raster work
+	                                   per vsync.. */
+	float cov, var;                 /* ..and their (co)variance */
+	float work_drawn;               /* Average raster work of drawn vsyncs */
+	int hold;
+	uint_fast8_t skipping, valid;
+} fskip;
+
+/* Fast-forward state */
+static struct {
+	struct timeval tv_last_draw;    /* When last drawn frame was flipped */
+	int cnt;                        /* Frames flipped since then */
+} ff;
+
 #define tvdiff(tv, tv_old) \
 	((tv.tv_sec - tv_old.tv_sec) * 1000000 + tv.tv_usec - tv_old.tv_usec)
 
+#ifdef USE_FMV_STATS
+/* FMV pipeline profiling state */
+static struct {
+	unsigned frame_usecs[PL_FMV_STAGES];  /* Accumulated this vsync */
+	unsigned usecs[PL_FMV_STAGES];        /* Totals of FMV vsyncs since report */
+	unsigned frames;
+	uint_fast8_t mdec_used;               /* MDEC output decoded/uploaded this vsync */
+} fmv;
+
+void pl_fmv_add(enum pl_fmv_stage stage, unsigned usecs)
+{
+	fmv.frame_usecs[stage] += usecs;
+	if (stage != PL_FMV_VOUT)
+		fmv.mdec_used = true;
+}
+
+/* Called every vsync: vsyncs in which MDEC was used count as FMV frames,
+ * their stage times are summed and reported as per-frame averages. */
+static void pl_fmv_update(uint_fast8_t report)
+{
+	int i;
+
+	if (fmv.mdec_used) {
+		for (i = 0; i < PL_FMV_STAGES; i++)
+			fmv.usecs[i] += fmv.frame_usecs[i];
+		fmv.frames++;
+	}
+	memset(fmv.frame_usecs, 0, sizeof(fmv.frame_usecs));
+	fmv.mdec_used = false;
+
+	if (!report || !fmv.frames)
+		return;
+
+	unsigned total = 0;
+	for (i = 0; i < PL_FMV_STAGES; i++) {
+		fmv.usecs[i] /= fmv.frames;
+		total += fmv.usecs[i];
+	}
+	printf("FMV: %u frames, usecs/frame: decode %u wait %u upload %u vout %u"
+	       " = %u (%u%% of frame)\n", fmv.frames,
+	       fmv.usecs[PL_FMV_DECODE], fmv.usecs[PL_FMV_WAIT],
+	       fmv.usecs[PL_FMV_UPLOAD], fmv.usecs[PL_FMV_VOUT],
+	       total, total * 100 / pl_data.frame_interval);
+	memset(fmv.usecs, 0, sizeof(fmv.usecs));
+	fmv.frames = 0;
+}
+#endif
+
 struct pl_data_t pl_data;
 
 void pl_clear_screen()
 {
 	uint16_t *dst = SCREEN;
 	memset((void*)dst, 0, SCREEN_WIDTH*SCREEN_HEIGHT*2);
+#ifdef USE_GPULIB
+	vout_invalidate();
+#endif
 }
 
 void pl_clear_borders()
@@ -67,6 +146,8 @@ void pl_clear_borders()
 static void pl_frameskip_prepare(void)
 {
 	pl_data.fskip_advice = false;
+	memset(&fskip, 0, sizeof(fskip));
+	gettimeofday(&fskip.tv_busy_start, 0);
 	pl_data.frameskip = Config.FrameSkip;
 	pl_data.is_pal = (Config.PsxType == PSXTYPE_PAL);
 	pl_data.frame_interval = pl_data.is_pal ? 20000 : 16667;
@@ -84,12 +165,125 @@ static void pl_frameskip_prepare(void)
 #endif
 }
 
+/* Frontend brackets its screen flip with these, so that time spent in it
+ * (which could be waiting for vsync) isn't counted as emulation cost */
+void pl_flip_begin(void)
+{
+	gettimeofday(&fskip.tv_flip_start, 0);
+}
+
+void pl_flip_end(void)
+{
+	struct timeval now;
+	gettimeofday(&now, 0);
+	fskip.flip_usec += tvdiff(now, fskip.tv_flip_start);
+}
+
+/*
+ * Fast-forward: the frame limiter paces vsyncs at FastForwardSpeed times
+ * the normal rate, or not at all if it's FAST_FORWARD_UNCAPPED. gpulib
+ * skips rasterization and video out of all frames but the ones this
+ * function allows, so the screen still updates at about normal frame rate.
+ */
+void pl_set_fast_forward(uint_fast8_t enable)
+{
+	pl_data.fast_forward = enable;
+	ff.cnt = 0;
+	gettimeofday(&ff.tv_last_draw, 0);
+	pl_frameskip_prepare();
+}
+
+/* gpulib calls this on each frame flip while fast-forwarding */
+uint_fast8_t pl_fast_forward_draw(void)
+{
+	if (Config.FastForwardSpeed != FAST_FORWARD_UNCAPPED) {
+		if (++ff.cnt < Config.FastForwardSpeed)
+			return false;
+		ff.cnt = 0;
+		return true;
+	}
+
+	struct timeval now;
+	gettimeofday(&now, 0);
+	if (tvdiff(now, ff.tv_last_draw) < pl_data.frame_interval)
+		return false;
+	ff.tv_last_draw = now;
+	return true;
+}
+
+/*
+ * Auto frameskip: predict the cost of a vsync in which a frame is drawn,
+ * and skip every other frame while that doesn't fit in frame time.
+ *
+ * Each vsync, the time the emu was busy is a sum of emulation cost and
+ * rasterization cost. The GPU plugin reports the raster work it did (prims
+ * and pixels drawn), and a running least-squares fit of busy time against
+ * it separates the two: the slope is the cost per unit of raster work, so
+ * prediction works from vsyncs in which frames were skipped, too.
+ *
+ * Unlike reacting to lag, this starts skipping before frames are late,
+ * and hysteresis keeps borderline-speed games from alternating between
+ * 30 and 60 fps. Lag still forces skipping if the prediction is off.
+ */
+static void pl_frameskip_update(const struct timeval *now, int diff)
+{
+	const float a = FSKIP_ALPHA;
+	float busy = tvdiff((*now), fskip.tv_busy_start) - fskip.flip_usec;
+	float work = 0;
+#ifdef USE_GPULIB
+	work = gpulib_take_raster_work();
+#endif
+	fskip.flip_usec = 0;
+
+	if (!fskip.valid) {
+		fskip.busy_avg = busy;
+		fskip.work_avg = fskip.work_drawn = work;
+		fskip.valid = true;
+		return;
+	}
+
+	float dw = work - fskip.work_avg;
+	float db = busy - fskip.busy_avg;
+	fskip.work_avg += a * dw;
+	fskip.busy_avg += a * db;
+	fskip.cov = (1.0f - a) * (fskip.cov + a * dw * db);
+	fskip.var = (1.0f - a) * (fskip.var + a * dw * dw);
+	if (work > 0)
+		fskip.work_drawn += a * (work - fskip.work_drawn);
+
+	float cost_per_work = (fskip.var > 1.0f) ? fskip.cov / fskip.var : 0.0f;
+	if (cost_per_work < 0.0f)
+		cost_per_work = 0.0f;
+	float predict = fskip.busy_avg + cost_per_work * (fskip.work_drawn - fskip.work_avg);
+	float budget = pl_data.frame_interval;
+
+	if (!fskip.skipping) {
+		if ((predict > budget * FSKIP_ENTER && diff < pl_data.frame_interval) ||
+		    diff < -pl_data.frame_interval) {
+			fskip.skipping = true;
+			fskip.hold = FSKIP_HOLD;
+		}
+	} else {
+		if (predict < budget * FSKIP_LEAVE && diff >= 0) {
+			if (--fskip.hold <= 0)
+				fskip.skipping = false;
+		} else {
+			fskip.hold = FSKIP_HOLD;
+		}
+	}
+
+	pl_data.fskip_advice = fskip.skipping;
+}
+
 /* called on every vsync */
 void pl_frame_limit(void)
 {
 	struct timeval now;
 	int diff, usadj;
+	int interval = pl_data.frame_interval;
+	int interval1024 = pl_data.frame_interval1024;
 
+	TRACE_BEGIN_EV(TRACE_FRAME_LIMIT, 0, 0);
 	gettimeofday(&now, 0);
 
 	GPU_getScreenInfo(&pl_data.sinfo);
@@ -110,6 +304,9 @@ void pl_frame_limit(void)
 		pmonGetStats(&pl_data.fps_cur, &pl_data.cpu_cur);
 		pl_stats_update();
 	}
+#ifdef USE_FMV_STATS
+	pl_fmv_update(new_stats);
+#endif
 
 	// If cfg settings change, catch it here
 	if (pl_data.frameskip != Config.FrameSkip ||
@@ -118,8 +315,13 @@ void pl_frame_limit(void)
 		pl_frameskip_prepare();
 	}
 
+	if (pl_data.fast_forward && Config.FastForwardSpeed != FAST_FORWARD_UNCAPPED) {
+		interval /= Config.FastForwardSpeed;
+		interval1024 /= Config.FastForwardSpeed;
+	}
+
 	// tv_expect uses usec*1024 units instead of usecs for better accuracy
-	pl_data.tv_expect.tv_usec += pl_data.frame_interval1024;
+	pl_data.tv_expect.tv_usec += interval1024;
 	if (pl_data.tv_expect.tv_usec >= (1000000 << 10)) {
 		pl_data.tv_expect.tv_usec -= (1000000 << 10);
 		pl_data.tv_expect.tv_sec++;
@@ -127,7 +329,12 @@ void pl_frame_limit(void)
 	diff = (pl_data.tv_expect.tv_sec - now.tv_sec) * 1000000 +
 	       (pl_data.tv_expect.tv_usec >> 10) - now.tv_usec;
 
-	if (diff > MAX_LAG_FRAMES * pl_data.frame_interval ||
+	if (pl_data.fast_forward && Config.FastForwardSpeed == FAST_FORWARD_UNCAPPED) {
+		// Uncapped: never sleep, just keep tv_expect current
+		pl_data.tv_expect = now;
+		pl_data.tv_expect.tv_usec <<= 10;
+		diff = 0;
+	} else if (diff > MAX_LAG_FRAMES * pl_data.frame_interval ||
 	    diff < -MAX_LAG_FRAMES * pl_data.frame_interval)
 	{
 		//printf("pl_frame_limit reset, diff=%d, iv %d\n", diff, frame_interval);
@@ -140,14 +347,23 @@ void pl_frame_limit(void)
 		pl_data.tv_expect.tv_usec = usadj << 10;
 	}
 
-	if (Config.FrameLimit && (diff > pl_data.frame_interval)) {
-		usleep(diff - pl_data.frame_interval);
+	// Busy times while fast-forwarding say nothing about normal speed
+	if (!pl_data.fast_forward) {
+		pl_frameskip_update(&now, diff);
+	} else {
+		pl_data.fskip_advice = false;
+		// Drop work counted meanwhile, or 1st frame after would see it all
+#ifdef USE_GPULIB
+		gpulib_take_raster_work();
+#endif
+		fskip.flip_usec = 0;
 	}
 
-	if (diff < -pl_data.frame_interval) {
-		pl_data.fskip_advice = true;
-	} else if (diff >= 0) {
-		pl_data.fskip_advice = false;
+	if (Config.FrameLimit && (diff > interval)) {
+		usleep(diff - interval);
+		gettimeofday(&fskip.tv_busy_start, 0);
+	} else {
+		fskip.tv_busy_start = now;
 	}
 
 	// recompilation is not that fast and may cause frame skip on
@@ -160,6 +376,9 @@ void pl_frame_limit(void)
 		pl_data.dynarec_active_vsyncs = 0;
 	}
 	pl_data.dynarec_compiled = false;
+
+	TRACE_END_EV(TRACE_FRAME_LIMIT,
+	             (Config.FrameLimit && diff > interval) ? diff - interval : 0, 0);
 }
 
 void pl_init(void)
@@ -200,11 +419,12 @@ static void pl_stats_update(void)
 {
 	// TODO: show skipped frames in stats message
 
-	sprintf(pl_data.stats_msg, "%3ux%3ux%s CPU=%3u%% FPS=%3u/%u",
+	sprintf(pl_data.stats_msg, "%3ux%3ux%s CPU=%3u%% FPS=%3u/%u%s",
 			pl_data.sinfo.hres,
 			pl_data.sinfo.vres,
 			pl_data.sinfo.depth24 ? "24" : "15",
 			(unsigned int)(pl_data.cpu_cur + 0.5f),
 			(unsigned int)(pl_data.fps_cur + 0.5f),
-			pl_data.sinfo.pal ? 50 : 60);
+			pl_data.sinfo.pal ? 50 : 60,
+			pl_data.fast_forward ? " >>" : "");
 }
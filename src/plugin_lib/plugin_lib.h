@@ -33,8 +33,14 @@
 #include <sys/time.h>
 #include <stdint.h>
 
+// Profile FMV playback as one pipeline stage: MDEC decode, upload of the
+//  decoded frame to VRAM and video out, averaged per frame and printed
+//  once a second while MDEC is in use.
+//#define USE_FMV_STATS
+
 struct pl_data_t {
 	uint_fast8_t fskip_advice, dynarec_compiled, is_pal;
+	uint_fast8_t fast_forward;
 	int8_t frameskip;
 	int frame_interval, frame_interval1024;
 	int vsync_usec_time;
@@ -59,6 +65,10 @@ void pl_resume(void);
 
 void pl_clear_screen();
 void pl_clear_borders();
+void pl_flip_begin(void);
+void pl_flip_end(void);
+void pl_set_fast_forward(uint_fast8_t enable);
+uint_fast8_t pl_fast_forward_draw(void);
 
 static inline uint_fast8_t pl_frameskip_advice(void)
 {
@@ -71,6 +81,26 @@ static inline void pl_dynarec_notify(void)
 	pl_data.dynarec_compiled = true;
 }
 
+#ifdef USE_FMV_STATS
+enum pl_fmv_stage {
+	PL_FMV_DECODE,  // MDEC macroblock decode, on worker thread if there is one
+	PL_FMV_WAIT,    // Emu waiting on MDEC worker thread
+	PL_FMV_UPLOAD,  // DMA2 of MDEC output to VRAM
+	PL_FMV_VOUT,    // vout_update(), including screen flip
+	PL_FMV_STAGES
+};
+
+static inline unsigned pl_fmv_clock(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Only call from emu thread
+void pl_fmv_add(enum pl_fmv_stage stage, unsigned usecs);
+#endif
+
 // In pl_sshot.cpp
 void pl_screenshot_160x120_rgb565(uint16_t *dst);
 
@@ -14,6 +14,8 @@
 #include "cdriso.h"
 #include "cdrom_hacks.h"
 #include "cheat.h"
+#include "isoindex.h"
+#include "iothread.h"
 
 #include <SDL.h>
 
@@ -152,6 +154,9 @@ static struct dir_item filereq_dir_items[1024] = { { 0, 0 }, };
 #define MENU_LS		(MENU_Y + 10)
 #define MENU_HEIGHT	22
 
+// File browser uses last row for info on selected image
+#define FILEREQ_ROWS	(MENU_HEIGHT - 1)
+
 static inline void ChDir(char *dir)
 {
 	int unused = chdir(dir);
@@ -208,10 +213,20 @@ static int32_t check_ext(const char *name)
 	return 0;
 }
 
-static int32_t get_entry_type(char *cwd, char *d_name)
+static int32_t get_entry_type(char *cwd, struct dirent *direntry)
 {
 	int32_t type;
 	struct stat item;
+	const char *d_name = direntry->d_name;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+	// Saves a stat() per entry, which is slow on SD cards
+	if (direntry->d_type == DT_DIR)
+		return 0;
+	if (direntry->d_type == DT_REG)
+		return 1;
+#endif
+
 	char *path = (char *)malloc(strlen(cwd) + strlen(d_name) + 2);
 
 	sprintf(path, "%s/%s", cwd, d_name);
@@ -239,6 +254,9 @@ char *FileReq(char *dir, const char *ext, char *result)
 	struct dirent *direntry;
 	static int32_t row;
 	char tmp_string[41];
+	char path[MAXPATHLEN];
+	struct iso_info info;
+	uint_fast8_t info_pending;
 	uint32_t keys = 0;
 
 	if (dir)
@@ -251,6 +269,7 @@ char *FileReq(char *dir, const char *ext, char *result)
 
 		if (keys & _KEY_BACK) {
 			FREE_LIST();
+			IsoIndexQueueClear();
 			key_reset();
 			return NULL;
 		}
@@ -263,7 +282,7 @@ char *FileReq(char *dir, const char *ext, char *result)
 			}
 			// read directory entries
 			while ((direntry = readdir(dirstream))) {
-				int32_t type = get_entry_type(cwd, direntry->d_name);
+				int32_t type = get_entry_type(cwd, direntry);
 
 				// this is a very ugly way of only accepting a certain extension
 				if ((type == 0 && strcmp(direntry->d_name, ".")) ||
@@ -285,6 +304,15 @@ char *FileReq(char *dir, const char *ext, char *result)
 			sort_dir(filereq_dir_items, num_items);
 			cursor_pos = 0;
 			first_visible = 0;
+
+			// Index images of this dir in the background
+			IsoIndexQueueClear();
+			for (int i = 0; i < num_items; i++) {
+				if (filereq_dir_items[i].type == 0)
+					continue;
+				snprintf(path, sizeof(path), "%s/%s", cwd, filereq_dir_items[i].name);
+				IsoIndexQueue(path);
+			}
 		}
 
 		// display current directory
@@ -302,11 +330,11 @@ char *FileReq(char *dir, const char *ext, char *result)
 				cursor_pos = 0;
 				first_visible = 0;
 			}
-			if ((cursor_pos - first_visible) >= MENU_HEIGHT) first_visible++;
+			if ((cursor_pos - first_visible) >= FILEREQ_ROWS) first_visible++;
 		} else if (keys & KEY_UP) { // up
 			if (--cursor_pos < 0) {
 				cursor_pos = num_items - 1;
-				first_visible = cursor_pos - MENU_HEIGHT + 1;
+				first_visible = cursor_pos - FILEREQ_ROWS + 1;
 				if (first_visible < 0) first_visible = 0;
 			}
 			if (cursor_pos < first_visible) first_visible--;
@@ -317,8 +345,8 @@ char *FileReq(char *dir, const char *ext, char *result)
 		} else if (keys & KEY_RIGHT) { //right
 			if (cursor_pos < (num_items - 11)) cursor_pos += 10;
 			else cursor_pos = num_items - 1;
-			if ((cursor_pos - first_visible) >= MENU_HEIGHT)
-				first_visible = cursor_pos - (MENU_HEIGHT - 1);
+			if ((cursor_pos - first_visible) >= FILEREQ_ROWS)
+				first_visible = cursor_pos - (FILEREQ_ROWS - 1);
 		} else if (keys & KEY_A) { // button 1
 			// directory selected
 			if (filereq_dir_items[cursor_pos].type == 0) {
@@ -342,6 +370,8 @@ char *FileReq(char *dir, const char *ext, char *result)
 				port_printf(16 * 8, 120, "LOADING");
 				video_flip();
 
+				// Don't compete with the game for CPU and I/O
+				IsoIndexQueueClear();
 				FREE_LIST();
 				key_reset();
 				return result;
@@ -354,7 +384,7 @@ char *FileReq(char *dir, const char *ext, char *result)
 
 		// display directory contents
 		row = 0;
-		while (row < num_items && row < MENU_HEIGHT) {
+		while (row < num_items && row < FILEREQ_ROWS) {
 			if (row == (cursor_pos - first_visible)) {
 				// draw cursor
 				port_printf(MENU_X + 16, MENU_LS + (10 * row), "-->");
@@ -372,8 +402,21 @@ char *FileReq(char *dir, const char *ext, char *result)
 			port_printf(MENU_X + (8 * 5), MENU_LS + (10 * row), tmp_string);
 			row++;
 		}
-		while (row < MENU_HEIGHT)
-			row++;
+
+		// display disc ID, region and label of selected image
+		info_pending = 0;
+		if (num_items > 0 && filereq_dir_items[cursor_pos].type != 0) {
+			static const char *regions[] = { "", "NTSC-U", "NTSC-J", "PAL" };
+
+			snprintf(path, sizeof(path), "%s/%s", cwd, filereq_dir_items[cursor_pos].name);
+			if (!IsoIndexLookup(path, &info)) {
+				info_pending = 1;
+			} else if (info.is_psx) {
+				snprintf(tmp_string, sizeof(tmp_string), "%s %s %s",
+				         info.id, regions[info.region], info.label);
+				port_printf(MENU_X, MENU_LS + (10 * FILEREQ_ROWS), tmp_string);
+			}
+		}
 
 		video_flip();
 		timer_delay(75);
@@ -381,10 +424,11 @@ char *FileReq(char *dir, const char *ext, char *result)
 		if (keys & (KEY_A | KEY_B | KEY_X | KEY_Y | KEY_L | KEY_R |
 			    KEY_LEFT | KEY_RIGHT | KEY_UP | KEY_DOWN))
 			timer_delay(50);
+		// Redraw when selected image gets indexed, too
 		do {
 			keys = key_read();
 			timer_delay(50);
-		} while (keys == 0);
+		} while (keys == 0 && !(info_pending && IsoIndexLookup(path, &info)));
 	}
 
 	return NULL;
@@ -1519,6 +1563,39 @@ static char *frameskip_show()
 	return (char*)str[fs];
 }
 
+static int fastforward_alter(uint32_t keys)
+{
+	// Config.FastForwardSpeed is 0 for uncapped or 2..8 for fixed speed,
+	//  1 (normal speed) is skipped over
+	int ff = Config.FastForwardSpeed;
+
+	if (keys & KEY_RIGHT) {
+		if (ff == FAST_FORWARD_UNCAPPED) ff = FAST_FORWARD_MIN;
+		else if (ff < FAST_FORWARD_MAX) ff++;
+	} else if (keys & KEY_LEFT) {
+		if (ff > FAST_FORWARD_MIN) ff--;
+		else ff = FAST_FORWARD_UNCAPPED;
+	}
+
+	Config.FastForwardSpeed = ff;
+	return 0;
+}
+
+static char *fastforward_show()
+{
+	static char buf[16] = "\0";
+	if (Config.FastForwardSpeed == FAST_FORWARD_UNCAPPED)
+		sprintf(buf, "uncapped");
+	else
+		sprintf(buf, "%dx", Config.FastForwardSpeed);
+	return buf;
+}
+
+static void fastforward_hint()
+{
+	port_printf(2 * 8 - 4, 10 * 8, "Toggle with F key or SELECT+R2");
+}
+
 #ifndef NO_HWSCALE
 static int videoscaling_alter(uint32_t keys)
 {
@@ -1703,6 +1780,7 @@ static int gpu_settings_defaults()
 	Config.ShowFps = 0;
 	Config.FrameLimit = true;
 	Config.FrameSkip = FRAMESKIP_OFF;
+	Config.FastForwardSpeed = FAST_FORWARD_DEFAULT;
 
 #ifdef GPU_UNAI
 #ifndef USE_GPULIB
@@ -1726,6 +1804,7 @@ static MENUITEM gui_GPUSettingsItems[] = {
 #ifdef USE_GPULIB
 	/* Only working with gpulib */
 	{(char *)"Frame skip           ", NULL, &frameskip_alter, &frameskip_show, NULL},
+	{(char *)"Fast-forward speed   ", NULL, &fastforward_alter, &fastforward_show, &fastforward_hint},
 	#ifndef NO_HWSCALE
 	{(char *)"Video Scaling        ", NULL, &videoscaling_alter, &videoscaling_show, videoscaling_hint},
 	#endif
@@ -2172,6 +2251,38 @@ int SelectGame()
 	return gui_RunMenu(&gui_MainMenu);
 }
 
+// Tell user about memcard/savestate writes that failed on I/O thread
+static void gui_ShowIoError()
+{
+	char path[256], tmp_string[41];
+
+	// Savestate menus look at files that might still be being written
+	ioSync();
+
+	if (!ioGetError(path, sizeof(path)))
+		return;
+
+	const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+	snprintf(tmp_string, sizeof(tmp_string), "%s", name);
+
+	key_reset();
+	for (;;) {
+		uint32_t keys = key_read();
+		video_clear();
+		// check keys
+		if (keys) {
+			key_reset();
+			return;
+		}
+
+		port_printf(160-(12*8/2), 120-24, "WRITE FAILED");
+		port_printf(160-(strlen(tmp_string)*8/2), 120-4, tmp_string);
+		port_printf(160-(18*8/2), 120+16, "Out of disk space?");
+		video_flip();
+		timer_delay(75);
+	}
+}
+
 int GameMenu()
 {
 	const cheat_t *ch = cheat_get();
@@ -2181,5 +2292,6 @@ int GameMenu()
 
 	//NOTE: TODO - reset 'saveslot' var to -1 if a new game is loaded.
 	// currently, we don't support loading a different game during a running game.
+	gui_ShowIoError();
 	return gui_RunMenu(&gui_GameMenu);
 }
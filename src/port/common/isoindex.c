@@ -0,0 +1,772 @@
+/*
+ * Background indexer of CD images for the file browser, see isoindex.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+#include "isoindex.h"
+
+#ifdef HAVE_CHD
+#include "chd.h"
+#endif
+
+#ifdef _WIN32
+#define fseeko fseek
+#endif
+
+#define INDEX_MAX_THREADS 4
+#define INDEX_BUCKETS     1024
+
+#define RAW_SECTOR        2352
+#define CHD_FRAME         (RAW_SECTOR + 96)  // Sector + subchannel data
+#define PBP_BLOCK_SECTORS 16
+
+// Bump when struct iso_info or the scan results change
+static const char index_magic[8] = { 'P', 'C', 'S', 'X', 'I', 'D', 'X', '1' };
+
+struct index_entry {
+	struct index_entry *next;
+	char    *path;
+	int64_t  mtime;
+	int64_t  size;
+	struct iso_info info;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+// Serializes index_save() calls, which write the file without 'lock' held
+static pthread_mutex_t save_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  queue_cond = PTHREAD_COND_INITIALIZER;
+
+static struct index_entry *buckets[INDEX_BUCKETS];
+static char index_file[4096];
+static uint_fast8_t dirty;
+
+// FIFO of paths to scan, consumed from queue_pos on
+static char **queue;
+static int queue_pos, queue_len, queue_cap;
+
+static pthread_t threads[INDEX_MAX_THREADS];
+static int num_threads, busy_threads;
+static uint_fast8_t quit;
+
+static uint32_t path_hash(const char *path)
+{
+	uint32_t hash = 0x811c9dc5;
+	while (*path)
+		hash = (hash ^ (uint8_t)*path++) * 0x01000193;
+	return hash;
+}
+
+// Call with lock held
+static struct index_entry *entry_find(const char *path)
+{
+	struct index_entry *e = buckets[path_hash(path) % INDEX_BUCKETS];
+	while (e && strcmp(e->path, path) != 0)
+		e = e->next;
+	return e;
+}
+
+// Call with lock held
+static void entry_set(const char *path, int64_t mtime, int64_t size,
+                      const struct iso_info *info)
+{
+	struct index_entry *e = entry_find(path);
+
+	if (!e) {
+		const uint32_t b = path_hash(path) % INDEX_BUCKETS;
+		if (!(e = (struct index_entry *)calloc(1, sizeof(*e))) ||
+		    !(e->path = strdup(path))) {
+			free(e);
+			return;
+		}
+		e->next = buckets[b];
+		buckets[b] = e;
+	}
+
+	e->mtime = mtime;
+	e->size = size;
+	e->info = *info;
+	dirty = 1;
+}
+
+/*
+ * Image reader
+ *
+ * Each worker has its own, reading 2048-byte user data of a sector by LBA.
+ */
+
+enum { IMG_RAW, IMG_2048, IMG_PBP, IMG_CHD };
+
+struct img_reader {
+	FILE *f;
+	int type;
+	uint8_t raw[RAW_SECTOR];
+
+	// PBP: offset of each compressed block of 16 sectors, last one is end
+	uint32_t *pbp_index;
+	uint32_t pbp_blocks;
+	int64_t pbp_base;
+	uint32_t pbp_cur_block;
+	uint8_t *pbp_buf;        // Decompressed current block
+	uint8_t *pbp_zbuf;
+	z_stream z;
+	uint_fast8_t z_init;
+
+#ifdef HAVE_CHD
+	chd_file *chd;
+	uint8_t *chd_buf;
+	uint32_t chd_hunk_frames;
+	uint32_t chd_cur_hunk;
+#endif
+};
+
+static inline uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int read_at(FILE *f, int64_t offset, void *dest, size_t len)
+{
+	if (fseeko(f, offset, SEEK_SET) != 0 || fread(dest, 1, len, f) != len)
+		return -1;
+	return 0;
+}
+
+static int pbp_read_block(struct img_reader *r, uint32_t block)
+{
+	const uint32_t raw_size = RAW_SECTOR * PBP_BLOCK_SECTORS;
+	uint32_t size;
+
+	if (block == r->pbp_cur_block)
+		return 0;
+	if (block >= r->pbp_blocks)
+		return -1;
+
+	size = r->pbp_index[block + 1] - r->pbp_index[block];
+	if (size > raw_size + 100)
+		return -1;
+
+	// Blocks that don't compress are stored as is
+	if (size == raw_size) {
+		if (read_at(r->f, r->pbp_base + r->pbp_index[block], r->pbp_buf, size))
+			return -1;
+		r->pbp_cur_block = block;
+		return 0;
+	}
+
+	if (read_at(r->f, r->pbp_base + r->pbp_index[block], r->pbp_zbuf, size))
+		return -1;
+
+	if (!r->z_init) {
+		memset(&r->z, 0, sizeof(r->z));
+		if (inflateInit2(&r->z, -15) != Z_OK)
+			return -1;
+		r->z_init = 1;
+	} else if (inflateReset(&r->z) != Z_OK) {
+		return -1;
+	}
+
+	r->z.next_in = r->pbp_zbuf;
+	r->z.avail_in = size;
+	r->z.next_out = r->pbp_buf;
+	r->z.avail_out = raw_size;
+	if (inflate(&r->z, Z_FINISH) != Z_STREAM_END)
+		return -1;
+
+	r->pbp_cur_block = block;
+	return 0;
+}
+
+// Returns ptr to 2048 bytes of user data of sector 'lba', NULL on error
+static const uint8_t *img_read(struct img_reader *r, uint32_t lba)
+{
+	switch (r->type) {
+	case IMG_RAW:
+		if (read_at(r->f, (int64_t)lba * RAW_SECTOR, r->raw, RAW_SECTOR))
+			return NULL;
+		return r->raw + 24;   // Mode 2 form 1, like CheckCdrom() reads
+	case IMG_2048:
+		if (read_at(r->f, (int64_t)lba * 2048, r->raw, 2048))
+			return NULL;
+		return r->raw;
+	case IMG_PBP:
+		if (pbp_read_block(r, lba / PBP_BLOCK_SECTORS))
+			return NULL;
+		return r->pbp_buf + (lba % PBP_BLOCK_SECTORS) * RAW_SECTOR + 24;
+#ifdef HAVE_CHD
+	case IMG_CHD: {
+		const uint32_t hunk = lba / r->chd_hunk_frames;
+		if (hunk != r->chd_cur_hunk) {
+			if (chd_read(r->chd, hunk, r->chd_buf) != CHDERR_NONE)
+				return NULL;
+			r->chd_cur_hunk = hunk;
+		}
+		return r->chd_buf + (lba % r->chd_hunk_frames) * CHD_FRAME + 24;
+	}
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static int is_pvd(const uint8_t *buf)
+{
+	return buf && buf[0] == 1 && memcmp(buf + 1, "CD001", 5) == 0;
+}
+
+// Track 1 of a .cue, resolved relative to the .cue's directory
+static int cue_data_file(const char *cuepath, char *out, size_t len)
+{
+	char line[1024], name[1024];
+	FILE *f = fopen(cuepath, "r");
+	int ret = -1;
+
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		char *p = line;
+		while (isspace((unsigned char)*p))
+			p++;
+		if (strncasecmp(p, "FILE", 4) != 0)
+			continue;
+		if (sscanf(p + 4, " \"%1023[^\"]\"", name) != 1 &&
+		    sscanf(p + 4, " %1023s", name) != 1)
+			break;
+
+		const char *slash = strrchr(cuepath, '/');
+		if (name[0] == '/' || !slash)
+			snprintf(out, len, "%s", name);
+		else
+			snprintf(out, len, "%.*s/%s", (int)(slash - cuepath), cuepath, name);
+		ret = 0;
+		break;
+	}
+
+	fclose(f);
+	return ret;
+}
+
+static int pbp_open(struct img_reader *r)
+{
+	uint8_t hdr[40], sig[12], entry[32];
+	int64_t psiso;
+	uint32_t i, max_blocks = (0x100000 - 0x4000) / sizeof(entry);
+
+	if (read_at(r->f, 0, hdr, sizeof(hdr)) || memcmp(hdr, "\0PBP", 4) != 0)
+		return -1;
+
+	psiso = get_le32(hdr + 36);
+	if (read_at(r->f, psiso, sig, sizeof(sig)))
+		return -1;
+
+	// Multi-disc: index 1st disc
+	if (memcmp(sig, "PSTITLEIMG", 10) == 0) {
+		uint8_t offs[4];
+		if (read_at(r->f, psiso + 0x200, offs, 4) || get_le32(offs) == 0)
+			return -1;
+		psiso += get_le32(offs);
+		if (read_at(r->f, psiso, sig, sizeof(sig)))
+			return -1;
+	}
+	if (memcmp(sig, "PSISOIMG00", 10) != 0)
+		return -1;
+
+	if (!(r->pbp_index = (uint32_t *)malloc((max_blocks + 1) * sizeof(uint32_t))) ||
+	    !(r->pbp_buf = (uint8_t *)malloc(RAW_SECTOR * PBP_BLOCK_SECTORS)) ||
+	    !(r->pbp_zbuf = (uint8_t *)malloc(RAW_SECTOR * PBP_BLOCK_SECTORS + 100)))
+		return -1;
+
+	if (fseeko(r->f, psiso + 0x4000, SEEK_SET) != 0)
+		return -1;
+	for (i = 0; i < max_blocks; i++) {
+		if (fread(entry, 1, sizeof(entry), r->f) != sizeof(entry))
+			return -1;
+		if (get_le32(entry + 4) == 0)
+			break;
+		r->pbp_index[i] = get_le32(entry);
+		r->pbp_index[i + 1] = get_le32(entry) + get_le32(entry + 4);
+	}
+
+	r->pbp_blocks = i;
+	r->pbp_base = psiso + 0x100000;
+	r->pbp_cur_block = (uint32_t)-1;
+	r->type = IMG_PBP;
+	return 0;
+}
+
+static void img_close(struct img_reader *r)
+{
+	if (r->f)
+		fclose(r->f);
+	free(r->pbp_index);
+	free(r->pbp_buf);
+	free(r->pbp_zbuf);
+	if (r->z_init)
+		inflateEnd(&r->z);
+#ifdef HAVE_CHD
+	if (r->chd)
+		chd_close(r->chd);
+	free(r->chd_buf);
+#endif
+	memset(r, 0, sizeof(*r));
+}
+
+static int img_open(struct img_reader *r, const char *path)
+{
+	char datafile[4096];
+	const char *ext = strrchr(path, '.');
+
+	memset(r, 0, sizeof(*r));
+
+#ifdef HAVE_CHD
+	if (ext && strcasecmp(ext, ".chd") == 0) {
+		if (chd_open(path, CHD_OPEN_READ, NULL, &r->chd) != CHDERR_NONE)
+			return -1;
+		const uint32_t hunkbytes = chd_get_header(r->chd)->hunkbytes;
+		r->chd_hunk_frames = hunkbytes / CHD_FRAME;
+		r->chd_cur_hunk = (uint32_t)-1;
+		if (r->chd_hunk_frames == 0 || !(r->chd_buf = (uint8_t *)malloc(hunkbytes)))
+			return -1;
+		r->type = IMG_CHD;
+		return 0;
+	}
+#endif
+
+	if (ext && strcasecmp(ext, ".cue") == 0) {
+		if (cue_data_file(path, datafile, sizeof(datafile)))
+			return -1;
+		path = datafile;
+	}
+
+	if (!(r->f = fopen(path, "rb")))
+		return -1;
+
+	if (ext && strcasecmp(ext, ".pbp") == 0)
+		return pbp_open(r);
+
+	// Raw or 2048-byte sectors, whichever has the volume descriptor
+	r->type = IMG_RAW;
+	if (is_pvd(img_read(r, 16)))
+		return 0;
+	r->type = IMG_2048;
+	return 0;
+}
+
+/*
+ * ISO9660, following CheckCdrom() in misc.c
+ */
+
+// Find 'name' in directory at 'extent', returns LBA and size of its
+//  record, 'name' can have subdirs separated by '\' or '/'.
+static int iso_find(struct img_reader *r, uint32_t extent, uint32_t size,
+                    const char *name, uint32_t *lba, uint32_t *len)
+{
+	const char *sep = name + strcspn(name, "\\/");
+	const size_t comp_len = sep - name;
+	uint32_t sect, i;
+
+	// Directories of PSX discs are a sector or two, don't follow huge ones
+	if (size > 16 * 2048)
+		size = 16 * 2048;
+
+	for (sect = 0; sect * 2048 < size; sect++) {
+		const uint8_t *buf = img_read(r, extent + sect);
+		if (!buf)
+			return -1;
+
+		for (i = 0; i < 2048 && buf[i] != 0; i += buf[i]) {
+			const uint8_t *rec = buf + i;
+			const uint8_t name_len = rec[32];
+			const char *rec_name = (const char *)rec + 33;
+
+			if (i + 33 + name_len > 2048)
+				break;
+			if (name_len < comp_len || strncasecmp(rec_name, name, comp_len) != 0)
+				continue;
+			// Match 'NAME' to 'NAME;1' too
+			if (name_len > comp_len && rec_name[comp_len] != ';')
+				continue;
+
+			if (*sep) {
+				if (!(rec[25] & 2))
+					continue;
+				return iso_find(r, get_le32(rec + 2), get_le32(rec + 10),
+				                sep + 1, lba, len);
+			}
+
+			*lba = get_le32(rec + 2);
+			*len = get_le32(rec + 10);
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static uint8_t region_of_id(const char *id)
+{
+	switch (toupper((unsigned char)id[2])) {
+	case 'E': return ISO_REGION_PAL;
+	case 'U': return ISO_REGION_NTSC_U;
+	case 'P': return ISO_REGION_NTSC_J;
+	default:  return ISO_REGION_UNKNOWN;
+	}
+}
+
+static void scan_image(const char *path, struct iso_info *info)
+{
+	struct img_reader r;
+	uint8_t pvd[2048];
+	char cnf[2049], exename[256] = "";
+	const uint8_t *buf;
+	uint32_t root_lba, root_len, lba, len;
+	int i, c;
+
+	memset(info, 0, sizeof(*info));
+
+	if (img_open(&r, path) != 0 || !is_pvd(buf = img_read(&r, 16)))
+		goto done;
+	memcpy(pvd, buf, sizeof(pvd));
+
+	root_lba = get_le32(pvd + 156 + 2);
+	root_len = get_le32(pvd + 156 + 10);
+
+	if (iso_find(&r, root_lba, root_len, "SYSTEM.CNF", &lba, &len) == 0) {
+		if (!(buf = img_read(&r, lba)))
+			goto done;
+		memcpy(cnf, buf, 2048);
+		cnf[2048] = '\0';
+
+		char *p = strstr(cnf, "cdrom:");
+		if (!p)
+			goto done;
+		p += 6;
+		while (*p == '\\' || *p == '/')
+			p++;
+		for (i = 0; i < (int)sizeof(exename) - 1 && p[i] && !isspace((unsigned char)p[i]); i++)
+			exename[i] = p[i];
+		exename[i] = '\0';
+
+		// Disc ID is the alphanumerics of the EXE name, as CheckCdrom()
+		//  does it. EXE in a subdir: ID taken from whole path just the same.
+		for (i = 0, c = 0; exename[i] && exename[i] != ';' && c < (int)sizeof(info->id) - 1; i++)
+			if (isalnum((unsigned char)exename[i]))
+				info->id[c++] = exename[i];
+	} else if (iso_find(&r, root_lba, root_len, "PSX.EXE", &lba, &len) == 0) {
+		strcpy(exename, "PSX.EXE");
+	} else {
+		goto done;
+	}
+
+	if (info->id[0] == '\0')
+		strcpy(info->id, "SLUS99999");
+
+	if (iso_find(&r, root_lba, root_len, exename, &lba, &len) != 0 ||
+	    !(buf = img_read(&r, lba)) || memcmp(buf, "PS-X EXE", 8) != 0)
+		goto done;
+
+	info->exe_pc0 = get_le32(buf + 0x10);
+	info->exe_t_addr = get_le32(buf + 0x18);
+	info->exe_t_size = get_le32(buf + 0x1c);
+
+	memcpy(info->label, pvd + 40, 32);
+	info->label[32] = '\0';
+	for (i = 31; i >= 0 && (info->label[i] == ' ' || info->label[i] == '\0'); i--)
+		info->label[i] = '\0';
+	if (info->label[0] == '\0')
+		strcpy(info->label, info->id);
+
+	info->region = region_of_id(info->id);
+	info->is_psx = 1;
+
+done:
+	img_close(&r);
+}
+
+/*
+ * On-disk index
+ *
+ * Header: magic, sizeof(struct iso_info), # of entries. Each entry: path
+ * length (uint16_t), path, mtime, size (int64_t), struct iso_info. Host
+ * byte order, it's a cache local to the device.
+ */
+
+static void index_load(void)
+{
+	char magic[8], path[4096];
+	uint32_t info_size, count, i;
+	uint16_t path_len;
+	int64_t mtime, size;
+	struct iso_info info;
+	FILE *f = fopen(index_file, "rb");
+
+	if (!f)
+		return;
+
+	if (fread(magic, 1, 8, f) != 8 || memcmp(magic, index_magic, 8) != 0 ||
+	    fread(&info_size, 4, 1, f) != 1 || info_size != sizeof(info) ||
+	    fread(&count, 4, 1, f) != 1)
+		goto done;
+
+	for (i = 0; i < count; i++) {
+		if (fread(&path_len, 2, 1, f) != 1 || path_len >= sizeof(path) ||
+		    fread(path, 1, path_len, f) != path_len ||
+		    fread(&mtime, 8, 1, f) != 1 || fread(&size, 8, 1, f) != 1 ||
+		    fread(&info, sizeof(info), 1, f) != 1)
+			break;
+		path[path_len] = '\0';
+		info.id[sizeof(info.id) - 1] = '\0';
+		info.label[sizeof(info.label) - 1] = '\0';
+		if (info.region > ISO_REGION_PAL)
+			info.region = ISO_REGION_UNKNOWN;
+		entry_set(path, mtime, size, &info);
+	}
+
+done:
+	fclose(f);
+	dirty = 0;
+}
+
+// Call without lock held. Entries are copied to a buffer under lock and
+//  written with it released, so the browser never waits on a slow card.
+//  Written to a temporary file first, so the index is never left
+//  half-written.
+static void index_save(void)
+{
+	char tmpname[4096 + 4];
+	uint32_t info_size = sizeof(struct iso_info), count = 0, i;
+	size_t len = 16;
+	struct index_entry *e;
+	uint8_t *buf, *p;
+	FILE *f;
+
+	pthread_mutex_lock(&save_lock);
+	pthread_mutex_lock(&lock);
+	if (!dirty || index_file[0] == '\0') {
+		pthread_mutex_unlock(&lock);
+		pthread_mutex_unlock(&save_lock);
+		return;
+	}
+
+	for (i = 0; i < INDEX_BUCKETS; i++) {
+		for (e = buckets[i]; e; e = e->next) {
+			len += 2 + strlen(e->path) + 16 + sizeof(e->info);
+			count++;
+		}
+	}
+
+	if (!(p = buf = (uint8_t *)malloc(len))) {
+		pthread_mutex_unlock(&lock);
+		pthread_mutex_unlock(&save_lock);
+		return;
+	}
+
+	memcpy(p, index_magic, 8);   p += 8;
+	memcpy(p, &info_size, 4);    p += 4;
+	memcpy(p, &count, 4);        p += 4;
+	for (i = 0; i < INDEX_BUCKETS; i++) {
+		for (e = buckets[i]; e; e = e->next) {
+			const uint16_t path_len = strlen(e->path);
+			memcpy(p, &path_len, 2);                 p += 2;
+			memcpy(p, e->path, path_len);            p += path_len;
+			memcpy(p, &e->mtime, 8);                 p += 8;
+			memcpy(p, &e->size, 8);                  p += 8;
+			memcpy(p, &e->info, sizeof(e->info));    p += sizeof(e->info);
+		}
+	}
+	dirty = 0;
+	pthread_mutex_unlock(&lock);
+
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", index_file);
+	if (!(f = fopen(tmpname, "wb")) ||
+	    (fwrite(buf, 1, len, f) != len) | fclose(f) ||
+	    rename(tmpname, index_file) != 0) {
+		printf("ERROR: can't write ISO index %s\n", index_file);
+		remove(tmpname);
+		// Try again next time
+		pthread_mutex_lock(&lock);
+		dirty = 1;
+		pthread_mutex_unlock(&lock);
+	}
+
+	free(buf);
+	pthread_mutex_unlock(&save_lock);
+}
+
+/*
+ * Worker threads
+ */
+
+static void *index_worker(void *arg)
+{
+	struct iso_info info;
+	struct stat st;
+
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		while (!quit && queue_pos == queue_len)
+			pthread_cond_wait(&queue_cond, &lock);
+		if (quit)
+			break;
+
+		char *path = queue[queue_pos++];
+		busy_threads++;
+		pthread_mutex_unlock(&lock);
+
+		// Images that vanished keep their entry, they may be on a
+		//  card that's not inserted right now.
+		if (stat(path, &st) == 0 && strlen(path) < 4096) {
+			pthread_mutex_lock(&lock);
+			struct index_entry *e = entry_find(path);
+			const int fresh = e && e->mtime == (int64_t)st.st_mtime &&
+			                  e->size == (int64_t)st.st_size;
+			pthread_mutex_unlock(&lock);
+
+			if (!fresh) {
+				scan_image(path, &info);
+				pthread_mutex_lock(&lock);
+				entry_set(path, st.st_mtime, st.st_size, &info);
+				pthread_mutex_unlock(&lock);
+			}
+		}
+		free(path);
+
+		pthread_mutex_lock(&lock);
+		busy_threads--;
+		if (queue_pos == queue_len && busy_threads == 0) {
+			pthread_mutex_unlock(&lock);
+			index_save();
+			pthread_mutex_lock(&lock);
+		}
+	}
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+// Call with lock held
+static void start_threads(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int n = cpus < 1 ? 1 : cpus > INDEX_MAX_THREADS ? INDEX_MAX_THREADS : (int)cpus;
+
+	for (num_threads = 0; num_threads < n; num_threads++)
+		if (pthread_create(&threads[num_threads], NULL, index_worker, NULL) != 0)
+			break;
+}
+
+void IsoIndexInit(const char *filename)
+{
+	pthread_mutex_lock(&lock);
+	snprintf(index_file, sizeof(index_file), "%s", filename);
+	index_load();
+	pthread_mutex_unlock(&lock);
+}
+
+void IsoIndexShutdown(void)
+{
+	int i;
+
+	pthread_mutex_lock(&lock);
+	quit = 1;
+	pthread_cond_broadcast(&queue_cond);
+	pthread_mutex_unlock(&lock);
+
+	// Workers finish the image they're on, the rest of the queue is dropped
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+	num_threads = 0;
+
+	pthread_mutex_lock(&lock);
+	for (i = queue_pos; i < queue_len; i++)
+		free(queue[i]);
+	free(queue);
+	queue = NULL;
+	queue_pos = queue_len = queue_cap = 0;
+	pthread_mutex_unlock(&lock);
+
+	index_save();
+
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < INDEX_BUCKETS; i++) {
+		while (buckets[i]) {
+			struct index_entry *e = buckets[i];
+			buckets[i] = e->next;
+			free(e->path);
+			free(e);
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+void IsoIndexQueueClear(void)
+{
+	pthread_mutex_lock(&lock);
+	for (int i = queue_pos; i < queue_len; i++)
+		free(queue[i]);
+	queue_pos = queue_len = 0;
+	pthread_mutex_unlock(&lock);
+}
+
+void IsoIndexQueue(const char *path)
+{
+	char *p = strdup(path);
+	if (!p)
+		return;
+
+	pthread_mutex_lock(&lock);
+	if (quit) {
+		pthread_mutex_unlock(&lock);
+		free(p);
+		return;
+	}
+
+	if (queue_len == queue_cap) {
+		// Reclaim consumed slots before growing
+		if (queue_pos > 0) {
+			memmove(queue, queue + queue_pos, (queue_len - queue_pos) * sizeof(*queue));
+			queue_len -= queue_pos;
+			queue_pos = 0;
+		}
+		if (queue_len == queue_cap) {
+			int cap = queue_cap ? queue_cap * 2 : 256;
+			char **q = (char **)realloc(queue, cap * sizeof(*queue));
+			if (!q) {
+				pthread_mutex_unlock(&lock);
+				free(p);
+				return;
+			}
+			queue = q;
+			queue_cap = cap;
+		}
+	}
+	queue[queue_len++] = p;
+
+	if (num_threads == 0)
+		start_threads();
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&lock);
+}
+
+int IsoIndexLookup(const char *path, struct iso_info *info)
+{
+	struct index_entry *e;
+
+	// Browser redraws every frame, it shouldn't wait for an index save
+	if (pthread_mutex_trylock(&lock) != 0)
+		return 0;
+
+	if ((e = entry_find(path)) != NULL)
+		*info = e->info;
+	pthread_mutex_unlock(&lock);
+
+	return e != NULL;
+}
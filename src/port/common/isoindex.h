@@ -0,0 +1,56 @@
+#ifndef ISOINDEX_H
+#define ISOINDEX_H
+
+/*
+ * Background indexer of CD images for the file browser
+ *
+ * FileReq() queues the images of the directory it shows, worker threads
+ * read disc ID, region, volume label and boot EXE header out of each
+ * image and the browser shows them for the selected file. Results are
+ * kept in an on-disk index keyed by path, mtime and size, so an image is
+ * only opened again after it changed.
+ *
+ * Images are read with a small reader of their own, not the cdriso
+ * plugin, whose state belongs to the running game and isn't reentrant.
+ * Supported: raw/2048-byte .bin/.img/.iso/.mdf, .cue, .pbp (1st disc),
+ * and .chd when built with HAVE_CHD.
+ */
+
+#include <stdint.h>
+
+enum {
+	ISO_REGION_UNKNOWN = 0,
+	ISO_REGION_NTSC_U,
+	ISO_REGION_NTSC_J,
+	ISO_REGION_PAL
+};
+
+struct iso_info {
+	uint8_t  is_psx;      // 0: not a PSX disc, unreadable or unsupported
+	uint8_t  region;      // ISO_REGION_*
+	char     id[10];      // Disc ID, same as CdromId after CheckCdrom()
+	char     label[33];   // Volume label, trailing spaces removed
+	uint32_t exe_pc0;     // Header of EXE SYSTEM.CNF boots
+	uint32_t exe_t_addr;
+	uint32_t exe_t_size;
+};
+
+// Load index from 'filename', where it is written back to as well
+void IsoIndexInit(const char *filename);
+
+// Stop worker threads and write index if it changed
+void IsoIndexShutdown(void);
+
+// Drop files queued earlier but not scanned yet, e.g. when the browser
+//  leaves their directory.
+void IsoIndexQueueClear(void);
+
+// Queue image 'path' for scanning. Workers skip it if its index entry
+//  matches mtime and size of the file. Threads are started on first call.
+void IsoIndexQueue(const char *path);
+
+// Returns 1 and fills 'info' if 'path' is indexed. Never blocks: returns 0
+//  when it is not scanned yet, or the index is busy.
+int IsoIndexLookup(const char *path, struct iso_info *info);
+
+#endif //ISOINDEX_H
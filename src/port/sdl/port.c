@@ -10,6 +10,10 @@
 #include "perfmon.h"
 #include "cheat.h"
 #include "cdrom_hacks.h"
+#include "psxtrace.h"
+#include "psxhlesig.h"
+#include "isoindex.h"
+#include "iothread.h"
 #include <SDL.h>
 
 /* MAXPATHLEN inclusion */
@@ -25,6 +29,7 @@
 // New gpulib from Notaz's PCSX Rearmed handles duties common to GPU plugins
 #ifdef USE_GPULIB
 #include "gpu/gpulib/gpu.h"
+#include "gpu/gpulib/gpu_trace.h"
 #endif
 
 #ifdef GPU_UNAI
@@ -85,6 +90,10 @@ void config_load();
 void config_save();
 void update_window_size(int w, int h, uint_fast8_t ntsc_fix);
 
+#ifdef USE_EVENT_TRACE
+static char EventTraceFile[MAXPATHLEN] = "";
+#endif
+
 static void pcsx4all_exit(void)
 {
 	// unload cheats
@@ -93,6 +102,8 @@ static void pcsx4all_exit(void)
 	// Store config to file
 	config_save();
 
+	IsoIndexShutdown();
+
 	if (SDL_MUSTLOCK(screen))
 		SDL_UnlockSurface(screen);
 
@@ -113,6 +124,15 @@ static void pcsx4all_exit(void)
 #endif
 
 	if (pcsx4all_initted == true) {
+#ifdef USE_GPULIB
+		gpu_trace_stop();
+#endif
+#ifdef USE_EVENT_TRACE
+		if (EventTraceFile[0] != '\0') {
+			psxTraceStop();
+			psxTraceExport(EventTraceFile);
+		}
+#endif
 		ReleasePlugins();
 		psxShutdown();
 	}
@@ -121,6 +141,9 @@ static void pcsx4all_exit(void)
 static char McdPath1[MAXPATHLEN] = "";
 static char McdPath2[MAXPATHLEN] = "";
 static char BiosFile[MAXPATHLEN] = "";
+#ifdef USE_GPULIB
+static char GpuTraceFile[MAXPATHLEN] = "";
+#endif
 
 static char homedir[MAXPATHLEN];
 static char memcardsdir[MAXPATHLEN];
@@ -315,6 +338,12 @@ void config_load()
 			if (value < FRAMESKIP_MIN || value > FRAMESKIP_MAX)
 				value = FRAMESKIP_OFF;
 			Config.FrameSkip = value;
+		} else if (!strcmp(line, "FastForwardSpeed")) {
+			sscanf(arg, "%d", &value);
+			if (value != FAST_FORWARD_UNCAPPED &&
+			    (value < FAST_FORWARD_MIN || value > FAST_FORWARD_MAX))
+				value = FAST_FORWARD_DEFAULT;
+			Config.FastForwardSpeed = value;
 		} else if (!strcmp(line, "VideoScaling")) {
 			sscanf(arg, "%d", &value);
 			Config.VideoScaling = value;
@@ -454,6 +483,7 @@ void config_save()
 		   "ShowFps %d\n"
 		   "FrameLimit %d\n"
 		   "FrameSkip %d\n"
+		   "FastForwardSpeed %d\n"
 		   "VideoScaling %d\n"
 		   "AnalogDigital %d\n",
 		   CONFIG_VERSION, Config.Xa, Config.Mdec, Config.PsxAuto, Config.Cdda,
@@ -464,7 +494,8 @@ void config_save()
 		   Config.RCntFix, Config.VSyncWA, Config.Cpu, Config.PsxType,
 		   Config.McdSlot1, Config.McdSlot2, Config.SpuIrq, Config.SyncAudio,
 		   Config.SpuUpdateFreq, Config.ForcedXAUpdates, Config.ShowFps,
-		   Config.FrameLimit, Config.FrameSkip, Config.VideoScaling, Config.AnalogDigital);
+		   Config.FrameLimit, Config.FrameSkip, Config.FastForwardSpeed,
+		   Config.VideoScaling, Config.AnalogDigital);
 
 #ifdef SPU_PCSXREARMED
 	fprintf(f, "SpuUseInterpolation %d\n", spu_config.iUseInterpolation);
@@ -514,6 +545,8 @@ int state_load(int slot)
 	char savename[512];
 	sprintf(savename, "%s/%s.%d.sav", sstatesdir, CdromId, slot);
 
+	// Savestate might still be being written
+	ioSync();
 	if (FileExists(savename)) {
 		return LoadState(savename);
 	}
@@ -561,6 +594,17 @@ static uint16_t pad1_buttons = 0xFFFF;
 
 static unsigned short analog1 = 0;
 
+// Fast-forward: emu runs at Config.FastForwardSpeed times normal speed
+//  (or as fast as it can), drawing only enough frames to keep the screen
+//  updating and dropping audio that doesn't fit in the output buffer
+static void set_fast_forward(uint_fast8_t enable)
+{
+	pl_set_fast_forward(enable);
+#ifdef SPU_PCSXREARMED
+	spu_config.iFastForward = enable;
+#endif
+}
+
 SDL_Joystick* sdl_joy[2];
 
 #define joy_commit_range    8192
@@ -650,6 +694,12 @@ void pad_update()
 				popup_menu = true;
 				break;
 			case SDLK_v: { Config.ShowFps=!Config.ShowFps; } break;
+			case SDLK_f: set_fast_forward(!pl_data.fast_forward); break;
+			case SDLK_PAGEDOWN:
+				// SELECT+R2 toggles fast-forward on devices without keyboard
+				if (keys[SDLK_ESCAPE])
+					set_fast_forward(!pl_data.fast_forward);
+				break;
 				default: break;
 			}
 			break;
@@ -888,7 +938,9 @@ void video_flip(void)
 	if (SDL_MUSTLOCK(screen))
 		SDL_UnlockSurface(screen);
 
+	pl_flip_begin();
 	SDL_Flip(screen);
+	pl_flip_end();
 
 	if (SDL_MUSTLOCK(screen))
 		SDL_LockSurface(screen);
@@ -1265,6 +1317,7 @@ int main (int argc, char **argv)
 	Config.McdSlot2 = -1;
 	update_memcards(0);
 	strcpy(Config.PatchesDir, patchesdir);
+	strcpy(Config.BootCacheDir, sstatesdir);
 	strcpy(Config.BiosDir, biosdir);
 	strcpy(Config.Bios, "scph1001.bin");
 	
@@ -1308,6 +1361,7 @@ int main (int argc, char **argv)
 	Config.ShowFps=0;    // 0=don't show FPS
 	Config.FrameLimit = true;
 	Config.FrameSkip = FRAMESKIP_OFF;
+	Config.FastForwardSpeed = FAST_FORWARD_DEFAULT;
 
 	//zear - Added option to store the last visited directory.
 #ifndef __WIN32__
@@ -1402,11 +1456,22 @@ int main (int argc, char **argv)
 	// Load config from file.
 	config_load();
 
+	// Load Psy-Q library function signatures for HLE, if there are any
+	char hlesigs[MAXPATHLEN];
+	snprintf(hlesigs, sizeof(hlesigs), "%s/hlesigs.txt", homedir);
+	psxHleSigLoad(hlesigs);
+
+	// Index of CD images shown in file browser
+	char isoindex[MAXPATHLEN];
+	snprintf(isoindex, sizeof(isoindex), "%s/isoindex.dat", homedir);
+	IsoIndexInit(isoindex);
+
 	// Check if LastDir exists.
 	probe_lastdir();
 
 	// command line options
 	uint_fast8_t param_parse_error = 0;
+	uint_fast8_t start_fast_forward = false;
 	for (int i = 1; i < argc; i++) {
 		// PCSX
 		// XA audio disabled
@@ -1533,6 +1598,60 @@ int main (int argc, char **argv)
 			Config.FrameLimit = 0;
 		}
 
+		// start in fast-forward mode
+		if (strcmp(argv[i],"-fastforward") == 0) {
+			start_fast_forward = true;
+		}
+
+		// fast-forward speed
+		if (strcmp(argv[i],"-ffspeed") == 0) {
+			int val = -1000;
+			if (++i < argc) {
+				val = atoi(argv[i]);
+				if (val == FAST_FORWARD_UNCAPPED ||
+				    (val >= FAST_FORWARD_MIN && val <= FAST_FORWARD_MAX)) {
+					Config.FastForwardSpeed = val;
+				} else {
+					val = -1000;
+				}
+			} else {
+				printf("ERROR: missing value for -ffspeed\n");
+			}
+
+			if (val == -1000) {
+				printf("ERROR: -ffspeed value must be 0 (uncapped) or between %d..%d\n",
+				       FAST_FORWARD_MIN, FAST_FORWARD_MAX);
+				param_parse_error = true;
+				break;
+			}
+		}
+
+#ifdef USE_GPULIB
+		// Record GPU command stream to file, for replay with gpu_replay
+		if (strcmp(argv[i],"-gputrace") == 0) {
+			if (++i < argc) {
+				strncpy(GpuTraceFile, argv[i], MAXPATHLEN-1);
+			} else {
+				printf("ERROR: missing value for -gputrace\n");
+				param_parse_error = true;
+				break;
+			}
+		}
+#endif
+
+#ifdef USE_EVENT_TRACE
+		// Record hot-path events, written as Chrome trace JSON on exit
+		if (strcmp(argv[i],"-eventtrace") == 0) {
+			if (++i < argc) {
+				strncpy(EventTraceFile, argv[i], MAXPATHLEN-1);
+			} else {
+				printf("ERROR: missing value for -eventtrace\n");
+				param_parse_error = true;
+				break;
+			}
+		}
+#endif
+
 		// frame skip
 		if (strcmp(argv[i],"-frameskip") == 0) {
 			int val = -1000;
@@ -1781,6 +1900,8 @@ int main (int argc, char **argv)
 
 	// Initialize plugin_lib, gpulib
 	pl_init();
+	if (start_fast_forward)
+		set_fast_forward(true);
 
 	if (cdrfilename[0] != '\0') {
 		if (CheckCdrom() == -1) {
@@ -1826,6 +1947,15 @@ int main (int argc, char **argv)
 		printf("Running BIOS.\n");
 	}
 
+#ifdef USE_GPULIB
+	if (GpuTraceFile[0] != '\0')
+		gpu_trace_start(GpuTraceFile);
+#endif
+#ifdef USE_EVENT_TRACE
+	if (EventTraceFile[0] != '\0')
+		psxTraceStart();
+#endif
+
 	if ((cdrfilename[0] != '\0') || (filename[0] != '\0') || (Config.HLE == 0)) {
 		psxCpu->Execute();
 	}
@@ -270,6 +270,112 @@ static size_t strlen_internal(char* p)
 	return size_of_array;
 }
 
+/* Native memory/string routines:
+ *  Ranges are resolved to host pointers once and handled with host
+ *  memcpy()/memset(). The result must match the BIOS's forward byte loops,
+ *  also for overlapping copies. Emulated time is charged roughly what the
+ *  BIOS loops would take, and the CPU is told about writes to RAM so any
+ *  code there is recompiled (recClear() skips pages with no code).
+ */
+#define BIOS_COPY_CYCLES(n)  ((n) * 6 * BIAS)  // lb/sb/3x addiu/bgtz per byte
+#define BIOS_FILL_CYCLES(n)  ((n) * 4 * BIAS)  // sb/2x addiu/bgtz per byte
+
+/* Host pointer to 'len' bytes at PS1 address 'addr', or NULL if they aren't
+ *  contiguous in host memory, i.e. the range wraps at the end of RAM or
+ *  crosses into another region. */
+static uint8_t *bios_host_range(uint32_t addr, uint32_t len)
+{
+	const uint32_t page = addr >> 16;
+	const uint32_t last_page = (addr + len - 1) >> 16;
+	uint8_t *base = psxMemRLUT[page];
+
+	if (len == 0 || addr + len - 1 < addr)
+		return NULL;
+	for (uint32_t i = 1; page + i <= last_page; i++)
+		if (psxMemRLUT[page + i] != base + (i << 16))
+			return NULL;
+	return base + (addr & 0xffff);
+}
+
+static void bios_clear(uint32_t addr, uint32_t len)
+{
+	// Only RAM can hold recompiled code
+	if ((addr & 0x1fffffff) >= 0x800000)
+		return;
+
+	// Clearing 2MB covers all of RAM
+	if (len > 0x200000)
+		len = 0x200000;
+
+	// Split range where it wraps at end of a 2MB mirror, Clear() expects
+	//  a range within RAM.
+	while (len) {
+		uint32_t chunk = 0x200000 - (addr & 0x1fffff);
+		if (chunk > len)
+			chunk = len;
+		psxCpu->Clear(addr & ~3, ((addr & 3) + chunk + 3) / 4);
+		addr = (addr & ~0x1fffff) | ((addr + chunk) & 0x1fffff);
+		len -= chunk;
+	}
+}
+
+/* Copy with the semantics of a forward byte loop */
+static void bios_copy(uint32_t dst, uint32_t src, uint32_t len)
+{
+	uint8_t *d = bios_host_range(dst, len);
+	const uint8_t *s = bios_host_range(src, len);
+
+	if (d && s) {
+		if (d > s && d < s + len) {
+			// Destination overlaps ahead of source: a byte loop repeats
+			//  the first (d - s) bytes, copy them one period at a time.
+			const uint32_t period = d - s;
+			for (uint32_t i = 0; i < len; i += period)
+				memcpy(d + i, s + i, len - i < period ? len - i : period);
+		} else {
+			memmove(d, s, len);
+		}
+	} else {
+		for (uint32_t i = 0; i < len; i++)
+			*PSXM(dst + i) = *PSXM(src + i);
+	}
+
+	bios_clear(dst, len);
+	psxRegs.cycle += BIOS_COPY_CYCLES(len);
+}
+
+static void bios_fill(uint32_t dst, uint8_t val, uint32_t len)
+{
+	uint8_t *d = bios_host_range(dst, len);
+
+	if (d) {
+		memset(d, val, len);
+	} else {
+		for (uint32_t i = 0; i < len; i++)
+			*PSXM(dst + i) = val;
+	}
+
+	bios_clear(dst, len);
+	psxRegs.cycle += BIOS_FILL_CYCLES(len);
+}
+
+/* Length of string at PS1 address 'addr', scanning a 64KB page at a time */
+static uint32_t bios_strlen(uint32_t addr)
+{
+	uint32_t len = 0;
+
+	while (len < 0x200000) {
+		const uint32_t avail = 0x10000 - (addr & 0xffff);
+		const uint8_t *p = PSXM(addr);
+		const uint8_t *z = (const uint8_t *)memchr(p, '\0', avail);
+		if (z)
+			return len + (z - p);
+		len += avail;
+		addr += avail;
+	}
+	return len;
+}
+
 INLINE void softCall(uint32_t pc) {
 	pc0 = pc;
 	ra = 0x80001000;
@@ -764,35 +870,33 @@ void psxBios_strncmp(void) { // 0x18
 }
 
 void psxBios_strcpy(void) { // 0x19
-	char *p1 = (char *)Ra0, *p2 = (char *)Ra1;
 	if (a0 == 0 || a1 == 0)
 	{
 		v0 = 0;
 		pc0 = ra;
 		return;
 	}
-	while ((*p1++ = *p2++) != '\0');
+	bios_copy(a0, a1, bios_strlen(a1) + 1);
 
 	v0 = a0; pc0 = ra;
 }
 
 void psxBios_strncpy(void) { // 0x1a
-	char *p1 = (char *)Ra0, *p2 = (char *)Ra1;
-	int32_t n = a2, i;
+	int32_t n = a2;
 	if (a0 == 0 || a1 == 0)
 	{
 		v0 = 0;
 		pc0 = ra;
 		return;
 	}
-	for (i = 0; i < n; i++) {
-		if ((*p1++ = *p2++) == '\0') {
-			while (++i < n) {
-				*p1++ = '\0';
-			}
-			v0 = a0; pc0 = ra;
-			return;
-		}
+	if (n > 0) {
+		// Copy string incl. terminator (if within n), zero-pad the rest
+		uint32_t len = bios_strlen(a1) + 1;
+		if (len > (uint32_t)n)
+			len = n;
+		bios_copy(a0, a1, len);
+		if (len < (uint32_t)n)
+			bios_fill(a0 + len, 0, n - len);
 	}
 
 	v0 = a0; pc0 = ra;
@@ -950,20 +1054,18 @@ void psxBios_tolower(void) { // 0x26
 }
 
 void psxBios_bcopy(void) { // 0x27
-	char *p1 = (char *)Ra1, *p2 = (char *)Ra0;
 	v0 = a0;
 	if (a0 == 0 || a2 > 0x7FFFFFFF)
 	{
 		pc0 = ra;
 		return;
 	}
-	while ((int32_t)a2-- > 0) *p1++ = *p2++;
+	bios_copy(a1, a0, a2);
 	a2 = 0;
 	pc0 = ra;
 }
 
 void psxBios_bzero(void) { // 0x28
-	char *p = (char *)Ra0;
 	v0 = a0;
 	/* Same as memset here (See memset below) */
 	if (a1 > 0x7FFFFFFF || a1 == 0)
@@ -977,7 +1079,7 @@ void psxBios_bzero(void) { // 0x28
 		pc0 = ra;
 		return;
 	}
-	while ((int32_t)a1-- > 0) *p++ = '\0';
+	bios_fill(a0, 0, a1);
 	a1 = 0;
 	pc0 = ra;
 }
@@ -999,24 +1101,18 @@ void psxBios_bcmp() { // 0x29
 }
 
 void psxBios_memcpy() { // 0x2a
-	char *p1 = (char *)Ra0, *p2 = (char *)Ra1;
-	int32_t n=0;
 	v0 = a0;
 	if (a0 == 0 || a2 > 0x7FFFFFFF)
 	{
 		pc0 = ra;
 		return;
 	}
-	while ((int32_t)a2-- > 0) {
-		n++;
-		*p1++ = *p2++;
-	}
+	bios_copy(a0, a1, a2);
 	a2 = 0;
 	pc0 = ra;
 }
 
 void psxBios_memset() { // 0x2b
-	char *p = (char *)Ra0;
 	v0 = a0;
 	if (a2 > 0x7FFFFFFF || a2 == 0)
 	{
@@ -1029,13 +1125,13 @@ void psxBios_memset() { // 0x2b
 		pc0 = ra;
 		return;
 	}
-	while ((int32_t)a2-- > 0) *p++ = (char)a1;
+	bios_fill(a0, (uint8_t)a1, a2);
 	a2 = 0;
 	v0 = a0; pc0 = ra;
 }
 
 void psxBios_memmove() { // 0x2c
-	char *p1 = (char *)Ra0, *p2 = (char *)Ra1;
+	uint8_t *p1 = PSXM(a0), *p2 = PSXM(a1);
 	v0 = a0;
 	if (a0 == 0 || a2 > 0x7FFFFFFF)
 	{
@@ -1043,13 +1139,20 @@ void psxBios_memmove() { // 0x2c
 		return;
 	}
 	if (p2 <= p1 && p2 + a2 > p1) {
-		a2++; // BUG: copy one more byte here
-		p1 += a2;
-		p2 += a2;
-		while ((int32_t)a2-- > 0) *--p1 = *--p2;
+		// Backward copy, BUG: copies one more byte here
+		uint32_t len = a2 + 1;
+		uint8_t *d = bios_host_range(a0, len), *s = bios_host_range(a1, len);
+		if (d && s) {
+			memmove(d, s, len);
+		} else {
+			while (len--) *PSXM(a0 + len) = *PSXM(a1 + len);
+		}
+		bios_clear(a0, a2 + 1);
+		psxRegs.cycle += BIOS_COPY_CYCLES(a2 + 1);
 	} else {
-		while ((int32_t)a2-- > 0) *p1++ = *p2++;
+		bios_copy(a0, a1, a2);
 	}
+	a2 = 0xffffffff;  // Left at -1 by the BIOS loop
 	pc0 = ra;
 }
 
@@ -1096,27 +1199,35 @@ static inline int qscmp(char *a, char *b) {
 	return (int32_t)v0;
 }
 
+// Elements are exchanged through a small buffer, a chunk at a time.
+//  Pointers may be equal, so memmove() is used.
+#define QS_CHUNK 64
+
 static inline void qexchange(char *i, char *j) {
-	char t;
-	int n = qswidth;
+	char t[QS_CHUNK];
+	uint32_t n = qswidth, k;
 
-	do {
-		t = *i;
-		*i++ = *j;
-		*j++ = t;
-	} while (--n);
+	psxRegs.cycle += BIOS_COPY_CYCLES(qswidth);
+	for (; n; n -= k, i += k, j += k) {
+		k = n < QS_CHUNK ? n : QS_CHUNK;
+		memcpy(t, i, k);
+		memmove(i, j, k);
+		memcpy(j, t, k);
+	}
 }
 
 static inline void q3exchange(char *i, char *j, char *k) {
-	char t;
-	int n = qswidth;
+	char t[QS_CHUNK];
+	uint32_t n = qswidth, c;
 
-	do {
-		t = *i;
-		*i++ = *k;
-		*k++ = *j;
-		*j++ = t;
-	} while (--n);
+	psxRegs.cycle += BIOS_COPY_CYCLES(qswidth) * 3 / 2;
+	for (; n; n -= c, i += c, j += c, k += c) {
+		c = n < QS_CHUNK ? n : QS_CHUNK;
+		memcpy(t, i, c);
+		memmove(i, k, c);
+		memmove(k, j, c);
+		memcpy(j, t, c);
+	}
 }
 
 static void qsort_main(char *a, char *l) {
@@ -1181,9 +1292,15 @@ loop:
 }
 
 void psxBios_qsort() { // 0x31
+	const uint32_t base = a0, size = a1 * a2;
+	char *p = (char *)bios_host_range(a0, size);
+
 	qswidth = a2;
 	qscmpfunc = a3;
-	qsort_main((char *)Ra0, (char *)Ra0 + a1 * a2);
+	if (p && qswidth) {
+		qsort_main(p, p + size);
+		bios_clear(base, size);
+	}
 
 	pc0 = ra;
 }
@@ -115,11 +115,22 @@ enum {
 	FRAMESKIP_MAX  = 3
 };
 
+enum {
+	FAST_FORWARD_UNCAPPED = 0,
+	FAST_FORWARD_MIN      = 2,      // 1x is normal speed, not allowed
+	FAST_FORWARD_MAX      = 8
+};
+
+#ifndef FAST_FORWARD_DEFAULT
+#define FAST_FORWARD_DEFAULT 4
+#endif
+
 typedef struct {
 	char Bios[MAXPATHLEN];
 	char BiosDir[MAXPATHLEN];
 	char LastDir[MAXPATHLEN];
 	char PatchesDir[MAXPATHLEN];  // PPF patch files
+	char BootCacheDir[MAXPATHLEN]; // Cached state after BIOS init, empty: disabled
 	uint_fast8_t Xa; /* 0=XA enabled, 1=XA disabled */
 	uint_fast8_t Mdec; /* 0=Black&White Mdecs Only Disabled, 1=Black&White Mdecs Only Enabled */
 	uint_fast8_t PsxAuto; /* 1=autodetect system (pal or ntsc) */
@@ -156,6 +167,8 @@ typedef struct {
 	uint_fast8_t FrameLimit;  // Limit to NTSC/PAL framerate
 
 	int8_t      FrameSkip;	// -1: AUTO  0: OFF  1-3: FIXED
+	int8_t      FastForwardSpeed; // 0: uncapped  2-8: fixed multiple of
+	                              //  normal speed while fast-forwarding
 	int8_t      VideoScaling; // 0: Hardware  1: Software Nearest
 
 	// Options for performance monitor
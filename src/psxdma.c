@@ -24,6 +24,9 @@
 
 #include "psxdma.h"
 #include "gpu.h"
+#include "mdec.h"
+#include "plugin_lib.h"
+#include "psxtrace.h"
 
 // Dma0/1 in Mdec.c
 // Dma3   in CdRom.c
@@ -180,7 +183,20 @@ void psxDma2(uint32_t madr, uint32_t bcr, uint32_t chcr) { // GPU
 			}
 			// BA blocks * BS words (word = 32-bits)
 			words = (bcr >> 16) * (bcr & 0xffff);
-			GPU_writeDataMem(ptr, words);
+			if (mdecIsOutput(madr)) {
+				// Uploading decoded FMV frame: make sure MDEC worker
+				//  thread is done with it (it should be by now)
+				mdecSync();
+#ifdef USE_FMV_STATS
+				const unsigned start = pl_fmv_clock();
+				GPU_writeDataMem(ptr, words);
+				pl_fmv_add(PL_FMV_UPLOAD, pl_fmv_clock() - start);
+#else
+				GPU_writeDataMem(ptr, words);
+#endif
+			} else {
+				GPU_writeDataMem(ptr, words);
+			}
 
 			HW_DMA2_MADR = SWAPu32(madr + words * 4);
 
@@ -192,7 +208,9 @@ void psxDma2(uint32_t madr, uint32_t bcr, uint32_t chcr) { // GPU
 #ifdef PSXDMA_LOG
 			PSXDMA_LOG("*** DMA 2 - GPU dma chain *** %x addr = %x size = %x\n", chcr, madr, bcr);
 #endif
+			TRACE_BEGIN_EV(TRACE_GPU_DMA_CHAIN, madr, 0);
 			size = GPU_dmaChain((uint32_t *)psxM, madr & 0x1fffff);
+			TRACE_END_EV(TRACE_GPU_DMA_CHAIN, size, 0);
 			if ((int)size <= 0)
 				size = gpuDmaChainSize(madr);
 			HW_GPU_STATUS &= ~PSXGPU_nBUSY;
@@ -38,6 +38,7 @@
 #include "plugins.h"
 #include "psxdma.h"
 #include "mdec.h"
+#include "psxtrace.h"
 
 // When psxRegs.cycle is >= this figure, it gets reset to 0:
 static const uint32_t reset_cycle_val_at = 2000000000;
@@ -255,7 +256,9 @@ void psxEvqueueDispatchAndRemoveFront(psxRegisters *pr)
 	}
 #endif
 
+	TRACE_BEGIN_EV(TRACE_PSXINT, ev, 0);
 	evqueue.funcs[ev]();  // Dispatch event
+	TRACE_END_EV(TRACE_PSXINT, ev, 0);
 
 	// Queue can never be totally empty, as certain persistent events will
 	//  always be rescheduled during dispatch above.
@@ -23,6 +23,7 @@
 */
 
 #include "psxhle.h"
+#include "psxhlesig.h"
 
 static void hleDummy(void) {
 	psxRegs.pc = psxRegs.GPR.n.ra;
@@ -91,5 +92,5 @@ static void hleExecRet(void) {
 void (*psxHLEt[8])(void) = {
 	hleDummy, hleA0, hleB0, hleC0,
 	hleBootstrap, hleExecRet,
-	hleDummy, hleDummy
+	psxHleSigDispatch, hleDummy
 };
@@ -0,0 +1,342 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * HLE of Psy-Q SDK library functions found by signature, see psxhlesig.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "psxhlesig.h"
+#include "psxcommon.h"
+#include "r3000a.h"
+#include "psxmem.h"
+
+// Longest function prefix hashed, in words
+#define SIG_MAX_WORDS 64
+
+// Most functions that can be patched at once
+#define SIG_MAX_PATCHED 32
+
+// Most signatures that can be loaded
+#define SIG_MAX 256
+
+/*
+ * Native handlers
+ *
+ * Each replaces a whole library function: it reads args from a0..a3,
+ * sets v0 and returns to ra like the function would.
+ */
+
+/* Invalidate recompiled code in 'words' words of RAM at 'addr'. Split where
+ *  range wraps at end of a 2MB mirror, Clear() expects a range within RAM. */
+static void hle_clear(uint32_t addr, uint32_t words)
+{
+	if (words > 0x200000/4)
+		words = 0x200000/4;
+
+	while (words) {
+		uint32_t chunk = (0x200000 - (addr & 0x1ffffc)) / 4;
+		if (chunk > words)
+			chunk = words;
+		psxCpu->Clear(addr & ~3, chunk);
+		addr = (addr & ~0x1fffff) | ((addr + chunk*4) & 0x1fffff);
+		words -= chunk;
+	}
+}
+
+/* libgpu ClearOTagR(ot, n): same result as the OT clear DMA6 it starts,
+ *  each entry pointing at the previous one and ot[0] ending the list. The
+ *  register setup and the wait for the DMA are skipped. */
+static void hle_ClearOTagR(void)
+{
+	const uint32_t ot = psxRegs.GPR.n.a0;
+	const int32_t n = psxRegs.GPR.n.a1;
+
+	for (int32_t i = n - 1; i > 0; i--)
+		psxMu32ref(ot + i*4) = SWAPu32((ot + (i-1)*4) & 0xffffff);
+	if (n > 0) {
+		psxMu32ref(ot) = SWAPu32(0xffffff);
+		hle_clear(ot, n);
+	}
+	psxRegs.cycle += n > 0 ? n : 0;  // Same as DMA6
+
+	psxRegs.GPR.n.v0 = ot;
+	psxRegs.pc = psxRegs.GPR.n.ra;
+}
+
+/*
+ * Functions signatures can be given for. Only add functions whose handler
+ * reproduces everything the library code does: e.g. DrawOTag() and
+ * LoadImage() go through libgpu's command queue and DrawSync() callbacks,
+ * which a native handler would bypass.
+ */
+static const struct {
+	const char *name;
+	void (*handler)(void);
+} hle_funcs[] = {
+	{ "ClearOTagR", hle_ClearOTagR },
+	{ NULL, NULL }
+};
+
+struct hle_sig {
+	const char *name;
+	uint32_t words;         // # of words hashed, see sig_hash()
+	uint32_t hash;
+	void (*handler)(void);
+};
+
+static struct hle_sig sigs[SIG_MAX];
+static int num_sigs;
+
+static struct {
+	uint32_t addr;          // RAM address of patched function, mirror-masked
+	uint32_t orig;          // 1st instruction the HLE opcode replaced
+	const struct hle_sig *sig;
+} patched[SIG_MAX_PATCHED];
+static int num_patched;
+
+/* FNV-1a hash of function at 'addr' up to and including the delay slot of
+ *  its first 'jr ra', or SIG_MAX_WORDS words. Fields filled in by the
+ *  linker are masked: J/JAL targets, LUI immediates, and immediates of
+ *  I-type ops using a register loaded by LUI (the %lo half). Returns the
+ *  # of words hashed in 'words'. */
+static uint32_t sig_hash(uint32_t addr, uint32_t *words)
+{
+	uint32_t hash = 0x811c9dc5;
+	uint32_t lui_regs = 0;
+	uint32_t n, end = SIG_MAX_WORDS;
+
+	for (n = 0; n < end; n++) {
+		uint32_t code = psxMu32(addr + n*4);
+		const uint32_t op = code >> 26;
+		const uint32_t rs = (code >> 21) & 0x1f;
+
+		if (code == 0x03e00008)           // jr ra, hash its delay slot too
+			end = n + 2 < end ? n + 2 : end;
+
+		if (op == 0x02 || op == 0x03) {   // J, JAL
+			code &= 0xfc000000;
+		} else if (op == 0x0f) {          // LUI
+			code &= 0xffff0000;
+			lui_regs |= 1 << ((code >> 16) & 0x1f);
+		} else if (op >= 0x08 && (lui_regs & (1 << rs))) {
+			code &= 0xffff0000;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			hash ^= (code >> (i*8)) & 0xff;
+			hash *= 0x01000193;
+		}
+	}
+
+	*words = n;
+	return hash;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void sig_patch(uint32_t addr, const struct hle_sig *sig)
+{
+	if (num_patched >= SIG_MAX_PATCHED) {
+		printf("HLE sig: too many functions patched, skipping %s at %08x\n",
+		       sig->name, addr);
+		return;
+	}
+
+	patched[num_patched].addr = addr & 0x1fffff;
+	patched[num_patched].orig = psxMu32(addr);
+	patched[num_patched].sig = sig;
+	num_patched++;
+
+	psxMu32ref(addr) = SWAPu32(PSXHLESIG_OPCODE);
+	psxCpu->Clear(addr, 1);
+	printf("HLE sig: %s at %08x\n", sig->name, addr);
+}
+
+int psxHleSigLoad(const char *filename)
+{
+	char line[256], name[64];
+	unsigned words, hash;
+	int lineno = 0, i;
+	FILE *f = fopen(filename, "r");
+
+	num_sigs = 0;
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+			continue;
+
+		if (sscanf(line, "%63s %u %x", name, &words, &hash) != 3 ||
+		    words == 0 || words > SIG_MAX_WORDS) {
+			printf("HLE sig: %s:%d: bad line\n", filename, lineno);
+			continue;
+		}
+
+		for (i = 0; hle_funcs[i].name; i++)
+			if (strcmp(hle_funcs[i].name, name) == 0)
+				break;
+		if (!hle_funcs[i].name) {
+			printf("HLE sig: %s:%d: no handler for %s\n", filename, lineno, name);
+			continue;
+		}
+
+		if (num_sigs == SIG_MAX) {
+			printf("HLE sig: %s: too many signatures\n", filename);
+			break;
+		}
+		sigs[num_sigs].name = hle_funcs[i].name;
+		sigs[num_sigs].words = words;
+		sigs[num_sigs].hash = hash;
+		sigs[num_sigs].handler = hle_funcs[i].handler;
+		num_sigs++;
+	}
+
+	fclose(f);
+	printf("HLE sig: loaded %d signatures from %s\n", num_sigs, filename);
+	return 0;
+}
+
+void psxHleSigScan(uint32_t t_addr, uint32_t t_size)
+{
+	uint32_t *targets;
+	uint32_t num_targets = 0, i, j;
+
+	// A new executable replaces the code patched before
+	num_patched = 0;
+
+#ifndef PSXHLESIG_LOG
+	if (num_sigs == 0)
+		return;
+#endif
+
+	t_addr &= ~3;
+	t_size = (t_size / 4) * 4;
+	if (t_size == 0 || t_size > 0x200000)
+		return;
+
+	targets = (uint32_t *)malloc(t_size);
+	if (!targets) {
+		printf("HLE sig: out of memory\n");
+		return;
+	}
+
+	// Functions of interest are the JAL targets inside the text section
+	for (i = 0; i < t_size; i += 4) {
+		const uint32_t code = psxMu32(t_addr + i);
+		if ((code >> 26) != 0x03)
+			continue;
+		const uint32_t target = ((t_addr + i + 4) & 0xf0000000) | ((code & 0x03ffffff) << 2);
+		if (target - t_addr < t_size)
+			targets[num_targets++] = target;
+	}
+
+	qsort(targets, num_targets, sizeof(uint32_t), cmp_u32);
+
+	for (i = 0; i < num_targets; i++) {
+		if (i > 0 && targets[i] == targets[i-1])
+			continue;
+
+		uint32_t words;
+		const uint32_t hash = sig_hash(targets[i], &words);
+
+#ifdef PSXHLESIG_LOG
+		printf("HLE sig: function %08x: %u %08x\n", targets[i], words, hash);
+#endif
+
+		for (j = 0; j < (uint32_t)num_sigs; j++) {
+			if (sigs[j].words == words && sigs[j].hash == hash) {
+				sig_patch(targets[i], &sigs[j]);
+				break;
+			}
+		}
+	}
+
+	free(targets);
+}
+
+void psxHleSigDispatch(void)
+{
+	// PC is already past the HLE opcode, which replaced 1st instruction
+	const uint32_t addr = (psxRegs.pc - 4) & 0x1fffff;
+
+	for (int i = 0; i < num_patched; i++) {
+		if (patched[i].addr == addr) {
+			patched[i].sig->handler();
+			psxBranchTest();
+			return;
+		}
+	}
+
+	// Stale patch, i.e. state saved by an older build from a session that
+	//  patched other code. Savestates are written without patches now.
+	printf("HLE sig: no handler for %08x\n", psxRegs.pc - 4);
+	psxRegs.pc = psxRegs.GPR.n.ra;
+	psxBranchTest();
+}
+
+/* Drop entry 'i' of patched[], keeping order */
+static void sig_drop(int i)
+{
+	num_patched--;
+	memmove(&patched[i], &patched[i+1], (num_patched - i) * sizeof(patched[0]));
+}
+
+void psxHleSigUnpatch(void)
+{
+	for (int i = 0; i < num_patched; ) {
+		const uint32_t addr = patched[i].addr;
+
+		// Code loaded over the function since it was patched is left alone
+		if (psxMu32(addr) != PSXHLESIG_OPCODE) {
+			sig_drop(i);
+			continue;
+		}
+
+		psxMu32ref(addr) = SWAPu32(patched[i].orig);
+		i++;
+	}
+}
+
+void psxHleSigRepatch(void)
+{
+	for (int i = 0; i < num_patched; ) {
+		const uint32_t addr = patched[i].addr;
+		uint32_t words;
+
+		// Memory might hold another game or another version of it after
+		//  loading a savestate, only patch what still matches signature.
+		if (sig_hash(addr, &words) != patched[i].sig->hash ||
+		    words != patched[i].sig->words) {
+			sig_drop(i);
+			continue;
+		}
+
+		patched[i].orig = psxMu32(addr);
+		psxMu32ref(addr) = SWAPu32(PSXHLESIG_OPCODE);
+		psxCpu->Clear(addr, 1);
+		i++;
+	}
+}
@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * HLE of Psy-Q SDK library functions found by signature
+ *
+ * When an executable is loaded, every function it calls with JAL is
+ * fingerprinted: its code up to 'jr ra' is hashed with relocated fields
+ * (jump targets, LUI immediates and the low halves that pair with them)
+ * masked out, so the same library version hashes the same in any game.
+ * Functions matching an entry of the signature table get their first
+ * instruction replaced by an HLE opcode dispatching to a native handler
+ * through psxHLEt[].
+ *
+ * Signatures are read from a text file, one per line:
+ *
+ *   <function name> <# of words hashed> <hash in hex>
+ *
+ * Fingerprints differ between library versions, so a function can have
+ * several lines. Define PSXHLESIG_LOG to print the fingerprint of every
+ * function found, then pick out library functions with a symbol map or a
+ * disassembly of the game. Names must match a handler in psxhlesig.c.
+ */
+
+#ifndef PSXHLESIG_H
+#define PSXHLESIG_H
+
+#include <stdint.h>
+
+//#define PSXHLESIG_LOG
+
+// Load signature file, returns 0 on success, -1 if it can't be opened
+int psxHleSigLoad(const char *filename);
+
+// Fingerprint functions called within text section of loaded executable,
+//  patch those with native handlers.
+void psxHleSigScan(uint32_t t_addr, uint32_t t_size);
+
+// Savestates hold the original code, so a session that patched nothing or
+//  other functions runs the real code after loading them. Unpatch restores
+//  original 1st instructions before memory is saved, where the HLE opcode
+//  is still in place, and forgets patches code was since loaded over.
+//  Repatch patches them again after saving or loading, where function
+//  still matches signature, and forgets the others.
+void psxHleSigUnpatch(void);
+void psxHleSigRepatch(void);
+
+// psxHLEt[] entry dispatching to the handler of the patched function
+void psxHleSigDispatch(void);
+
+// HLE opcode psxHleSigScan() patches in, psxHLEt[] index in low bits
+#define PSXHLESIG_OPCODE 0xec000006
+
+#endif //PSXHLESIG_H
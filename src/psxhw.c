@@ -52,6 +52,7 @@
 #include "mdec.h"
 #include "cdrom.h"
 #include "gpu.h"
+#include "psxtrace.h"
 
 void psxHwReset() {
 	//senquack - added Config.SpuIrq option from PCSX Rearmed/Reloaded:
@@ -579,7 +580,9 @@ void psxHwWrite16(uint32_t add, uint16_t value)
 	HW_DMA##n##_CHCR = SWAPu32(value); \
 \
 	if (SWAPu32(HW_DMA##n##_CHCR) & 0x01000000 && SWAPu32(HW_DMA_PCR) & (8 << (n * 4))) { \
+		TRACE_BEGIN_EV(TRACE_DMA0 + n, SWAPu32(HW_DMA##n##_MADR), SWAPu32(HW_DMA##n##_BCR)); \
 		psxDma##n(SWAPu32(HW_DMA##n##_MADR), SWAPu32(HW_DMA##n##_BCR), SWAPu32(HW_DMA##n##_CHCR)); \
+		TRACE_END_EV(TRACE_DMA0 + n, 0, 0); \
 	} \
 }
 
@@ -0,0 +1,215 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Hot-path event tracing, see psxtrace.h
+ */
+
+#include "psxtrace.h"
+
+#ifdef USE_EVENT_TRACE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "r3000a.h"
+#include "psxevents.h"
+
+struct trace_ring {
+	uint32_t head;       // Total # of records written, only writer updates
+	struct psxTraceRec rec[TRACE_RING_SIZE];
+};
+
+uint8_t psxTraceEnabled;
+
+static struct trace_ring *rings[TRACE_MAX_THREADS];
+static int num_rings;
+static uint64_t start_ns;
+
+// Ring of the calling thread, allocated on its first record
+static __thread struct trace_ring *thread_ring;
+static __thread uint8_t thread_ring_failed;
+
+static const char * const event_names[TRACE_EVENT_COUNT] = {
+	[TRACE_PSXINT]        = "event",
+	[TRACE_DMA0]          = "DMA0 MDEC in",
+	[TRACE_DMA0 + 1]      = "DMA1 MDEC out",
+	[TRACE_DMA0 + 2]      = "DMA2 GPU",
+	[TRACE_DMA0 + 3]      = "DMA3 CDROM",
+	[TRACE_DMA0 + 4]      = "DMA4 SPU",
+	[TRACE_DMA0 + 5]      = "DMA5",
+	[TRACE_DMA6]          = "DMA6 OT clear",
+	[TRACE_CDR_IRQ]       = "cdrInterrupt",
+	[TRACE_GPU_DMA_CHAIN] = "GPU_dmaChain",
+	[TRACE_RECOMPILE]     = "recRecompile",
+	[TRACE_FRAME_LIMIT]   = "pl_frame_limit"
+};
+
+static const char * const psxint_names[PSXINT_COUNT] = {
+	[PSXINT_SIO]             = "SIO",
+	[PSXINT_CDR]             = "CDR",
+	[PSXINT_CDREAD]          = "CDREAD",
+	[PSXINT_GPUDMA]          = "GPUDMA",
+	[PSXINT_MDECOUTDMA]      = "MDECOUTDMA",
+	[PSXINT_SPUDMA]          = "SPUDMA",
+	[PSXINT_GPUBUSY]         = "GPUBUSY",
+	[PSXINT_MDECINDMA]       = "MDECINDMA",
+	[PSXINT_GPUOTCDMA]       = "GPUOTCDMA",
+	[PSXINT_CDRDMA]          = "CDRDMA",
+	[PSXINT_NEWDRC_CHECK]    = "NEWDRC_CHECK",
+	[PSXINT_RCNT]            = "RCNT",
+	[PSXINT_CDRLID]          = "CDRLID",
+	[PSXINT_CDRPLAY]         = "CDRPLAY",
+	[PSXINT_SPUIRQ]          = "SPUIRQ",
+	[PSXINT_SPU_UPDATE]      = "SPU_UPDATE",
+	[PSXINT_RESET_CYCLE_VAL] = "RESET_CYCLE_VAL",
+	[PSXINT_SIO_SYNC_MCD]    = "SIO_SYNC_MCD"
+};
+
+static inline uint64_t trace_clock_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static struct trace_ring *trace_ring_alloc(void)
+{
+	if (thread_ring_failed)
+		return NULL;
+
+	// Slots are only ever claimed, never released, so a plain atomic
+	//  increment is all the synchronization needed between writers.
+	int slot = __sync_fetch_and_add(&num_rings, 1);
+	struct trace_ring *ring = NULL;
+	if (slot < TRACE_MAX_THREADS)
+		ring = (struct trace_ring *)calloc(1, sizeof(*ring));
+
+	if (!ring) {
+		printf("ERROR: psxtrace: can't allocate ring for thread, "
+		       "its events won't be recorded\n");
+		thread_ring_failed = 1;
+		return NULL;
+	}
+
+	__atomic_store_n(&rings[slot], ring, __ATOMIC_RELEASE);
+	return ring;
+}
+
+void psxTraceRecord(enum psxTraceEvent ev, enum psxTracePhase phase,
+                    uint32_t arg0, uint32_t arg1)
+{
+	struct trace_ring *ring = thread_ring;
+	if (!ring && !(ring = thread_ring = trace_ring_alloc()))
+		return;
+
+	uint32_t head = ring->head;
+	struct psxTraceRec *rec = &ring->rec[head & (TRACE_RING_SIZE-1)];
+	rec->time_ns = trace_clock_ns();
+	rec->cycle = psxRegs.cycle;
+	rec->ev = ev;
+	rec->phase = phase;
+	rec->arg[0] = arg0;
+	rec->arg[1] = arg1;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void psxTraceStart(void)
+{
+	int i, n = num_rings < TRACE_MAX_THREADS ? num_rings : TRACE_MAX_THREADS;
+	for (i = 0; i < n; i++)
+		if (rings[i])
+			rings[i]->head = 0;
+
+	start_ns = trace_clock_ns();
+	psxTraceEnabled = 1;
+	printf("Event trace recording started\n");
+}
+
+void psxTraceStop(void)
+{
+	psxTraceEnabled = 0;
+}
+
+static void trace_write_event(FILE *f, int tid, const struct psxTraceRec *rec,
+                              uint_fast8_t *first)
+{
+	static const char phases[] = { 'B', 'E', 'i' };
+	char name[64];
+
+	if (rec->ev >= TRACE_EVENT_COUNT || rec->phase > TRACE_INSTANT)
+		return;
+
+	if (rec->ev == TRACE_PSXINT && rec->arg[0] < PSXINT_COUNT)
+		snprintf(name, sizeof(name), "event %s", psxint_names[rec->arg[0]]);
+	else
+		snprintf(name, sizeof(name), "%s", event_names[rec->ev]);
+
+	// Chrome pairs 'E' with the last open 'B' of the thread, the name
+	//  in the 'E' record is only informative.
+	fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"psx\",\"ph\":\"%c\"%s,"
+	        "\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+	        "\"args\":{\"cycle\":%u,\"arg0\":%u,\"arg1\":%u}}",
+	        *first ? "" : ",", name, phases[rec->phase],
+	        rec->phase == TRACE_INSTANT ? ",\"s\":\"t\"" : "",
+	        (double)(int64_t)(rec->time_ns - start_ns) / 1000.0, tid,
+	        rec->cycle, rec->arg[0], rec->arg[1]);
+	*first = 0;
+}
+
+int psxTraceExport(const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (!f) {
+		printf("ERROR: psxtrace: can't open %s for writing\n", filename);
+		return -1;
+	}
+
+	uint_fast8_t first = 1;
+	unsigned total = 0;
+	int i, n = num_rings < TRACE_MAX_THREADS ? num_rings : TRACE_MAX_THREADS;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for (i = 0; i < n; i++) {
+		const struct trace_ring *ring = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+		if (!ring)
+			continue;
+
+		fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+		        "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+		        first ? "" : ",", i, i);
+		first = 0;
+
+		// Oldest surviving record first
+		uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		uint32_t pos = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+		for (; pos != head; pos++)
+			trace_write_event(f, i, &ring->rec[pos & (TRACE_RING_SIZE-1)], &first);
+		total += head - (head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0);
+	}
+	fprintf(f, "\n]}\n");
+
+	if (ferror(f) | fclose(f)) {
+		printf("ERROR: psxtrace: error writing %s\n", filename);
+		return -1;
+	}
+
+	printf("Event trace: wrote %u events to %s\n", total, filename);
+	return 0;
+}
+
+#endif //USE_EVENT_TRACE
@@ -0,0 +1,115 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Hot-path event tracing
+ *
+ * Probes write small fixed-size binary records (host time, emulated cycle,
+ * event id, two args) into a per-thread ring buffer. Nothing is formatted
+ * or written to disk while the emulator runs, so tracing disturbs timing
+ * far less than printf()-based logging like DEBUG_EVENTS or PSXDMA_LOG.
+ * Each ring has a single writer and no locks; when full, the oldest records
+ * are overwritten. After emulation stops, psxTraceExport() writes the most
+ * recent records of all threads as Chrome trace JSON, which can be loaded
+ * in chrome://tracing or https://ui.perfetto.dev
+ *
+ * Enable with USE_EVENT_TRACE below and run with '-eventtrace file.json'.
+ * Without USE_EVENT_TRACE, the probes compile to nothing.
+ */
+
+#ifndef PSXTRACE_H
+#define PSXTRACE_H
+
+#include <stdint.h>
+
+//#define USE_EVENT_TRACE
+
+// Records per thread, must be a power of two (records are 24 bytes)
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE (1 << 16)
+#endif
+
+// Max # of threads that can record
+#define TRACE_MAX_THREADS 8
+
+enum psxTraceEvent {
+	TRACE_PSXINT,        // Event dispatch,           arg0: enum psxEventNum
+	TRACE_DMA0,          // DMA, one id per channel,  arg0: madr arg1: bcr
+	TRACE_DMA6 = TRACE_DMA0 + 6,
+	TRACE_CDR_IRQ,       // cdrInterrupt(),           arg0: Irq  arg1: Stat
+	TRACE_GPU_DMA_CHAIN, // GPU_dmaChain(),           arg0: madr (end: words)
+	TRACE_RECOMPILE,     // Dynarec block,            arg0: PC   (end: bytes)
+	TRACE_FRAME_LIMIT,   // pl_frame_limit(),         (end: arg0: usecs slept)
+	TRACE_EVENT_COUNT
+};
+
+enum psxTracePhase {
+	TRACE_BEGIN,
+	TRACE_END,
+	TRACE_INSTANT
+};
+
+struct psxTraceRec {
+	uint64_t time_ns;    // Host monotonic clock
+	uint32_t cycle;      // psxRegs.cycle
+	uint16_t ev;         // enum psxTraceEvent
+	uint8_t  phase;      // enum psxTracePhase
+	uint8_t  unused;
+	uint32_t arg[2];
+};
+
+#ifdef USE_EVENT_TRACE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Non-zero while recording, checked by probes before doing anything else
+extern uint8_t psxTraceEnabled;
+
+void psxTraceStart(void);
+void psxTraceStop(void);
+
+// Write recorded events as Chrome trace JSON. Only call while no other
+//  thread is recording, i.e. after psxTraceStop() and emulation stopped.
+//  Returns 0 on success, -1 on error.
+int psxTraceExport(const char *filename);
+
+void psxTraceRecord(enum psxTraceEvent ev, enum psxTracePhase phase,
+                    uint32_t arg0, uint32_t arg1);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define TRACE_PROBE(ev, phase, arg0, arg1) \
+	do { \
+		if (psxTraceEnabled) \
+			psxTraceRecord((ev), (phase), (arg0), (arg1)); \
+	} while (0)
+
+#else
+
+#define TRACE_PROBE(ev, phase, arg0, arg1) do { } while (0)
+
+#endif //USE_EVENT_TRACE
+
+#define TRACE_BEGIN_EV(ev, arg0, arg1)   TRACE_PROBE(ev, TRACE_BEGIN, arg0, arg1)
+#define TRACE_END_EV(ev, arg0, arg1)     TRACE_PROBE(ev, TRACE_END, arg0, arg1)
+#define TRACE_INSTANT_EV(ev, arg0, arg1) TRACE_PROBE(ev, TRACE_INSTANT, arg0, arg1)
+
+#endif //PSXTRACE_H
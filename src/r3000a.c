@@ -31,6 +31,9 @@
 #include "mdec.h"
 #include "gte.h"
 #include "psxevents.h"
+#include "misc.h"
+#include "sio.h"
+#include "iothread.h"
 
 PcsxConfig Config;
 R3000Acpu *psxCpu=NULL;
@@ -39,6 +42,8 @@ psxRegisters psxRegs;
 int psxInit() {
 	printf("Running PCSX Version %s (%s).\n", PACKAGE_VERSION, __DATE__);
 
+	ioThreadInit();
+
 #ifdef PSXREC
 	#ifndef interpreter_none
 	if (Config.Cpu == CPU_INTERPRETER) {
@@ -57,10 +62,14 @@ int psxInit() {
 	return psxMemInit();
 }
 
-void psxReset() {
+// Set when loading BIOS boot cache failed, it's not used again this session
+static uint8_t boot_cache_disabled;
+
+static void psx_reset_machine() {
 
 	psxCpu->Reset();
 
+	mdecSync();
 	psxMemReset();
 
 	memset(&psxRegs, 0, sizeof(psxRegs));
@@ -80,9 +89,26 @@ void psxReset() {
 	psxEvqueueInit();  // Event scheduler queue
 	psxHwReset();
 	psxBiosInit();
+}
 
-	if (!Config.HLE)
-		psxExecuteBios();
+void psxReset() {
+	psx_reset_machine();
+
+	if (!Config.HLE) {
+		// Restore state cached after BIOS init on an earlier boot, or run
+		//  BIOS init and cache its result.
+		int ret = boot_cache_disabled ? -1 : BootCacheLoad();
+		if (ret > 0) {
+			// Cache was bad, start over from a clean machine without it
+			boot_cache_disabled = 1;
+			psx_reset_machine();
+		}
+		if (ret != 0) {
+			psxExecuteBios();
+			if (!boot_cache_disabled)
+				BootCacheSave();
+		}
+	}
 }
 
 void psxShutdown() {
@@ -90,9 +116,13 @@ void psxShutdown() {
 	//  psxM,psxH etc, if it has done so.
 	psxCpu->Shutdown();
 
+	mdecShutdown();
 	psxMemShutdown();
 	psxBiosShutdown();
 
+	// Finish queued memcard and savestate writes
+	sioSyncMcds();
+	ioThreadShutdown();
 }
 
 void psxException(uint32_t code, uint32_t bd) {
@@ -451,6 +451,139 @@ int rec_scan_for_MFHI_MFLO_sequence(uint32_t code_loc)
 	return instr_cnt;
 }
 
+/*
+ * Scans ahead from PS1 code location (the opcode following a GTE command) to
+ *  determine if the GTE FLAG register (cop2r63) written by the command is
+ *  dead, i.e. it is overwritten before anything could read it. FLAG is
+ *  overwritten by every GTE command and by CTC2 to cop2r63, and read only by
+ *  CFC2 from cop2r63. Scanning stops conservatively at any branch, jump,
+ *  SYSCALL, BREAK, HLE opcode or RFE, as code beyond lies in another block.
+ *
+ * Returns: 1 if FLAG is known to be overwritten before being read, 0 if not.
+ */
+int rec_scan_for_gte_flag_overwrite(uint32_t code_loc)
+{
+	// Max number of opcodes to scan ahead
+	const int scan_max = 32;
+
+	for (int i = 0; i < scan_max; ++i, code_loc += 4)
+	{
+		const uint32_t opcode = OPCODE_AT(code_loc);
+
+		// Skip any NOPs
+		if (opcode == 0)
+			continue;
+
+		if (_fOp_(opcode) == 0x12) {
+			if (_fRs_(opcode) & 0x10)                           // GTE command
+				return 1;
+			if (_fRs_(opcode) == 0x6 && _fRd_(opcode) == 31)    // CTC2 to FLAG
+				return 1;
+			if (_fRs_(opcode) == 0x2 && _fRd_(opcode) == 31)    // CFC2 from FLAG
+				return 0;
+			continue;
+		}
+
+		if ( _fOp_(opcode) == 0x3b ||  /* HLE */
+		    (_fOp_(opcode) == 0 && (_fFunct_(opcode) == 0xc ||  /* SYSCALL */
+		                            _fFunct_(opcode) == 0xd)) ||/* BREAK */
+		    (_fOp_(opcode) == 0x10 && _fRs_(opcode) == 0x10) ||  /* RFE */
+		     opcodeIsBranchOrJump(opcode) )
+		{
+			return 0;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Determines if the emitter for the opcode at PS1 code location might emit a
+ *  call to C code, or end the block. Only ALU, shift and multiply/divide
+ *  opcodes are known not to. A LUI is included when it's followed by a load,
+ *  since the LUI emitter might emit that load too (emitOptimizedStaticLoad()).
+ *  Used by the reg allocator to decide when caller-saved host regs must be
+ *  written back.
+ *
+ * Returns: 1 if opcode might call C code, 0 if it never does.
+ */
+int rec_opcode_may_call_c(uint32_t code_loc)
+{
+	const uint32_t opcode = OPCODE_AT(code_loc);
+
+	switch (_fOp_(opcode)) {
+		case 0x00: /* SPECIAL */
+			switch (_fFunct_(opcode)) {
+				case 0x00: case 0x02: case 0x03:            /* SLL, SRL, SRA */
+				case 0x04: case 0x06: case 0x07:            /* SLLV, SRLV, SRAV */
+				case 0x10: case 0x11: case 0x12: case 0x13: /* MFHI, MTHI, MFLO, MTLO */
+				case 0x18: case 0x19: case 0x1a: case 0x1b: /* MULT, MULTU, DIV, DIVU */
+				case 0x20: case 0x21: case 0x22: case 0x23: /* ADD, ADDU, SUB, SUBU */
+				case 0x24: case 0x25: case 0x26: case 0x27: /* AND, OR, XOR, NOR */
+				case 0x2a: case 0x2b:                       /* SLT, SLTU */
+					return 0;
+				default:
+					return 1;
+			}
+
+		case 0x08: case 0x09: case 0x0a: case 0x0b: /* ADDI, ADDIU, SLTI, SLTIU */
+		case 0x0c: case 0x0d: case 0x0e:            /* ANDI, ORI, XORI */
+			return 0;
+
+		case 0x0f: /* LUI */
+			return opcodeIsLoad(OPCODE_AT(code_loc + 4)) ||
+			       opcodeIsLoad(OPCODE_AT(code_loc + 8));
+
+		default:
+			return 1;
+	}
+}
+
+/*
+ * Determines if the ALU opcode at PS1 code location writes a GPR that is
+ *  overwritten before being read. Only straight-line code that never calls C
+ *  or ends the block is scanned (see rec_opcode_may_call_c()), so nothing
+ *  else can observe the reg between the two writes. Loads never count as the
+ *  overwrite: the opcode in their load delay slot sees the old value.
+ *
+ * Returns: # of the dead GPR if opcode can be skipped, 0 if not.
+ */
+int rec_scan_for_dead_write(uint32_t code_loc)
+{
+	// Max number of opcodes to scan ahead
+	const int scan_max = 8;
+
+	const uint32_t opcode = OPCODE_AT(code_loc);
+
+	if (opcode == 0 || !opcodeIsALU(opcode, NULL))
+		return 0;
+
+	const uint64_t dead_write = opcodeGetWrites(opcode) & ~BIT(0);
+	if (!dead_write)
+		return 0;
+
+	code_loc += 4;
+	for (int i = 0; i < scan_max; ++i, code_loc += 4)
+	{
+		const uint32_t next_opcode = OPCODE_AT(code_loc);
+
+		// Skip any NOPs
+		if (next_opcode == 0)
+			continue;
+
+		if (rec_opcode_may_call_c(code_loc))
+			return 0;
+
+		if (opcodeGetReads(next_opcode) & dead_write)
+			return 0;
+
+		if (opcodeGetWrites(next_opcode) & dead_write)
+			return __builtin_ctzll(dead_write);
+	}
+
+	return 0;
+}
+
 /*
  * Scans for sequential instructions at PS1 code location that can be safely
  *  ignored/discarded when recompiling. Stops when first sequence is found.
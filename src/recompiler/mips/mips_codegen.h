@@ -52,6 +52,9 @@
  *
  * MIPSREG_S0..S7  Reserved for reg allocator.
  *
+ * MIPSREG_T4..T7  Also used by reg allocator, but only between opcodes that
+ *                  call C code. See USE_TEMP_REGCACHE in regcache.h.
+ *
  * MIPSREG_S8      Holds pointer to psxRegs struct, a.k.a. PERM_REG_1.
  */
 typedef enum {
@@ -217,6 +220,12 @@ do { \
 #define SW(rd, rs, imm16) \
 	write32(0xac000000 | ((rs) << 21) | ((rd) << 16) | ((imm16) & 0xffff))
 
+#define SH(rd, rs, imm16) \
+	write32(0xa4000000 | ((rs) << 21) | ((rd) << 16) | ((imm16) & 0xffff))
+
+#define SB(rd, rs, imm16) \
+	write32(0xa0000000 | ((rs) << 21) | ((rd) << 16) | ((imm16) & 0xffff))
+
 #define LWL(rt, rs, imm16) \
 	write32(0x88000000 | ((rs) << 21) | ((rt) << 16) | ((imm16) & 0xffff))
 
@@ -325,6 +334,10 @@ do { \
 #define MULTU(rs, rt) \
 	write32(0x00000019 | ((rs) << 21) | ((rt) << 16))
 
+/* MIPS32r1 multiply-accumulate: HI:LO += rs * rt (signed) */
+#define MADD(rs, rt) \
+	write32(0x70000000 | ((rs) << 21) | ((rt) << 16))
+
 #define DIV(rs, rt) \
 	write32(0x0000001a | ((rs) << 21) | ((rt) << 16))
 
@@ -337,6 +350,12 @@ do { \
 #define MFHI(rd) \
 	write32(0x00000010 | ((rd) << 11))
 
+#define MTLO(rs) \
+	write32(0x00000013 | ((rs) << 21))
+
+#define MTHI(rs) \
+	write32(0x00000011 | ((rs) << 21))
+
 #define SLT(rd, rs, rt) \
 	write32(0x0000002a | ((rs) << 21) | ((rt) << 16) | ((rd) << 11))
 
@@ -482,6 +501,41 @@ do {                                                                           \
     }                                                                          \
 } while (0)
 
+/* Native self-loops: a block that branches back to its own beginning PC,
+ *  and could use a 'fastpath' return, can instead add its cycles to
+ *  psxRegs.cycle itself and branch directly back to its first instruction.
+ *  Only when psxRegs.io_cycle_counter is reached does it return to the
+ *  'fastpath' dispatch code, with $v1 set to 0 since the cycles are already
+ *  counted. That code then calls psxBranchTest(). Like 'fastpath' returns,
+ *  this assumes the block is not modified while it is looping.
+ *
+ * NOTE: Caller must first write back all PS1 regs and set $v0 to the block's
+ *       beginning PC, since the block expects both on entry.
+ */
+#define rec_recompile_use_native_loop(newpc__)                                 \
+    (rec_recompile_use_fastpath_return(newpc__) &&                             \
+     ((uintptr_t)recMem - (uintptr_t)recMemStart) < 0x10000)
+
+#define rec_recompile_end_native_loop()                                        \
+do {                                                                           \
+    const uint32_t cycles = ADJUST_CLOCK((pc-oldpc)/4);                             \
+    LW(TEMP_0, PERM_REG_1, off(cycle));                                        \
+    LW(TEMP_1, PERM_REG_1, off(io_cycle_counter));                             \
+    if (cycles <= 0x7fff) {                                                    \
+        ADDIU(TEMP_0, TEMP_0, cycles);                                         \
+    } else {                                                                   \
+        LI32(TEMP_2, cycles);                                                  \
+        ADDU(TEMP_0, TEMP_0, TEMP_2);                                          \
+    }                                                                          \
+    SLTU(TEMP_1, TEMP_0, TEMP_1);                                              \
+    uint32_t* const backpatch__ = recMem;                                      \
+    BNE(TEMP_1, 0, 0);                                                         \
+    *backpatch__ |= mips_relative_offset(backpatch__, recMemStart, 4);         \
+    SW(TEMP_0, PERM_REG_1, off(cycle)); /* <BD> */                             \
+    J(block_fast_ret_addr);                                                    \
+    LI16(MIPSREG_V1, 0); /* <BD> */                                            \
+} while (0)
+
 #define mips_relative_offset(source, offset, next) \
 	((((uint32_t)(offset) - ((uint32_t)(source) + (next))) >> 2) & 0xFFFF)
 
@@ -570,6 +624,9 @@ uint64_t opcodeGetWrites(const uint32_t op);
 
 int rec_scan_for_div_by_zero_check_sequence(uint32_t code_loc);
 int rec_scan_for_MFHI_MFLO_sequence(uint32_t code_loc);
+int rec_scan_for_gte_flag_overwrite(uint32_t code_loc);
+int rec_opcode_may_call_c(uint32_t code_loc);
+int rec_scan_for_dead_write(uint32_t code_loc);
 int rec_discard_scan(uint32_t code_loc, int *discard_type);
 const char* rec_discard_type_str(int discard_type);
 
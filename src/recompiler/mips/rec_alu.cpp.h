@@ -48,10 +48,24 @@ static void recADDIU()
 	if (!_Rs_ && IsConst(_Rt_) && GetConst(_Rt_) == (int32_t)_Imm_)
 		return;
 
+	// Adding an offset to a fuzzy address (pointer increment, struct member)
+	//  leaves it in the same region. Scratchpad lies too close to I/O to
+	//  assume this, so only a plain reg move keeps it. See recADDU().
+	const uint8_t fuzzy_ram_addr = !set_const && IsFuzzyRamAddr(_Rs_);
+	const uint8_t fuzzy_nonram_addr = !set_const && IsFuzzyNonramAddr(_Rs_);
+	const uint8_t fuzzy_scratchpad_addr = !set_const && (_Imm_ == 0) && IsFuzzyScratchpadAddr(_Rs_);
+
 	REC_ITYPE_RT_RS_I16(ADDIU,  _Rt_, _Rs_, _Imm_);
 
 	if (set_const)
 		SetConst(_Rt_, GetConst(_Rs_) + (int32_t)_Imm_);
+
+	if (fuzzy_ram_addr)
+		SetFuzzyRamAddr(_Rt_);
+	if (fuzzy_nonram_addr)
+		SetFuzzyNonramAddr(_Rt_);
+	if (fuzzy_scratchpad_addr)
+		SetFuzzyScratchpadAddr(_Rt_);
 }
 static void recADDI() { recADDIU(); }
 
@@ -220,6 +234,14 @@ static void recADDU()
 	if (!(rs_const && rt_const) && (rs_const || rt_const))
 	{
 		const uint32_t const_val = rs_const ? GetConst(_Rs_) : GetConst(_Rt_);
+		const uint32_t nonconst_reg = rs_const ? _Rt_ : _Rs_;
+
+		// Reg move (ADDU rd, rs, $zero): keep what is known about source reg
+		if (const_val == 0) {
+			fuzzy_ram_addr        = IsFuzzyRamAddr(nonconst_reg);
+			fuzzy_nonram_addr     = IsFuzzyNonramAddr(nonconst_reg);
+			fuzzy_scratchpad_addr = IsFuzzyScratchpadAddr(nonconst_reg);
+		}
 
 		if (const_val >= 0x80000000 && const_val < 0x80800000)
 			fuzzy_ram_addr = 1;
@@ -283,10 +305,23 @@ static void recOR()
 
 	const uint8_t set_const = IsConst(_Rs_) && IsConst(_Rt_);
 
+	// Reg move (OR rd, rs, $zero): keep what is known about source reg
+	const uint32_t move_src = !_Rt_ ? _Rs_ : (!_Rs_ ? _Rt_ : 0);
+	const uint8_t fuzzy_ram_addr        = move_src && IsFuzzyRamAddr(move_src);
+	const uint8_t fuzzy_nonram_addr     = move_src && IsFuzzyNonramAddr(move_src);
+	const uint8_t fuzzy_scratchpad_addr = move_src && IsFuzzyScratchpadAddr(move_src);
+
 	REC_RTYPE_RD_RS_RT(OR,  _Rd_, _Rs_, _Rt_);
 
 	if (set_const)
 		SetConst(_Rd_, GetConst(_Rs_) | GetConst(_Rt_));
+
+	if (fuzzy_ram_addr)
+		SetFuzzyRamAddr(_Rd_);
+	if (fuzzy_nonram_addr)
+		SetFuzzyNonramAddr(_Rd_);
+	if (fuzzy_scratchpad_addr)
+		SetFuzzyScratchpadAddr(_Rd_);
 }
 
 static void recXOR()
@@ -17,8 +17,24 @@
 /* Convert some small forwards conditional branches to modern conditional moves */
 #define USE_CONDITIONAL_MOVE_OPTIMIZATIONS
 
+/* Blocks branching back to their own beginning loop without returning to the
+ *  dispatch loop, checking for pending events only at the back edge.
+ *  See rec_recompile_end_native_loop() in mips_codegen.h
+ */
+#define USE_NATIVE_SELF_LOOPS
+
 static uint8_t convertBranchToConditionalMoves();
 
+/* Can block branching to 'bpc' loop natively? (branches to its beginning) */
+static inline uint8_t useNativeLoop(const uint32_t bpc)
+{
+#ifdef USE_NATIVE_SELF_LOOPS
+	return rec_recompile_use_native_loop(bpc);
+#else
+	return 0;
+#endif
+}
+
 enum {
 	BCU_FIRST_INSTRUCTION_MAYBE_EXECUTED  = 0,
 	BCU_FIRST_INSTRUCTION_ALWAYS_EXECUTED = 1
@@ -280,15 +296,20 @@ static void iJumpNormal(uint32_t bpc)
 
 	// Can block use 'fastpath' return? (branches backward to its beginning)
 	const uint8_t use_fastpath_return = rec_recompile_use_fastpath_return(bpc);
+	const uint8_t use_native_loop = useNativeLoop(bpc);
 
 	rec_recompile_end_part1();
 	regClearJump();
 
 	// Only need to set $v0 to new PC when not returning to 'fastpath'.
-	if (!use_fastpath_return)
+	//  Native loops need it, as $v0 is expected to hold PC on block entry.
+	if (!use_fastpath_return || use_native_loop)
 		emitBlockReturnPC(bpc, BCU_FIRST_INSTRUCTION_ALWAYS_EXECUTED);
 
-	rec_recompile_end_part2(use_fastpath_return);
+	if (use_native_loop)
+		rec_recompile_end_native_loop();
+	else
+		rec_recompile_end_part2(use_fastpath_return);
 
 	end_block = 1;
 }
@@ -453,6 +474,7 @@ static void emitBxxZ(int andlink, uint32_t bpc, uint32_t nbpc)
 
 	// Can block use 'fastpath' return? (branches backward to its beginning)
 	const uint8_t use_fastpath_return = rec_recompile_use_fastpath_return(bpc);
+	const uint8_t use_native_loop = (dt != 2) && useNativeLoop(bpc);
 
 	regPushState();
 
@@ -466,7 +488,8 @@ static void emitBxxZ(int andlink, uint32_t bpc, uint32_t nbpc)
 	}
 
 	// Only need to set $v0 to new PC when not returning to 'fastpath'.
-	if (!use_fastpath_return) {
+	//  Native loops need it, as $v0 is expected to hold PC on block entry.
+	if (!use_fastpath_return || use_native_loop) {
 		if (bd_slot_loc == (uintptr_t)recMem)
 			emitBlockReturnPC(bpc, BCU_FIRST_INSTRUCTION_ALWAYS_EXECUTED);  // <BD slot> (if instruction is emitted)
 		else
@@ -483,7 +506,10 @@ static void emitBxxZ(int andlink, uint32_t bpc, uint32_t nbpc)
 	if (bd_slot_loc == (uintptr_t)recMem)
 		NOP();  // <BD slot>
 
-	rec_recompile_end_part2(use_fastpath_return);
+	if (use_native_loop)
+		rec_recompile_end_native_loop();
+	else
+		rec_recompile_end_part2(use_fastpath_return);
 
 	regPopState();
 
@@ -590,9 +616,11 @@ static void emitBxx(uint32_t bpc)
 
 	// Can block use 'fastpath' return? (branches backward to its beginning)
 	const uint8_t use_fastpath_return = rec_recompile_use_fastpath_return(bpc);
+	const uint8_t use_native_loop = useNativeLoop(bpc);
 
 	// Only need to set $v0 to new PC when not returning to 'fastpath'.
-	if (!use_fastpath_return)
+	//  Native loops need it, as $v0 is expected to hold PC on block entry.
+	if (!use_fastpath_return || use_native_loop)
 		emitBlockReturnPC(bpc, BCU_FIRST_INSTRUCTION_ALWAYS_EXECUTED);  // <BD slot> (if instruction is emitted)
 
 	// If indirect block returns are in use, load host $ra with block return
@@ -605,7 +633,10 @@ static void emitBxx(uint32_t bpc)
 	if (bd_slot_loc == (uintptr_t)recMem)
 		NOP();  // <BD slot>
 
-	rec_recompile_end_part2(use_fastpath_return);
+	if (use_native_loop)
+		rec_recompile_end_native_loop();
+	else
+		rec_recompile_end_part2(use_fastpath_return);
 
 	fixup_branch(backpatch);
 	regUnlock(br1);
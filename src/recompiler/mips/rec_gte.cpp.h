@@ -22,13 +22,32 @@
 //  creates load stalls.
 #define SKIP_MFC2_WRITEBACK
 
+// Emit native code for RTPS, RTPT, NCLIP, AVSZ3, AVSZ4 and MVMVA instead of
+//  calling the C GTE functions, whenever a scan ahead shows the FLAG register
+//  they compute is overwritten before being read. FLAG is then not computed.
+//  When FLAG might be read, the C functions are still called.
+#define USE_GTE_NATIVE_OPS
+
+// Call the gteXXX_nf() versions of the C GTE functions, which don't compute
+//  FLAG, whenever a scan ahead shows FLAG is overwritten before being read.
+#define USE_GTE_FLAGLESS_FUNCS
+
+#ifdef USE_GTE_FLAGLESS_FUNCS
+#define GTE_FLAG_IS_DEAD() (!branch && rec_scan_for_gte_flag_overwrite(pc))
+#else
+#define GTE_FLAG_IS_DEAD() 0
+#endif
 
 /* Emit code to call a GTE func that takes no arguments */
 #define CP2_FUNC_0(f) \
 extern void gte##f(); \
+extern void gte##f##_nf(); \
 void rec##f() \
 { \
-	JAL(gte##f); \
+	if (GTE_FLAG_IS_DEAD()) \
+		JAL(gte##f##_nf); \
+	else \
+		JAL(gte##f); \
 	NOP(); /* <BD slot> */ \
 }
 
@@ -38,14 +57,24 @@ void rec##f() \
  */
 #define CP2_FUNC_1(f) \
 extern void gte##f(uint32_t gteop); \
+extern void gte##f##_nf(uint32_t gteop); \
 void rec##f() \
 { \
-	JAL(gte##f); \
+	if (GTE_FLAG_IS_DEAD()) \
+		JAL(gte##f##_nf); \
+	else \
+		JAL(gte##f); \
 	LI16(MIPSREG_A0, (uint16_t)(psxRegs.code >> 10)); /* <BD slot> */ \
 }
 
+#ifndef USE_GTE_NATIVE_OPS
 CP2_FUNC_0(RTPS)
 CP2_FUNC_0(NCLIP)
+CP2_FUNC_0(AVSZ3)
+CP2_FUNC_0(AVSZ4)
+CP2_FUNC_0(RTPT)
+CP2_FUNC_1(MVMVA)
+#endif
 CP2_FUNC_0(NCDS)
 CP2_FUNC_0(NCDT)
 CP2_FUNC_0(CDP)
@@ -54,14 +83,10 @@ CP2_FUNC_0(CC)
 CP2_FUNC_0(NCS)
 CP2_FUNC_0(NCT)
 CP2_FUNC_0(DPCT)
-CP2_FUNC_0(AVSZ3)
-CP2_FUNC_0(AVSZ4)
-CP2_FUNC_0(RTPT)
 CP2_FUNC_0(NCCT)
 CP2_FUNC_1(OP)
 CP2_FUNC_1(DPCS)
 CP2_FUNC_1(INTPL)
-CP2_FUNC_1(MVMVA)
 CP2_FUNC_1(SQR)
 CP2_FUNC_1(DCPL)
 CP2_FUNC_1(GPF)
@@ -128,6 +153,349 @@ static void emitLIM(uint32_t rt, uint32_t min_reg, uint32_t max_reg, uint32_t tm
 	MOVN(rt, max_reg, tmp_reg);   // if (tmp_reg) rt = max_reg
 }
 
+#ifdef USE_GTE_NATIVE_OPS
+/* Limit rt to [min .. max] immediates, tmp_reg and lim_reg are overwritten */
+static void emitLIMI(uint32_t rt, int32_t min, int32_t max, uint32_t tmp_reg, uint32_t lim_reg)
+{
+	if (min == 0) {
+		SLT(tmp_reg, rt, 0);          // tmp_reg = (rt < 0 ? 1 : 0)
+		MOVN(rt, 0, tmp_reg);         // if (tmp_reg) rt = 0
+	} else {
+		LI32(lim_reg, min);
+		SLT(tmp_reg, rt, lim_reg);    // tmp_reg = (rt < min ? 1 : 0)
+		MOVN(rt, lim_reg, tmp_reg);   // if (tmp_reg) rt = min
+	}
+	LI32(lim_reg, max);
+	SLT(tmp_reg, lim_reg, rt);        // tmp_reg = (max < rt ? 1 : 0)
+	MOVN(rt, lim_reg, tmp_reg);       // if (tmp_reg) rt = max
+}
+
+/* HI:LO = (int64_t)rt << shift, tmp_reg is overwritten */
+static void emitMTHILO(uint32_t rt, uint32_t shift, uint32_t tmp_reg)
+{
+	if (shift) {
+		SRA(tmp_reg, rt, 32 - shift);
+		MTHI(tmp_reg);
+		SLL(tmp_reg, rt, shift);
+		MTLO(tmp_reg);
+	} else {
+		SRA(tmp_reg, rt, 31);
+		MTHI(tmp_reg);
+		MTLO(rt);
+	}
+}
+
+/* rd = (int32_t)(HI:LO >> shift), tmp_reg is overwritten */
+static void emitMFHILO(uint32_t rd, uint32_t shift, uint32_t tmp_reg)
+{
+	MFLO(rd);
+	if (shift) {
+		MFHI(tmp_reg);
+		SRL(rd, rd, shift);
+#ifdef HAVE_MIPS32R2_EXT_INS
+		INS(rd, tmp_reg, 32 - shift, shift);
+#else
+		SLL(tmp_reg, tmp_reg, 32 - shift);
+		OR(rd, rd, tmp_reg);
+#endif
+	}
+}
+
+/* psxRegs.cycle += cycles, like the C GTE functions do */
+static void emitGTECycles(uint32_t cycles)
+{
+	LW(TEMP_0, PERM_REG_1, off(cycle));
+	ADDIU(TEMP_0, TEMP_0, cycles);
+	SW(TEMP_0, PERM_REG_1, off(cycle));
+}
+
+/* Load GTE vector 'v' into host regs vx,vy,vz: V0..V2, or IR1..IR3 if v==3 */
+static void emitLoadGTEVector(uint32_t v, uint32_t vx, uint32_t vy, uint32_t vz)
+{
+	if (v < 3) {
+		LH(vx, PERM_REG_1, off(CP2D.r[v << 1]));
+		LH(vy, PERM_REG_1, off(CP2D.r[v << 1]) + 2);
+		LH(vz, PERM_REG_1, off(CP2D.r[(v << 1) + 1]));
+	} else {
+		LH(vx, PERM_REG_1, off(CP2D.r[9]));
+		LH(vy, PERM_REG_1, off(CP2D.r[10]));
+		LH(vz, PERM_REG_1, off(CP2D.r[11]));
+	}
+}
+
+/* HI:LO = ((int64_t)cv << 12) + (m1 * vx) + (m2 * vy) + (m3 * vz)
+ *  'm_off' is offset of a matrix row in psxRegs (three sequential int16_t).
+ *  'cv_off' is offset of int32_t translation component, or 0 if none.
+ *  TEMP_0, TEMP_1, TEMP_2 are overwritten.
+ */
+static void emitMatrixRow(uint32_t m_off, uint32_t cv_off, uint32_t vx, uint32_t vy, uint32_t vz)
+{
+	if (cv_off) {
+		LW(TEMP_0, PERM_REG_1, cv_off);
+		emitMTHILO(TEMP_0, 12, TEMP_1);
+	}
+	LH(TEMP_0, PERM_REG_1, m_off);
+	LH(TEMP_1, PERM_REG_1, m_off + 2);
+	LH(TEMP_2, PERM_REG_1, m_off + 4);
+	if (cv_off)
+		MADD(TEMP_0, vx);
+	else
+		MULT(TEMP_0, vx);
+	MADD(TEMP_1, vy);
+	MADD(TEMP_2, vz);
+}
+
+/* Perspective transformation of vector 'v', shared by RTPS/RTPT.
+ *  MAC1..3, IR1..3 are written only if 'last' is set, as RTPT overwrites
+ *  them when transforming the next vector. Quotient is left in MIPSREG_A1.
+ */
+static void emitRTP(uint32_t v, uint8_t rtpt, uint8_t last)
+{
+	const uint32_t ir1 = MIPSREG_A3;
+	const uint32_t ir2 = TEMP_3;
+	const uint32_t sz  = MIPSREG_A0;
+	const uint32_t quotient = MIPSREG_A1;
+
+	emitLoadGTEVector(v, MIPSREG_A0, MIPSREG_A1, MIPSREG_A2);
+
+	for (int i = 0; i < 3; i++) {
+		// Vector regs are dead after last row's MADDs, so gteMAC3 can use one
+		const uint32_t mac = (i == 0) ? ir1 : ((i == 1) ? ir2 : sz);
+
+		emitMatrixRow(offCP2C(0) + i * 6, offCP2C(5 + i),   // gteR11.., gteTRX..
+		              MIPSREG_A0, MIPSREG_A1, MIPSREG_A2);
+		emitMFHILO(mac, 12, TEMP_1);
+		if (last)
+			SW(mac, PERM_REG_1, off(CP2D.r[25 + i]));        // gteMACn
+
+		// gteMAC3 is kept unclamped in 'sz', for limD() below
+		uint32_t ir = mac;
+		if (i == 2) {
+			ir = TEMP_0;
+			MOV(ir, mac);
+		}
+		emitLIMI(ir, -0x8000, 0x7fff, TEMP_1, TEMP_2);
+		if (last)
+			SH(ir, PERM_REG_1, off(CP2D.r[9 + i]));          // gteIRn
+	}
+
+	// sz = limD(gteMAC3)
+	emitLIMI(sz, 0, 0xffff, TEMP_1, TEMP_2);
+	if (rtpt) {
+		SH(sz, PERM_REG_1, off(CP2D.r[17 + v]));             // fSZ(v)
+	} else {
+		LHU(TEMP_0, PERM_REG_1, off(CP2D.r[17]));
+		LHU(TEMP_1, PERM_REG_1, off(CP2D.r[18]));
+		LHU(TEMP_2, PERM_REG_1, off(CP2D.r[19]));
+		SH(TEMP_0, PERM_REG_1, off(CP2D.r[16]));             // gteSZ0 = gteSZ1
+		SH(TEMP_1, PERM_REG_1, off(CP2D.r[17]));             // gteSZ1 = gteSZ2
+		SH(TEMP_2, PERM_REG_1, off(CP2D.r[18]));             // gteSZ2 = gteSZ3
+		SH(sz, PERM_REG_1, off(CP2D.r[19]));                 // gteSZ3 = sz
+	}
+
+	// quotient = limE(DIVIDE(gteH, sz)), which on MIPS is:
+	//  (gteH < sz*2) ? ((gteH << 16) / sz) : 0x1ffff
+	LHU(TEMP_0, PERM_REG_1, offCP2C(26));                    // gteH
+	SLL(TEMP_1, sz, 1);
+	SLTU(TEMP_1, TEMP_0, TEMP_1);
+	SLL(TEMP_0, TEMP_0, 16);
+	DIVU(TEMP_0, sz);
+	LUI(quotient, 0x0001);
+	ORI(quotient, quotient, 0xffff);
+	MFLO(TEMP_0);
+	MOVN(quotient, TEMP_0, TEMP_1);
+
+	if (!rtpt) {
+		LW(TEMP_0, PERM_REG_1, off(CP2D.r[13]));
+		LW(TEMP_2, PERM_REG_1, off(CP2D.r[14]));
+		SW(TEMP_0, PERM_REG_1, off(CP2D.r[12]));             // gteSXY0 = gteSXY1
+		SW(TEMP_2, PERM_REG_1, off(CP2D.r[13]));             // gteSXY1 = gteSXY2
+	}
+
+	const uint32_t sxy_off = rtpt ? off(CP2D.r[12 + v]) : off(CP2D.r[14]);
+
+	// fSX = limG1((gteOFX + gteIR1 * quotient) >> 16)
+	LW(TEMP_0, PERM_REG_1, offCP2C(24));                     // gteOFX
+	emitMTHILO(TEMP_0, 0, TEMP_1);
+	MADD(ir1, quotient);
+	emitMFHILO(TEMP_0, 16, TEMP_1);
+	emitLIMI(TEMP_0, -0x400, 0x3ff, TEMP_1, TEMP_2);
+	SH(TEMP_0, PERM_REG_1, sxy_off);
+
+	// fSY = limG2((gteOFY + gteIR2 * quotient) >> 16)
+	LW(TEMP_0, PERM_REG_1, offCP2C(25));                     // gteOFY
+	emitMTHILO(TEMP_0, 0, TEMP_1);
+	MADD(ir2, quotient);
+	emitMFHILO(TEMP_0, 16, TEMP_1);
+	emitLIMI(TEMP_0, -0x400, 0x3ff, TEMP_1, TEMP_2);
+	SH(TEMP_0, PERM_REG_1, sxy_off + 2);
+}
+
+/* gteMAC0 = gteDQB + gteDQA * quotient, gteIR0 = limH(that >> 12) */
+static void emitRTPDepthCue(uint32_t quotient)
+{
+	LW(TEMP_0, PERM_REG_1, offCP2C(28));                     // gteDQB
+	emitMTHILO(TEMP_0, 0, TEMP_1);
+	LH(TEMP_0, PERM_REG_1, offCP2C(27));                     // gteDQA
+	MADD(TEMP_0, quotient);
+	emitMFHILO(TEMP_0, 0, TEMP_1);
+	SW(TEMP_0, PERM_REG_1, off(CP2D.r[24]));                 // gteMAC0
+	emitMFHILO(TEMP_0, 12, TEMP_1);
+	emitLIMI(TEMP_0, 0, 0x1000, TEMP_1, TEMP_2);
+	SH(TEMP_0, PERM_REG_1, off(CP2D.r[8]));                  // gteIR0
+}
+
+static uint8_t emitRTPS()
+{
+	emitGTECycles(15);
+	emitRTP(0, 0, 1);
+	emitRTPDepthCue(MIPSREG_A1);
+	return 1;
+}
+
+static uint8_t emitRTPT()
+{
+	emitGTECycles(23);
+	LHU(TEMP_0, PERM_REG_1, off(CP2D.r[19]));
+	SH(TEMP_0, PERM_REG_1, off(CP2D.r[16]));                 // gteSZ0 = gteSZ3
+	emitRTP(0, 1, 0);
+	emitRTP(1, 1, 0);
+	emitRTP(2, 1, 1);
+	emitRTPDepthCue(MIPSREG_A1);
+	return 1;
+}
+
+static uint8_t emitNCLIP()
+{
+	// gteMAC0 = gteSX0 * (gteSY1 - gteSY2) +
+	//           gteSX1 * (gteSY2 - gteSY0) +
+	//           gteSX2 * (gteSY0 - gteSY1)
+	// Only lower 32 bits of the result are kept, so 3-op MUL is fine.
+	emitGTECycles(8);
+	LH(TEMP_1, PERM_REG_1, off(CP2D.r[12]));                 // gteSX0
+	LH(TEMP_2, PERM_REG_1, off(CP2D.r[12]) + 2);             // gteSY0
+	LH(TEMP_3, PERM_REG_1, off(CP2D.r[13]));                 // gteSX1
+	LH(MIPSREG_A0, PERM_REG_1, off(CP2D.r[13]) + 2);         // gteSY1
+	LH(MIPSREG_A1, PERM_REG_1, off(CP2D.r[14]));             // gteSX2
+	LH(MIPSREG_A2, PERM_REG_1, off(CP2D.r[14]) + 2);         // gteSY2
+	SUBU(TEMP_0, MIPSREG_A0, MIPSREG_A2);
+	MUL(TEMP_0, TEMP_1, TEMP_0);
+	SUBU(MIPSREG_A3, MIPSREG_A2, TEMP_2);
+	MUL(MIPSREG_A3, TEMP_3, MIPSREG_A3);
+	ADDU(TEMP_0, TEMP_0, MIPSREG_A3);
+	SUBU(MIPSREG_A3, TEMP_2, MIPSREG_A0);
+	MUL(MIPSREG_A3, MIPSREG_A1, MIPSREG_A3);
+	ADDU(TEMP_0, TEMP_0, MIPSREG_A3);
+	SW(TEMP_0, PERM_REG_1, off(CP2D.r[24]));                 // gteMAC0
+	return 1;
+}
+
+/* Shared by AVSZ3/AVSZ4: 'zsf_reg' is gteZSF3 or gteZSF4 ctrl reg */
+static void emitAVSZ(uint32_t zsf_reg, uint8_t avsz4)
+{
+	LHU(TEMP_0, PERM_REG_1, off(CP2D.r[17]));                // gteSZ1
+	LHU(TEMP_1, PERM_REG_1, off(CP2D.r[18]));                // gteSZ2
+	LHU(TEMP_2, PERM_REG_1, off(CP2D.r[19]));                // gteSZ3
+	LH(TEMP_3, PERM_REG_1, offCP2C(zsf_reg));
+	ADDU(TEMP_0, TEMP_0, TEMP_1);
+	if (avsz4) {
+		LHU(TEMP_1, PERM_REG_1, off(CP2D.r[16]));            // gteSZ0
+		ADDU(TEMP_0, TEMP_0, TEMP_1);
+	}
+	ADDU(TEMP_0, TEMP_0, TEMP_2);
+	MUL(TEMP_0, TEMP_0, TEMP_3);
+	SW(TEMP_0, PERM_REG_1, off(CP2D.r[24]));                 // gteMAC0
+	SRA(TEMP_0, TEMP_0, 12);
+	emitLIMI(TEMP_0, 0, 0xffff, TEMP_1, TEMP_2);
+	SH(TEMP_0, PERM_REG_1, off(CP2D.r[7]));                  // gteOTZ
+}
+
+static uint8_t emitAVSZ3()
+{
+	emitGTECycles(5);
+	emitAVSZ(29, 0);
+	return 1;
+}
+
+static uint8_t emitAVSZ4()
+{
+	emitGTECycles(6);
+	emitAVSZ(30, 1);
+	return 1;
+}
+
+/* Returns 0 if no code was emitted, i.e. for unusual matrix selections */
+static uint8_t emitMVMVA(uint32_t gteop)
+{
+	const uint32_t shift = 12 * ((gteop >> 9) & 1);
+	const uint32_t mx = (gteop >> 7) & 3;
+	const uint32_t v  = (gteop >> 5) & 3;
+	const uint32_t cv = (gteop >> 3) & 3;
+	const uint32_t lm = gteop & 1;
+
+	// Matrix 3 is 'garbage' on real hardware, leave it to the C function
+	if (mx == 3)
+		return 0;
+
+	emitGTECycles(8);
+	emitLoadGTEVector(v, MIPSREG_A0, MIPSREG_A1, MIPSREG_A2);
+
+	for (int i = 0; i < 3; i++) {
+		const uint32_t cv_off = (cv < 3) ? offCP2C((cv << 3) + 5 + i) : 0;
+
+		emitMatrixRow(offCP2C(mx << 3) + i * 6, cv_off,
+		              MIPSREG_A0, MIPSREG_A1, MIPSREG_A2);
+		emitMFHILO(TEMP_0, shift, TEMP_1);
+		SW(TEMP_0, PERM_REG_1, off(CP2D.r[25 + i]));         // gteMACn
+		emitLIMI(TEMP_0, lm ? 0 : -0x8000, 0x7fff, TEMP_1, TEMP_2);
+		SH(TEMP_0, PERM_REG_1, off(CP2D.r[9 + i]));          // gteIRn
+	}
+
+	return 1;
+}
+
+/* Emit native code for GTE func if the FLAG reg it writes is dead, otherwise
+ *  emit code to call the C version, which computes FLAG. If the emitter
+ *  declines (MVMVA with mx==3), the flagless C version is called instead.
+ */
+#define CP2_FUNC_0_NATIVE(f) \
+extern void gte##f(); \
+extern void gte##f##_nf(); \
+void rec##f() \
+{ \
+	if (!branch && rec_scan_for_gte_flag_overwrite(pc)) { \
+		if (emit##f()) \
+			return; \
+		JAL(gte##f##_nf); \
+	} else { \
+		JAL(gte##f); \
+	} \
+	NOP(); /* <BD slot> */ \
+}
+
+#define CP2_FUNC_1_NATIVE(f) \
+extern void gte##f(uint32_t gteop); \
+extern void gte##f##_nf(uint32_t gteop); \
+void rec##f() \
+{ \
+	if (!branch && rec_scan_for_gte_flag_overwrite(pc)) { \
+		if (emit##f(psxRegs.code >> 10)) \
+			return; \
+		JAL(gte##f##_nf); \
+	} else { \
+		JAL(gte##f); \
+	} \
+	LI16(MIPSREG_A0, (uint16_t)(psxRegs.code >> 10)); /* <BD slot> */ \
+}
+
+CP2_FUNC_0_NATIVE(RTPS)
+CP2_FUNC_0_NATIVE(NCLIP)
+CP2_FUNC_0_NATIVE(AVSZ3)
+CP2_FUNC_0_NATIVE(AVSZ4)
+CP2_FUNC_0_NATIVE(RTPT)
+CP2_FUNC_1_NATIVE(MVMVA)
+#endif // USE_GTE_NATIVE_OPS
+
 /* move from cp2 reg to host rt */
 static void emitMFC2(uint32_t rt, uint32_t reg)
 {
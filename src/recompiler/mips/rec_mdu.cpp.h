@@ -37,6 +37,88 @@
 static uint8_t convertMultiplyTo3Op();
 
 
+/* LO/HI result helpers. With USE_HILO_REGCACHE (regcache.h), LO/HI live in
+ *  allocated host regs like GPRs. Otherwise, they are always in psxRegs.
+ *  Const-propagation info for LO/HI is kept in iRegs[REG_LO/REG_HI].
+ */
+
+/* Get host reg to compute LO/HI result into. Follow with regHiLoWritten(). */
+static uint32_t regHiLoFind(uint32_t hilo)
+{
+#ifdef USE_HILO_REGCACHE
+	return regMipsToHost(hilo, REG_FIND, REG_REGISTER);
+#else
+	return (hilo == REG_LO) ? TEMP_1 : TEMP_2;
+#endif
+}
+
+static void regHiLoWritten(uint32_t hilo, uint32_t reg)
+{
+	SetUndef(hilo);
+#ifdef USE_HILO_REGCACHE
+	regMipsChanged(hilo);
+	regUnlock(reg);
+#else
+	SW(reg, PERM_REG_1, offGPR(hilo));
+#endif
+}
+
+/* Set LO/HI to the value in host reg 'src' */
+static void emitSetHiLo(uint32_t hilo, uint32_t src)
+{
+#ifdef USE_HILO_REGCACHE
+	uint32_t reg = regMipsToHost(hilo, REG_FIND, REG_REGISTER);
+	MOV(reg, src);
+	regHiLoWritten(hilo, reg);
+#else
+	SetUndef(hilo);
+	SW(src, PERM_REG_1, offGPR(hilo));
+#endif
+}
+
+/* Load LO/HI into PS1 reg 'rd'. If LO/HI is known-const, so is 'rd'. */
+static void emitGetHiLo(uint32_t rd_psx, uint32_t hilo)
+{
+	uint32_t rd = regMipsToHost(rd_psx, REG_FIND, REG_REGISTER);
+
+	if (IsConst(hilo)) {
+		LI32(rd, GetConst(hilo));
+	} else {
+#ifdef USE_HILO_REGCACHE
+		uint32_t reg = regMipsToHost(hilo, REG_LOAD, REG_REGISTER);
+		MOV(rd, reg);
+		regUnlock(reg);
+#else
+		LW(rd, PERM_REG_1, offGPR(hilo));
+#endif
+	}
+
+	regMipsChanged(rd_psx);
+	regUnlock(rd);
+
+	if (IsConst(hilo))
+		SetConst(rd_psx, GetConst(hilo));
+}
+
+/* Set LO/HI to const value */
+static void emitSetHiLoConst(uint32_t hilo, uint32_t val)
+{
+#ifdef USE_HILO_REGCACHE
+	uint32_t reg = regMipsToHost(hilo, REG_FIND, REG_REGISTER);
+	LI32(reg, val);
+	regHiLoWritten(hilo, reg);
+#else
+	if (val) {
+		LI32(TEMP_1, val);
+		SW(TEMP_1, PERM_REG_1, offGPR(hilo));
+	} else {
+		SW(0, PERM_REG_1, offGPR(hilo));
+	}
+#endif
+	SetConst(hilo, val);
+}
+
+
 static void recMULT()
 {
 // Lo/Hi = Rs * Rt (signed)
@@ -82,10 +164,11 @@ static void recMULT()
 				work_reg = TEMP_1;
 			}
 
-			SW(work_reg, PERM_REG_1, offGPR(32)); // LO
+			emitSetHiLo(REG_LO, work_reg);
 			// Upper word is all 0s or 1s depending on sign of LO result
-			SRA(TEMP_1, work_reg, 31);
-			SW(TEMP_1, PERM_REG_1, offGPR(33));   // HI
+			uint32_t hi = regHiLoFind(REG_HI);
+			SRA(hi, work_reg, 31);
+			regHiLoWritten(REG_HI, hi);
 
 			regUnlock(ident_reg);
 
@@ -113,11 +196,13 @@ static void recMULT()
 					work_reg = TEMP_2;
 				}
 
-				SLL(TEMP_1, work_reg, shift_amt);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				uint32_t lo = regHiLoFind(REG_LO);
+				SLL(lo, work_reg, shift_amt);
+				regHiLoWritten(REG_LO, lo);
 				// Sign-extend here when computing upper word of result
-				SRA(TEMP_1, work_reg, (32 - shift_amt));
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				uint32_t hi = regHiLoFind(REG_HI);
+				SRA(hi, work_reg, (32 - shift_amt));
+				regHiLoWritten(REG_HI, hi);
 
 				regUnlock(npot_reg);
 
@@ -127,19 +212,8 @@ static void recMULT()
 		}
 
 		if (const_res) {
-			if (lo_res) {
-				LI32(TEMP_1, (uint32_t)lo_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-			} else {
-				SW(0, PERM_REG_1, offGPR(32)); // LO
-			}
-
-			if (hi_res) {
-				LI32(TEMP_1, (uint32_t)hi_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
-			} else {
-				SW(0, PERM_REG_1, offGPR(33)); // HI
-			}
+			emitSetHiLoConst(REG_LO, (uint32_t)lo_res);
+			emitSetHiLoConst(REG_HI, (uint32_t)hi_res);
 
 			// We're done
 			return;
@@ -160,11 +234,14 @@ static void recMULT()
 	uint32_t rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 	uint32_t rt = regMipsToHost(_Rt_, REG_LOAD, REG_REGISTER);
 
+	uint32_t lo = regHiLoFind(REG_LO);
+	uint32_t hi = regHiLoFind(REG_HI);
+
 	MULT(rs, rt);
-	MFLO(TEMP_1);
-	MFHI(TEMP_2);
-	SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-	SW(TEMP_2, PERM_REG_1, offGPR(33)); // HI
+	MFLO(lo);
+	MFHI(hi);
+	regHiLoWritten(REG_LO, lo);
+	regHiLoWritten(REG_HI, hi);
 
 	regUnlock(rs);
 	regUnlock(rt);
@@ -206,8 +283,8 @@ static void recMULTU()
 			uint32_t ident_reg_psx = rs_const ? _Rt_ : _Rs_;
 			uint32_t ident_reg = regMipsToHost(ident_reg_psx, REG_LOAD, REG_REGISTER);
 
-			SW(0, PERM_REG_1, offGPR(33));         // HI
-			SW(ident_reg, PERM_REG_1, offGPR(32)); // LO
+			emitSetHiLoConst(REG_HI, 0);
+			emitSetHiLo(REG_LO, ident_reg);
 
 			regUnlock(ident_reg);
 
@@ -228,10 +305,12 @@ static void recMULTU()
 				uint32_t pot_val = rs_pot ? rs_val : rt_val;
 				uint32_t shift_amt = __builtin_ctz(pot_val);
 
-				SLL(TEMP_1, npot_reg, shift_amt);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-				SRL(TEMP_1, npot_reg, (32 - shift_amt));
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				uint32_t lo = regHiLoFind(REG_LO);
+				SLL(lo, npot_reg, shift_amt);
+				regHiLoWritten(REG_LO, lo);
+				uint32_t hi = regHiLoFind(REG_HI);
+				SRL(hi, npot_reg, (32 - shift_amt));
+				regHiLoWritten(REG_HI, hi);
 
 				regUnlock(npot_reg);
 
@@ -241,19 +320,8 @@ static void recMULTU()
 		}
 
 		if (const_res) {
-			if (lo_res) {
-				LI32(TEMP_1, lo_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-			} else {
-				SW(0, PERM_REG_1, offGPR(32)); // LO
-			}
-
-			if (hi_res) {
-				LI32(TEMP_1, hi_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
-			} else {
-				SW(0, PERM_REG_1, offGPR(33)); // HI
-			}
+			emitSetHiLoConst(REG_LO, lo_res);
+			emitSetHiLoConst(REG_HI, hi_res);
 
 			// We're done
 			return;
@@ -274,11 +342,14 @@ static void recMULTU()
 	uint32_t rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 	uint32_t rt = regMipsToHost(_Rt_, REG_LOAD, REG_REGISTER);
 
+	uint32_t lo = regHiLoFind(REG_LO);
+	uint32_t hi = regHiLoFind(REG_HI);
+
 	MULTU(rs, rt);
-	MFLO(TEMP_1);
-	MFHI(TEMP_2);
-	SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-	SW(TEMP_2, PERM_REG_1, offGPR(33)); // HI
+	MFLO(lo);
+	MFHI(hi);
+	regHiLoWritten(REG_LO, lo);
+	regHiLoWritten(REG_HI, hi);
 
 	regUnlock(rs);
 	regUnlock(rt);
@@ -307,11 +378,12 @@ static void recDIV()
 			//  HI result is Rs val
 			uint32_t rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 
+			uint32_t lo = regHiLoFind(REG_LO);
 			ADDIU(TEMP_2, 0, -1);
-			SLT(TEMP_1, rs, 0);           // TEMP_1 = dividend < 0
-			MOVN(TEMP_1, TEMP_2, TEMP_1); // if (TEMP_1 != 0) TEMP_1 = TEMP_2
-			SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-			SW(rs, PERM_REG_1, offGPR(33));     // HI
+			SLT(lo, rs, 0);               // lo = dividend < 0
+			MOVN(lo, TEMP_2, lo);         // if (lo != 0) lo = TEMP_2
+			regHiLoWritten(REG_LO, lo);
+			emitSetHiLo(REG_HI, rs);
 
 			regUnlock(rs);
 
@@ -321,8 +393,8 @@ static void recDIV()
 			// If divisor is const-val '1', result is identity
 			uint32_t rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 
-			SW(0, PERM_REG_1, offGPR(33));  // HI
-			SW(rs, PERM_REG_1, offGPR(32)); // LO
+			emitSetHiLoConst(REG_HI, 0);
+			emitSetHiLo(REG_LO, rs);
 
 			regUnlock(rs);
 
@@ -333,19 +405,8 @@ static void recDIV()
 			uint32_t lo_res = rs_val / rt_val;
 			uint32_t hi_res = rs_val % rt_val;
 
-			if (lo_res) {
-				LI32(TEMP_1, lo_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-			} else {
-				SW(0, PERM_REG_1, offGPR(32)); // LO
-			}
-
-			if (hi_res) {
-				LI32(TEMP_1, hi_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
-			} else {
-				SW(0, PERM_REG_1, offGPR(33)); // HI
-			}
+			emitSetHiLoConst(REG_LO, lo_res);
+			emitSetHiLoConst(REG_HI, hi_res);
 
 			// We're done
 			return;
@@ -368,17 +429,19 @@ static void recDIV()
 					work_reg = TEMP_2;
 				}
 
-				SRA(TEMP_1, work_reg, shift_amt);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				uint32_t lo = regHiLoFind(REG_LO);
+				SRA(lo, work_reg, shift_amt);
+				regHiLoWritten(REG_LO, lo);
 
 				// Subtract one from pot divisor to get remainder modulo mask
+				uint32_t hi = regHiLoFind(REG_HI);
 				if ((pot_val-1) > 0xffff) {
 					LI32(TEMP_1, (pot_val-1));
-					AND(TEMP_1, rs, TEMP_1);
+					AND(hi, rs, TEMP_1);
 				} else {
-					ANDI(TEMP_1, rs, (pot_val-1));
+					ANDI(hi, rs, (pot_val-1));
 				}
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				regHiLoWritten(REG_HI, hi);
 
 				regUnlock(rs);
 
@@ -425,31 +488,34 @@ static void recDIV()
 #endif
 	}
 
+	uint32_t lo = regHiLoFind(REG_LO);
+	uint32_t hi = regHiLoFind(REG_HI);
+
 	if (omit_div_by_zero_fixup) {
 		DIV(rs, rt);
-		MFLO(TEMP_1);              // NOTE: Hi/Lo can't be cached for now, so spill them
-		MFHI(TEMP_2);
+		MFLO(lo);
+		MFHI(hi);
 	} else {
 		DIV(rs, rt);
 		ADDIU(MIPSREG_A1, 0, -1);
 		SLT(TEMP_3, rs, 0);        // TEMP_3 = (rs < 0 ? 1 : 0)
-		MFLO(TEMP_1);              // NOTE: Hi/Lo can't be cached for now, so spill them
-		MFHI(TEMP_2);
+		MFLO(lo);
+		MFHI(hi);
 
 		// If divisor was 0, set LO result (quotient) to 1 if dividend was < 0
 		// If divisor was 0, set LO result (quotient) to -1 if dividend was >= 0
 		MOVN(MIPSREG_A0, TEMP_3, TEMP_3);      // if (TEMP_3 != 0) then MIPSREG_A1 = TEMP_3
 		MOVZ(MIPSREG_A0, MIPSREG_A1, TEMP_3);  // if (TEMP_3 == 0) then MIPSREG_A1 = MIPSREG_A0
-		MOVZ(TEMP_1, MIPSREG_A0, rt);          // if (rt == 0) then TEMP_1 = MIPSREG_A0
+		MOVZ(lo, MIPSREG_A0, rt);              // if (rt == 0) then lo = MIPSREG_A0
 
 #ifndef OMIT_DIV_BY_ZERO_HI_FIXUP
 		// If divisor was 0, set HI result (remainder) to rs
-		MOVZ(TEMP_2, rs, rt);
+		MOVZ(hi, rs, rt);
 #endif
 	}
 
-	SW(TEMP_1, PERM_REG_1, offGPR(32));
-	SW(TEMP_2, PERM_REG_1, offGPR(33));
+	regHiLoWritten(REG_LO, lo);
+	regHiLoWritten(REG_HI, hi);
 	regUnlock(rs);
 	regUnlock(rt);
 }
@@ -477,9 +543,8 @@ static void recDIVU()
 			//  HI result is Rs val
 			uint32_t rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 
-			ADDIU(TEMP_1, 0, -1);
-			SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-			SW(rs, PERM_REG_1, offGPR(33));     // HI
+			emitSetHiLoConst(REG_LO, 0xffffffff);
+			emitSetHiLo(REG_HI, rs);
 
 			regUnlock(rs);
 
@@ -489,8 +554,8 @@ static void recDIVU()
 			// If divisor is const-val '1', result is identity
 			uint32_t rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 
-			SW(0, PERM_REG_1, offGPR(33));  // HI
-			SW(rs, PERM_REG_1, offGPR(32)); // LO
+			emitSetHiLoConst(REG_HI, 0);
+			emitSetHiLo(REG_LO, rs);
 
 			regUnlock(rs);
 
@@ -501,19 +566,8 @@ static void recDIVU()
 			uint32_t lo_res = rs_val / rt_val;
 			uint32_t hi_res = rs_val % rt_val;
 
-			if (lo_res) {
-				LI32(TEMP_1, lo_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-			} else {
-				SW(0, PERM_REG_1, offGPR(32)); // LO
-			}
-
-			if (hi_res) {
-				LI32(TEMP_1, hi_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
-			} else {
-				SW(0, PERM_REG_1, offGPR(33)); // HI
-			}
+			emitSetHiLoConst(REG_LO, lo_res);
+			emitSetHiLoConst(REG_HI, hi_res);
 
 			// We're done
 			return;
@@ -528,17 +582,19 @@ static void recDIVU()
 				uint32_t pot_val = rt_val;
 				uint32_t shift_amt = __builtin_ctz(pot_val);
 
-				SRL(TEMP_1, rs, shift_amt);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				uint32_t lo = regHiLoFind(REG_LO);
+				SRL(lo, rs, shift_amt);
+				regHiLoWritten(REG_LO, lo);
 
 				// Subtract one from pot divisor to get remainder modulo mask
+				uint32_t hi = regHiLoFind(REG_HI);
 				if ((pot_val-1) > 0xffff) {
 					LI32(TEMP_1, (pot_val-1));
-					AND(TEMP_1, rs, TEMP_1);
+					AND(hi, rs, TEMP_1);
 				} else {
-					ANDI(TEMP_1, rs, (pot_val-1));
+					ANDI(hi, rs, (pot_val-1));
 				}
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				regHiLoWritten(REG_HI, hi);
 
 				regUnlock(rs);
 
@@ -572,27 +628,30 @@ static void recDIVU()
 #endif
 	}
 
+	uint32_t lo = regHiLoFind(REG_LO);
+	uint32_t hi = regHiLoFind(REG_HI);
+
 	if (omit_div_by_zero_fixup) {
 		DIVU(rs, rt);
-		MFLO(TEMP_1);              // NOTE: Hi/Lo can't be cached for now, so spill them
-		MFHI(TEMP_2);
+		MFLO(lo);
+		MFHI(hi);
 	} else {
 		DIVU(rs, rt);
 		ADDIU(TEMP_3, 0, -1);
-		MFLO(TEMP_1);              // NOTE: Hi/Lo can't be cached for now, so spill them
-		MFHI(TEMP_2);
+		MFLO(lo);
+		MFHI(hi);
 
 		// If divisor was 0, set LO result (quotient) to 0xffff_ffff
-		MOVZ(TEMP_1, TEMP_3, rt);  // if (rt == 0) then TEMP_1 = TEMP_3
+		MOVZ(lo, TEMP_3, rt);      // if (rt == 0) then lo = TEMP_3
 
 #ifndef OMIT_DIV_BY_ZERO_HI_FIXUP
 		// If divisor was 0, set HI result (remainder) to rs
-		MOVZ(TEMP_2, rs, rt);
+		MOVZ(hi, rs, rt);
 #endif
 	}
 
-	SW(TEMP_1, PERM_REG_1, offGPR(32));
-	SW(TEMP_2, PERM_REG_1, offGPR(33));
+	regHiLoWritten(REG_LO, lo);
+	regHiLoWritten(REG_HI, hi);
 	regUnlock(rs);
 	regUnlock(rt);
 }
@@ -602,19 +661,19 @@ static void recMFHI()
 // Rd = Hi
 	if (!_Rd_) return;
 	SetUndef(_Rd_);
-	uint32_t rd = regMipsToHost(_Rd_, REG_FIND, REG_REGISTER);
-
-	LW(rd, PERM_REG_1, offGPR(33));
-	regMipsChanged(_Rd_);
-	regUnlock(rd);
+	emitGetHiLo(_Rd_, REG_HI);
 }
 
 static void recMTHI()
 {
 // Hi = Rs
+	const uint8_t set_const = IsConst(_Rs_);
 	uint32_t rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
-	SW(rs, PERM_REG_1, offGPR(33));
+	emitSetHiLo(REG_HI, rs);
 	regUnlock(rs);
+
+	if (set_const)
+		SetConst(REG_HI, GetConst(_Rs_));
 }
 
 
@@ -634,20 +693,20 @@ static void recMFLO()
 	if (!_Rd_) return;
 
 	SetUndef(_Rd_);
-	uint32_t rd = regMipsToHost(_Rd_, REG_FIND, REG_REGISTER);
-
-	LW(rd, PERM_REG_1, offGPR(32));
-	regMipsChanged(_Rd_);
-	regUnlock(rd);
+	emitGetHiLo(_Rd_, REG_LO);
 }
 
 
 static void recMTLO()
 {
 // Lo = Rs
+	const uint8_t set_const = IsConst(_Rs_);
 	uint32_t rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
-	SW(rs, PERM_REG_1, offGPR(32));
+	emitSetHiLo(REG_LO, rs);
 	regUnlock(rs);
+
+	if (set_const)
+		SetConst(REG_LO, GetConst(_Rs_));
 }
 
 
@@ -1101,9 +1160,12 @@ static uint8_t convertMultiplyTo3Op()
 	//  the result. Other blocks might start at or before the MFLO instruction
 	//  in the original code.
 	if (branch) {
-		SW(rd, PERM_REG_1, offGPR(32)); // LO
+		emitSetHiLo(REG_LO, rd);
 	}
 
+	// LO/HI are left stale in psxRegs otherwise, forget any const vals
+	SetUndef(REG_LO);
+	SetUndef(REG_HI);
 	SetUndef(rd_of_mflo);
 	regMipsChanged(rd_of_mflo);
 
@@ -29,6 +29,7 @@
 #include "plugin_lib.h"
 #include "psxcommon.h"
 #include "psxhle.h"
+#include "psxtrace.h"
 #include "psxmem.h"
 #include "psxhw.h"
 #include "r3000a.h"
@@ -77,6 +78,9 @@
 /* Const propagation is extended to optimize 'fuzzy' non-const addresses */
 #define USE_CONST_FUZZY_ADDRESSES
 
+/* Skip ALU opcodes whose result is overwritten before being read */
+#define USE_DEAD_WRITE_ELIMINATION
+
 /* Generate inline memory access or call psxMemRead/Write C functions */
 #define USE_DIRECT_MEM_ACCESS
 
@@ -155,7 +159,7 @@ typedef struct {
 	uint8_t is_fuzzy_scratchpad_addr; /* GPR is not known-const, but at least known
 	                                   to be address somewhere in 1KB scratcpad? */
 } iRegisters;
-static iRegisters iRegs[32];
+static iRegisters iRegs[34];  /* LO/HI at REG_LO/REG_HI (32,33) */
 static inline void ResetConsts()
 {
 	memset(&iRegs, 0, sizeof(iRegs));
@@ -182,11 +186,11 @@ static inline void SetConst(const uint32_t reg, const uint32_t val)
 		iRegs[reg].is_fuzzy_scratchpad_addr = 0;
 	}
 }
-static inline void SetFuzzyRamAddr(const uint32_t reg)        { iRegs[reg].is_fuzzy_ram_addr = 1; }
+static inline void SetFuzzyRamAddr(const uint32_t reg)        { if (reg) iRegs[reg].is_fuzzy_ram_addr = 1; }
 static inline uint8_t IsFuzzyRamAddr(const uint32_t reg)         { return iRegs[reg].is_fuzzy_ram_addr; }
-static inline void SetFuzzyNonramAddr(const uint32_t reg)     { iRegs[reg].is_fuzzy_nonram_addr = 1; }
+static inline void SetFuzzyNonramAddr(const uint32_t reg)     { if (reg) iRegs[reg].is_fuzzy_nonram_addr = 1; }
 static inline uint8_t IsFuzzyNonramAddr(const uint32_t reg)      { return iRegs[reg].is_fuzzy_nonram_addr; }
-static inline void SetFuzzyScratchpadAddr(const uint32_t reg) { iRegs[reg].is_fuzzy_scratchpad_addr = 1; }
+static inline void SetFuzzyScratchpadAddr(const uint32_t reg) { if (reg) iRegs[reg].is_fuzzy_scratchpad_addr = 1; }
 static inline uint8_t IsFuzzyScratchpadAddr(const uint32_t reg)  { return iRegs[reg].is_fuzzy_scratchpad_addr; }
 
 
@@ -427,6 +431,8 @@ static void rec_set_options()
 
 static void recRecompile()
 {
+	TRACE_BEGIN_EV(TRACE_RECOMPILE, psxRegs.pc, 0);
+
 	// Notify plugin_lib that we're recompiling (affects frameskip timing)
 	pl_dynarec_notify();
 
@@ -508,13 +514,40 @@ static void recRecompile()
 		}
 #endif
 
+#ifdef USE_DEAD_WRITE_ELIMINATION
+		// Skip ALU opcode if the reg it writes is overwritten before any read.
+		//  Any const/fuzzy info the reg had no longer applies.
+		{
+			const uint32_t dead_reg = rec_scan_for_dead_write(pc - 4);
+			if (dead_reg) {
+				DISASM_MSG(" ->dead write to r%d skipped\n", dead_reg);
+				SetUndef(dead_reg);
+				continue;
+			}
+		}
+#endif
+
+#ifdef USE_TEMP_REGCACHE
+		// Caller-saved host regs can't hold PS1 regs across calls to C code
+		const uint8_t may_call_c = rec_opcode_may_call_c(pc - 4);
+		if (may_call_c)
+			regReserveTempRegs();
+#endif
+
 		// Recompile next instruction.
 		recBSC[psxRegs.code>>26]();
 		regUpdate();
+
+#ifdef USE_TEMP_REGCACHE
+		if (may_call_c)
+			regUnreserveTempRegs();
+#endif
 	} while (!end_block);
 
 	DISASM_HOST();
 	clear_insn_cache(recMemStart, recMem, 0);
+
+	TRACE_END_EV(TRACE_RECOMPILE, (uintptr_t)recMem - (uintptr_t)recMemStart, 0);
 }
 
 
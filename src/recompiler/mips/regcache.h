@@ -1,6 +1,26 @@
+/* Compile-time options (disable for debugging) */
+
+// Cache PS1 LO/HI regs in host regs like GPRs, instead of always accessing
+//  them in psxRegs. Multiply/divide results no longer round-trip memory.
+#define USE_HILO_REGCACHE
+
+// Also allocate caller-saved host regs t4-t7, after s0-s7 are all in use.
+//  Before emitting any opcode that might call C code (see
+//  rec_opcode_may_call_c()), PS1 regs in t4-t7 are written back and t4-t7
+//  are kept from being allocated until that opcode is done.
+#define USE_TEMP_REGCACHE
+
 #define REG_CACHE_START		MIPSREG_S0
 #define REG_CACHE_END		(MIPSREG_S7+1)
 
+#define REG_TEMP_CACHE_START	MIPSREG_T4
+#define REG_TEMP_CACHE_END	(MIPSREG_T7+1)
+
+/* LO/HI are at these indices in psxRegs.GPR.r[] and regcache.psx[] */
+#define REG_LO			32
+#define REG_HI			33
+#define REG_PSX_CNT		34
+
 #define REG_LOAD		0
 #define REG_FIND		1
 #define REG_LOADBRANCH		2
@@ -30,7 +50,7 @@ typedef struct {
 } PSX_RecRegister;
 
 typedef struct {
-	PSX_RecRegister		psx[32];
+	PSX_RecRegister		psx[REG_PSX_CNT];
 	HOST_RecRegister	host[32];
 	uint32_t			reglist[32];
 	uint32_t			reglist_cnt;
@@ -46,7 +66,7 @@ static RecRegisters regcache_bak[regcache_bak_size];
 /* Spill regs to psxRegs if they are in host regs and were modified */
 static void regClearJump(void)
 {
-	for (int i = 1; i < 32; i++) {
+	for (int i = 1; i < REG_PSX_CNT; i++) {
 		if (regcache.psx[i].ismapped) {
 			int mappedto = regcache.psx[i].mappedto;
 
@@ -76,7 +96,8 @@ static void regFreeRegs(void)
 		int hostreg = regcache.reglist[i];
 		//DEBUGF("spilling %dth reg (%d)", i, hostreg);
 
-		if (!regcache.host[hostreg].host_islocked) {
+		if (!regcache.host[hostreg].host_islocked &&
+		    regcache.host[hostreg].host_type != REG_RESERVED) {
 			int psxreg = regcache.host[hostreg].mappedto;
 
 			if (regcache.psx[psxreg].psx_ischanged) {
@@ -247,7 +268,7 @@ static void regUnlock(uint32_t reghost)
 
 static void regClearBranch(void)
 {
-	for (int i = 1; i < 32; i++) {
+	for (int i = 1; i < REG_PSX_CNT; i++) {
 		if (regcache.psx[i].ismapped && regcache.psx[i].psx_ischanged) {
 			SW(regcache.psx[i].mappedto, PERM_REG_1, offGPR(i));
 		}
@@ -257,7 +278,7 @@ static void regClearBranch(void)
 static void regReset()
 {
 	int i, i2;
-	for (i = 0; i < 32; i++) {
+	for (i = 0; i < REG_PSX_CNT; i++) {
 		regcache.psx[i].psx_ischanged = 0;
 		regcache.psx[i].ismapped = 0;
 		regcache.psx[i].mappedto = 0;
@@ -272,15 +293,18 @@ static void regReset()
 		regcache.host[i].mappedto = 0;
 	}
 
-	for (i = REG_CACHE_START; i < REG_CACHE_END; i++)
+	// Callee-saved regs are allocated first, caller-saved only after them
+	for (i = REG_CACHE_START, i2 = 0; i < REG_CACHE_END; i++, i2++) {
 		regcache.host[i].host_type = REG_EMPTY;
+		regcache.reglist[i2] = i;
+	}
 
-	for (i = 0, i2 = 0; i < 32; i++) {
-		if (regcache.host[i].host_type == REG_EMPTY) {
-			regcache.reglist[i2] = i;
-			i2++;
-		}
+#ifdef USE_TEMP_REGCACHE
+	for (i = REG_TEMP_CACHE_START; i < REG_TEMP_CACHE_END; i++, i2++) {
+		regcache.host[i].host_type = REG_EMPTY;
+		regcache.reglist[i2] = i;
 	}
+#endif
 
 	regcache.reglist[i2] = 0xFF;
 	regcache.reglist_cnt = 0;
@@ -290,9 +314,8 @@ static void regReset()
 
 static void regUpdate(void)
 {
-	int ilock;
-
-	for (ilock = REG_CACHE_START; ilock < REG_CACHE_END; ilock++) {
+	for (int i = 0; regcache.reglist[i] != 0xFF; i++) {
+		int ilock = regcache.reglist[i];
 		if (regcache.host[ilock].ismapped) {
 			regcache.host[ilock].host_age++;
 			regcache.host[ilock].host_islocked = 0;
@@ -300,6 +323,44 @@ static void regUpdate(void)
 	}
 }
 
+#ifdef USE_TEMP_REGCACHE
+/* Write back any PS1 regs held in caller-saved host regs, and keep those host
+ *  regs from being allocated until regUnreserveTempRegs() is called.
+ *  Called before emitting an opcode that might call C code.
+ */
+static void regReserveTempRegs(void)
+{
+	for (int hostreg = REG_TEMP_CACHE_START; hostreg < REG_TEMP_CACHE_END; hostreg++) {
+		if (regcache.host[hostreg].ismapped) {
+			int psxreg = regcache.host[hostreg].mappedto;
+
+			if (regcache.psx[psxreg].psx_ischanged) {
+				SW(hostreg, PERM_REG_1, offGPR(psxreg));
+			}
+
+			regcache.psx[psxreg].psx_ischanged = 0;
+			regcache.psx[psxreg].ismapped = 0;
+			regcache.psx[psxreg].mappedto = 0;
+		}
+
+		regcache.host[hostreg].ismapped = 0;
+		regcache.host[hostreg].mappedto = 0;
+		regcache.host[hostreg].host_type = REG_RESERVED;
+		regcache.host[hostreg].host_age = 0;
+		regcache.host[hostreg].host_use = 0;
+		regcache.host[hostreg].host_islocked = 0;
+	}
+}
+
+static void regUnreserveTempRegs(void)
+{
+	for (int hostreg = REG_TEMP_CACHE_START; hostreg < REG_TEMP_CACHE_END; hostreg++) {
+		if (regcache.host[hostreg].host_type == REG_RESERVED)
+			regcache.host[hostreg].host_type = REG_EMPTY;
+	}
+}
+#endif // USE_TEMP_REGCACHE
+
 static void regPushState()
 {
 	if (regcache_bak_idx >= (regcache_bak_size-1)) {
@@ -25,6 +25,7 @@
 #include "sio.h"
 #include "psxevents.h"
 #include "misc.h"
+#include "iothread.h"
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -421,14 +422,79 @@ int sioFreeze(void* f, enum FreezeMode mode)
 
 struct Memcard {
 	char* filename;       // Filename ptr, or NULL if card is disabled
-	FILE* file;           // File ptr is non-NULL when card is being written to
-	long  cur_offset;     // Current file offset (when file is open for writing)
+	uint_fast8_t unsynced; // Writes were queued since file was last synced
 	char  data[MCD_SIZE];
 };
 
 static struct Memcard memcards[2];
 #define mc memcards[mcd_num]
 
+// Memcard files are written by I/O thread jobs (see iothread.h), which
+//  keep a file open between writes. Only those jobs touch this.
+static struct {
+	FILE* file;           // File ptr is non-NULL when card is being written to
+	long  cur_offset;     // Current file offset (when file is open for writing)
+} mcd_files[2];
+
+// I/O thread job writing job->buf to memcard file arg[0] at offset arg[1]
+static int mcd_write_job(struct io_job *job)
+{
+	const int mcd_num = job->arg[0];
+	const uint32_t adr = job->arg[1];
+
+	// File isn't currently open for writing
+	if (mcd_files[mcd_num].file == NULL) {
+		mcd_files[mcd_num].cur_offset = 0;
+		if ((mcd_files[mcd_num].file = fopen(job->path, "r+b")) == NULL)
+			goto error;
+	}
+
+	if (mcd_files[mcd_num].cur_offset != adr) {
+		if (fseek(mcd_files[mcd_num].file, adr, SEEK_SET))
+			goto error;
+		mcd_files[mcd_num].cur_offset = adr;
+	}
+
+	if (fwrite(job->buf, 1, job->size, mcd_files[mcd_num].file) != job->size)
+		goto error;
+
+	mcd_files[mcd_num].cur_offset += job->size;
+
+	// Leave file open for writing, it will be closed by a job queued
+	//  by PSXINT_SIO_SYNC_MCD event
+	return 0;
+
+error:
+	printf("Error in %s() writing to memcard %d\n", __func__, mcd_num+1);
+	perror(NULL);
+	printf("Error writing to memcard file %s\n", job->path);
+	return -1;
+}
+
+// I/O thread job closing memcard file arg[0], if it was opened for
+//  writing. If arg[1] is true, it will call fsync() before closing it.
+static int mcd_flush_job(struct io_job *job)
+{
+	const int mcd_num = job->arg[0];
+	FILE *f = mcd_files[mcd_num].file;
+	if (!f)
+		return 0;
+
+	int retval = 0;
+	if (job->arg[1]) {
+		if (fflush(f)) retval = -1;
+		if (fsync(fileno(f))) retval = -1;
+	}
+	if (fclose(f)) retval = -1;
+	mcd_files[mcd_num].file = NULL;
+	mcd_files[mcd_num].cur_offset = 0;
+	if (retval < 0) {
+		perror(__func__);
+		printf("Error in %s() writing memcard file %s\n", __func__, job->path ? job->path : "");
+	}
+	return retval;
+}
+
 // Number of cycles after last memcard write to wait until
 //  PSXINT_SIO_SYNC_MCD event closes the memcard file.
 #define MEMCARD_SYNC_DELAY (PSXCLK / 4)
@@ -439,10 +505,14 @@ static struct Memcard memcards[2];
 //  memcard I/O to be done against a file kept open for a decent amount of
 //  time, allowing buffering and fewer open/close system calls.
 //  Will flush, sync, and close any memcard files opened for writing.
+//  This is queued to the I/O thread, the emu thread doesn't wait for it.
 void sioSyncMcds()
 {
-	FlushMcd(MCD1, true);
-	FlushMcd(MCD2, true);
+	for (int mcd_num = MCD1; mcd_num <= MCD2; mcd_num++) {
+		if (mc.unsynced)
+			ioQueue(mcd_flush_job, mc.filename, NULL, 0, mcd_num, true);
+		mc.unsynced = false;
+	}
 #ifdef DEBUG_MEMCARDS
 	printf("%s()\n", __func__);
 #endif
@@ -493,9 +563,9 @@ int sioMcdWrite(enum MemcardNum mcd_num, const char *src, uint32_t adr, int size
 		retval = SaveMcd(mcd_num, adr, size);
 	}
 
-	// If memcard file was already open for writing, or was just opened by
-	//  call to SaveMcd(), (re)schedule a memcard file flush/sync/close
-	if (memcards[mcd_num].file != NULL)
+	// If memcard file has writes queued that weren't synced yet,
+	//  (re)schedule a memcard file flush/sync/close
+	if (memcards[mcd_num].unsynced)
 		psxEvqueueAdd(PSXINT_SIO_SYNC_MCD, MEMCARD_SYNC_DELAY);
 
 	return retval;
@@ -543,24 +613,13 @@ int sioMcdFormat(enum MemcardNum mcd_num)
 
 // FlushMcd() ensures a memcard file temporarily opened for writing gets
 //  closed. If 'sync_file' is true, it will call fsync() before closing it.
+//  Waits for all queued memcard writes to be done, failures are reported
+//  through ioGetError().
 int FlushMcd(enum MemcardNum mcd_num, uint_fast8_t sync_file)
 {
-	if (!mc.file)
-		return 0;
-
-	int retval = 0;
-	if (sync_file) {
-		if (fflush(mc.file)) retval = -1;
-		if (fsync(fileno(mc.file))) retval = -1;
-	}
-	if (fclose(mc.file)) retval = -1;
-	mc.file = NULL;
-	mc.cur_offset = 0;
-	if (retval < 0) {
-		perror(__func__);
-		const char* tmpstr = mc.filename ? mc.filename : "";
-		printf("Error in %s() writing memcard file %s\n", __func__, tmpstr);
-	}
+	int retval = ioQueue(mcd_flush_job, mc.filename, NULL, 0, mcd_num, sync_file);
+	mc.unsynced = false;
+	ioSync();
 	return retval;
 }
 
@@ -568,8 +627,6 @@ int EjectMcd(enum MemcardNum mcd_num)
 {
 	int retval = FlushMcd(mcd_num, true);
 	mc.filename = NULL;
-	mc.file = NULL;
-	mc.cur_offset = 0;
 	memset(mc.data, 0, MCD_SIZE);
 	return retval;
 }
@@ -761,40 +818,24 @@ error:
 	return -1;
 }
 
+// Queue write of memcard data at 'adr' to file. Data is copied, the
+//  I/O thread writes it while emulation goes on.
 int SaveMcd(enum MemcardNum mcd_num, uint32_t adr, int size)
 {
-	// File isn't currently open for writing
-	if (mc.file == NULL) {
-		if (mc.filename == NULL || *mc.filename == '\0')
-			return 0;
-		mc.cur_offset = 0;
-		if ((mc.file = fopen(mc.filename, "r+b")) == NULL)
-			goto error;
-	}
+	if (mc.filename == NULL || *mc.filename == '\0')
+		return 0;
 
-	if (mc.cur_offset != adr) {
-		if (fseek(mc.file, adr, SEEK_SET))
-			goto error;
-		mc.cur_offset = adr;
+	void *buf = ioBufAlloc(size);
+	if (!buf) {
+		printf("Error in %s(): out of memory writing to memcard %d\n", __func__, mcd_num+1);
+		return -1;
 	}
+	memcpy(buf, mc.data + adr, size);
 
-	if (fwrite(mc.data + adr, 1, size, mc.file) != size)
-		goto error;
-
-	mc.cur_offset += size;
-
-	// Leave file open for writing, it will be close automatically
-	//  by PSXINT_SIO_SYNC_MCD event
+	if (ioQueue(mcd_write_job, mc.filename, buf, size, mcd_num, adr))
+		return -1;
+	mc.unsynced = true;
 	return 0;
-
-error:
-	printf("Error in %s() writing to memcard %d\n", __func__, mcd_num+1);
-	perror(NULL);
-	{
-		const char* tmpstr = mc.filename ? mc.filename : "";
-		printf("Error writing to memcard file %s\n", tmpstr);
-	}
-	return -1;
 }
 
 // remove the leading and trailing spaces in a string
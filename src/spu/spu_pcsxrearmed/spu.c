@@ -1261,7 +1261,8 @@ void CALLBACK SPUasync(unsigned int cycle, unsigned int flags)
   schedule_next_irq();
 
  if (flags & 1) {
-  out_current->feed(spu.pSpuBuffer, (unsigned char *)spu.pS - spu.pSpuBuffer);
+  if (!spu_config.iFastForward || !out_current->busy())
+   out_current->feed(spu.pSpuBuffer, (unsigned char *)spu.pS - spu.pSpuBuffer);
   spu.pS = (short *)spu.pSpuBuffer;
 
   if (spu_config.iTempo) {
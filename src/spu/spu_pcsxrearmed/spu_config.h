@@ -20,6 +20,10 @@ typedef struct
 
  //senquack - added to detect when configuration has been set
  int		iHaveConfiguration;
+
+ // set by frontend while fast-forwarding: output that doesn't fit
+ //  is dropped, as blocking on a full buffer would cap emu speed
+ int        iFastForward;
 } SPUConfig;
 
 extern SPUConfig spu_config;
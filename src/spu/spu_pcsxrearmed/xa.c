@@ -19,6 +19,14 @@
 #define _IN_XA
 #include <stdint.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define XA_USE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define XA_USE_NEON
+#endif
+
 // will be included from spu.c
 #ifdef _IN_SPU
 
@@ -129,6 +137,217 @@ static unsigned long timeGetTime_spu()
 #endif
 }
 
+////////////////////////////////////////////////////////////////////////
+// XA RESAMPLING
+////////////////////////////////////////////////////////////////////////
+
+// FeedXA() resamples a whole sector to 44.1kHz into a linear buffer
+//  first, so that the loops doing it are free of ring buffer checks.
+//  Largest is mono 18.9kHz: 4032 samples -> 9408
+#define XA_MAX_RESAMPLED (44100 * 4032 / 18900)
+static uint32_t xa_resampled[XA_MAX_RESAMPLED];
+
+// Gauss interpolation is a 4-tap polyphase filter: output sample i is
+//  taken from the 4 input samples ending at c-1, c = 1 + (i*sinc >> 16),
+//  using taps gauss[phase*4 .. phase*4+3], phase = (i*sinc >> 8) & 0xff.
+//  The 3 samples before the first input sample of a sector are the ones
+//  left in gauss_window by the previous sector.
+//  Each tap product is masked with ~2047 before summing, so the taps of
+//  one output are summed in SIMD lanes rather than with a multiply-add.
+
+// One stereo output from 4 L|R<<16 input pairs at 'taps'
+INLINE uint32_t xa_gauss(const uint32_t *taps, const short *g)
+{
+#if defined(XA_USE_SSE2)
+ const __m128i mask = _mm_set1_epi32(~2047);
+ __m128i s = _mm_loadu_si128((const __m128i *)taps);
+ __m128i c = _mm_loadl_epi64((const __m128i *)g);
+ c = _mm_unpacklo_epi16(c, c);                          // g0 g0 g1 g1 ..
+ __m128i lo = _mm_mullo_epi16(s, c);
+ __m128i hi = _mm_mulhi_epi16(s, c);
+ __m128i p01 = _mm_and_si128(_mm_unpacklo_epi16(lo, hi), mask);
+ __m128i p23 = _mm_and_si128(_mm_unpackhi_epi16(lo, hi), mask);
+ __m128i sum = _mm_add_epi32(p01, p23);
+ sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));      // L R
+ sum = _mm_srai_epi32(sum, 11);
+ sum = _mm_shufflelo_epi16(sum, _MM_SHUFFLE(3, 3, 2, 0));
+ return _mm_cvtsi128_si32(sum);
+#elif defined(XA_USE_NEON)
+ const int32x4_t mask = vdupq_n_s32(~2047);
+ int16x8_t s = vreinterpretq_s16_u32(vld1q_u32(taps));
+ int16x4_t c = vld1_s16(g);
+ int16x4x2_t cc = vzip_s16(c, c);                       // g0 g0 g1 g1 ..
+ int32x4_t p01 = vandq_s32(vmull_s16(vget_low_s16(s), cc.val[0]), mask);
+ int32x4_t p23 = vandq_s32(vmull_s16(vget_high_s16(s), cc.val[1]), mask);
+ int32x4_t sum4 = vaddq_s32(p01, p23);
+ int32x2_t sum = vshr_n_s32(vadd_s32(vget_low_s32(sum4), vget_high_s32(sum4)), 11);
+ int16x4_t h = vmovn_s32(vcombine_s32(sum, sum));
+ return vget_lane_u32(vreinterpret_u32_s16(h), 0);
+#else
+ int vl, vr, k;
+ vl = vr = 0;
+ for(k=0;k<4;k++)
+  {
+   vl+=(g[k]*(short)LOWORD(taps[k]))&~2047;
+   vr+=(g[k]*(short)HIWORD(taps[k]))&~2047;
+  }
+ return ((vl >> 11) & 0xffff) | (vr << 5);
+#endif
+}
+
+// One mono output from 4 input samples at 'taps'
+INLINE short xa_gauss_mono(const short *taps, const short *g)
+{
+#if defined(XA_USE_SSE2)
+ __m128i s = _mm_loadl_epi64((const __m128i *)taps);
+ __m128i c = _mm_loadl_epi64((const __m128i *)g);
+ __m128i p = _mm_unpacklo_epi16(_mm_mullo_epi16(s, c), _mm_mulhi_epi16(s, c));
+ p = _mm_and_si128(p, _mm_set1_epi32(~2047));
+ p = _mm_add_epi32(p, _mm_srli_si128(p, 8));
+ p = _mm_add_epi32(p, _mm_srli_si128(p, 4));
+ return _mm_cvtsi128_si32(p) >> 11;
+#elif defined(XA_USE_NEON)
+ int32x4_t p = vandq_s32(vmull_s16(vld1_s16(taps), vld1_s16(g)), vdupq_n_s32(~2047));
+ int32x2_t sum = vadd_s32(vget_low_s32(p), vget_high_s32(p));
+ sum = vpadd_s32(sum, sum);
+ return vget_lane_s32(sum, 0) >> 11;
+#else
+ int vr, k;
+ vr = 0;
+ for(k=0;k<4;k++)
+  vr+=(g[k]*taps[k])&~2047;
+ return vr >> 11;
+#endif
+}
+
+// Stereo samples in, stereo pairs out. Without interpolation, output
+//  sample i is simply input sample (i*sinc)>>16: no loop-carried state.
+static void xa_resample_stereo(const uint32_t *pS, uint32_t *dst, int n, int sinc)
+{
+ int i;
+
+ if(n<=0) return;
+
+ if(spu_config.iUseInterpolation==2)
+  {
+   uint32_t head[7];                                   // gauss_window, pS[0..2]
+   const uint32_t *taps = head;
+   unsigned pos = 0;
+   int c = 0;
+   for(i=0;i<4;i++)
+    head[i] = (gvall(i) & 0xffff) | (gvalr(i) << 16);
+   memcpy(head + 4, pS, 3 * sizeof(head[0]));
+   for(i=0;i<n;i++,pos+=sinc)
+    {
+     c = 1 + (pos >> 16);
+     taps = c < 4 ? head + c : pS + c - 4;
+     dst[i] = xa_gauss(taps, gauss + ((pos >> 6) & 0x3fc));
+    }
+   // Window is left holding the taps of the last output
+   gauss_ptr = (gauss_ptr + c) & 3;
+   for(i=0;i<4;i++)
+    {
+     gvall(i) = (short)LOWORD(taps[i]);
+     gvalr(i) = (short)HIWORD(taps[i]);
+    }
+  }
+ else
+  {
+   for(i=0;i<n;i++)
+    dst[i] = pS[((unsigned)i*sinc) >> 16];
+  }
+}
+
+// Mono samples in, stereo pairs out (same sample in both channels)
+static void xa_resample_mono(const short *pS, uint32_t *dst, int n, int sinc)
+{
+ int i;
+
+ if(n<=0) return;
+
+ if(spu_config.iUseInterpolation==2)
+  {
+   short head[7];                                      // gauss_window, pS[0..2]
+   const short *taps = head;
+   unsigned pos = 0;
+   int c = 0;
+   for(i=0;i<4;i++)
+    head[i] = gvall(i);
+   memcpy(head + 4, pS, 3 * sizeof(head[0]));
+   for(i=0;i<n;i++,pos+=sinc)
+    {
+     c = 1 + (pos >> 16);
+     taps = c < 4 ? head + c : pS + c - 4;
+     uint32_t l = (unsigned short)xa_gauss_mono(taps, gauss + ((pos >> 6) & 0x3fc));
+     dst[i] = l | (l << 16);
+    }
+   gauss_ptr = (gauss_ptr + c) & 3;
+   for(i=0;i<4;i++)
+    gvall(i) = taps[i];
+  }
+ else
+  {
+   for(i=0;i<n;i++)
+    {
+     uint32_t l = (unsigned short)pS[((unsigned)i*sinc) >> 16];
+     dst[i] = l | (l << 16);
+    }
+  }
+}
+
+// XAPitch option: scale volume of both channels by iPlace/iSize
+static void xa_scale(uint32_t *buf, int iSize, int iPlace)
+{
+ int i;
+ for(i=0;i<iSize;i++)
+  {
+   int32_t l1 = (short)LOWORD(buf[i]);
+   int32_t l2 = (short)HIWORD(buf[i]);
+   l1=(l1*iPlace)/iSize;
+   ssat32_to_16(l1);
+   l2=(l2*iPlace)/iSize;
+   ssat32_to_16(l2);
+   buf[i]=(l1&0xffff)|(l2<<16);
+  }
+}
+
+// Copy resampled data into the XA ring buffer. If it fills up, stop
+//  just behind spu.XAPlay, as per-sample checks used to.
+static void xa_ring_write(const uint32_t *src, int n)
+{
+ while(n>0)
+  {
+   int seg = spu.XAEnd-spu.XAFeed;
+   int full = 0;
+   if(spu.XAPlay>spu.XAFeed && spu.XAPlay-spu.XAFeed<=seg)
+    {
+     seg = spu.XAPlay-spu.XAFeed;
+     full = 1;
+    }
+   if(seg>n)
+    {
+     seg = n;
+     full = 0;
+    }
+
+   memcpy(spu.XAFeed, src, seg*4);
+   spu.XAFeed+=seg;
+   src+=seg;
+   n-=seg;
+
+   if(spu.XAFeed==spu.XAEnd)
+    {
+     spu.XAFeed=spu.XAStart;
+     if(spu.XAFeed==spu.XAPlay) full = 1;
+    }
+   if(full)
+    {
+     if(spu.XAPlay!=spu.XAStart) spu.XAFeed=spu.XAPlay-1;
+     break;
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // FEED XA 
 ////////////////////////////////////////////////////////////////////////
@@ -140,7 +359,7 @@ INLINE void FeedXA(xa_decode_t *xap)
  if ((!xap) || (xap->nsamples == 0) || (xap->freq == 0))
   return;
 
- int sinc,spos,i,iSize,iPlace,vl,vr;
+ int sinc,iSize,iPlace;
 
  if(!spu.bSPUIsOpen) return;
 
@@ -232,214 +451,18 @@ INLINE void FeedXA(xa_decode_t *xap)
   }
  //----------------------------------------------------//
 
- spos=0x10000L;
  sinc = (xap->nsamples << 16) / iSize;                 // calc freq by num / size
 
+ if (iSize > XA_MAX_RESAMPLED) return;
  if(xap->stereo)
-{
-   uint32_t * pS=(uint32_t *)xap->pcm;
-   uint32_t l=0;
-
-   if(spu_config.iXAPitch)
-    {
-     int32_t l1,l2;short s;
-     for(i=0;i<iSize;i++)
-      {
-       if(spu_config.iUseInterpolation==2)
-        {
-         while(spos>=0x10000L)
-          {
-           l = *pS++;
-           gauss_window[gauss_ptr] = (short)LOWORD(l);
-           gauss_window[4+gauss_ptr] = (short)HIWORD(l);
-           gauss_ptr = (gauss_ptr+1) & 3;
-           spos -= 0x10000L;
-          }
-         vl = (spos >> 6) & ~3;
-         vr=(gauss[vl]*gvall0)&~2047;
-         vr+=(gauss[vl+1]*gvall(1))&~2047;
-         vr+=(gauss[vl+2]*gvall(2))&~2047;
-         vr+=(gauss[vl+3]*gvall(3))&~2047;
-         l= (vr >> 11) & 0xffff;
-         vr=(gauss[vl]*gvalr0)&~2047;
-         vr+=(gauss[vl+1]*gvalr(1))&~2047;
-         vr+=(gauss[vl+2]*gvalr(2))&~2047;
-         vr+=(gauss[vl+3]*gvalr(3))&~2047;
-         l |= vr << 5;
-        }
-       else
-        {
-         while(spos>=0x10000L)
-          {
-           l = *pS++;
-           spos -= 0x10000L;
-          }
-        }
-
-       s=(short)LOWORD(l);
-       l1=s;
-       l1=(l1*iPlace)/iSize;
-       ssat32_to_16(l1);
-       s=(short)HIWORD(l);
-       l2=s;
-       l2=(l2*iPlace)/iSize;
-       ssat32_to_16(l2);
-       l=(l1&0xffff)|(l2<<16);
-
-       *spu.XAFeed++=l;
-
-       if(spu.XAFeed==spu.XAEnd) spu.XAFeed=spu.XAStart;
-       if(spu.XAFeed==spu.XAPlay)
-        {
-         if(spu.XAPlay!=spu.XAStart) spu.XAFeed=spu.XAPlay-1;
-         break;
-        }
-
-       spos += sinc;
-      }
-    }
-   else
-    {
-     for(i=0;i<iSize;i++)
-      {
-       if(spu_config.iUseInterpolation==2)
-        {
-         while(spos>=0x10000L)
-          {
-           l = *pS++;
-           gauss_window[gauss_ptr] = (short)LOWORD(l);
-           gauss_window[4+gauss_ptr] = (short)HIWORD(l);
-           gauss_ptr = (gauss_ptr+1) & 3;
-           spos -= 0x10000L;
-          }
-         vl = (spos >> 6) & ~3;
-         vr=(gauss[vl]*gvall0)&~2047;
-         vr+=(gauss[vl+1]*gvall(1))&~2047;
-         vr+=(gauss[vl+2]*gvall(2))&~2047;
-         vr+=(gauss[vl+3]*gvall(3))&~2047;
-         l= (vr >> 11) & 0xffff;
-         vr=(gauss[vl]*gvalr0)&~2047;
-         vr+=(gauss[vl+1]*gvalr(1))&~2047;
-         vr+=(gauss[vl+2]*gvalr(2))&~2047;
-         vr+=(gauss[vl+3]*gvalr(3))&~2047;
-         l |= vr << 5;
-        }
-       else
-        {
-         while(spos>=0x10000L)
-          {
-           l = *pS++;
-           spos -= 0x10000L;
-          }
-        }
-
-       *spu.XAFeed++=l;
-
-       if(spu.XAFeed==spu.XAEnd) spu.XAFeed=spu.XAStart;
-       if(spu.XAFeed==spu.XAPlay)
-        {
-         if(spu.XAPlay!=spu.XAStart) spu.XAFeed=spu.XAPlay-1;
-         break;
-        }
-
-       spos += sinc;
-      }
-    }
-  }
+  xa_resample_stereo((uint32_t *)xap->pcm, xa_resampled, iSize, sinc);
  else
-  {
-   unsigned short * pS=(unsigned short *)xap->pcm;
-   uint32_t l;short s=0;
+  xa_resample_mono(xap->pcm, xa_resampled, iSize, sinc);
 
-   if(spu_config.iXAPitch)
-    {
-     int32_t l1;
-     for(i=0;i<iSize;i++)
-      {
-       if(spu_config.iUseInterpolation==2)
-        {
-         while(spos>=0x10000L)
-          {
-           gauss_window[gauss_ptr] = (short)*pS++;
-           gauss_ptr = (gauss_ptr+1) & 3;
-           spos -= 0x10000L;
-          }
-         vl = (spos >> 6) & ~3;
-         vr=(gauss[vl]*gvall0)&~2047;
-         vr+=(gauss[vl+1]*gvall(1))&~2047;
-         vr+=(gauss[vl+2]*gvall(2))&~2047;
-         vr+=(gauss[vl+3]*gvall(3))&~2047;
-         l1=s= vr >> 11;
-         l1 &= 0xffff;
-        }
-       else
-        {
-         while(spos>=0x10000L)
-          {
-           s = *pS++;
-           spos -= 0x10000L;
-          }
-         l1=s;
-        }
-
-       l1=(l1*iPlace)/iSize;
-       ssat32_to_16(l1);
-       l=(l1&0xffff)|(l1<<16);
-       *spu.XAFeed++=l;
-
-       if(spu.XAFeed==spu.XAEnd) spu.XAFeed=spu.XAStart;
-       if(spu.XAFeed==spu.XAPlay)
-        {
-         if(spu.XAPlay!=spu.XAStart) spu.XAFeed=spu.XAPlay-1;
-         break;
-        }
-
-       spos += sinc;
-      }
-    }
-   else
-    {
-     for(i=0;i<iSize;i++)
-      {
-       if(spu_config.iUseInterpolation==2)
-        {
-         while(spos>=0x10000L)
-          {
-           gauss_window[gauss_ptr] = (short)*pS++;
-           gauss_ptr = (gauss_ptr+1) & 3;
-           spos -= 0x10000L;
-          }
-         vl = (spos >> 6) & ~3;
-         vr=(gauss[vl]*gvall0)&~2047;
-         vr+=(gauss[vl+1]*gvall(1))&~2047;
-         vr+=(gauss[vl+2]*gvall(2))&~2047;
-         vr+=(gauss[vl+3]*gvall(3))&~2047;
-         l=s= vr >> 11;
-        }
-       else
-        {
-         while(spos>=0x10000L)
-          {
-           s = *pS++;
-           spos -= 0x10000L;
-          }
-         l=s;
-        }
-
-       l &= 0xffff;
-       *spu.XAFeed++=(l|(l<<16));
-
-       if(spu.XAFeed==spu.XAEnd) spu.XAFeed=spu.XAStart;
-       if(spu.XAFeed==spu.XAPlay)
-        {
-         if(spu.XAPlay!=spu.XAStart) spu.XAFeed=spu.XAPlay-1;
-         break;
-        }
-
-       spos += sinc;
-      }
-    }
-  }
+ if(spu_config.iXAPitch)
+  xa_scale(xa_resampled, iSize, iPlace);
+
+ xa_ring_write(xa_resampled, iSize);
 
   //senquack - update new XABufferRoom variable now that data's been added:
   UpdateXABufferRoom();
@@ -0,0 +1,436 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Chunked savestate container, see statefile.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "statefile.h"
+
+static const char magic[8] = { 'P', 'C', 'S', 'X', 'S', 'T', 'C', '1' };
+
+// Sanity limits for chunk table read from file
+#define MAX_CHUNKS      4096
+#define MAX_STATE_SIZE  (64 * 1024 * 1024)
+
+struct state_file {
+	FILE *f;
+	uint32_t num_chunks;
+	struct state_chunk *chunks;
+	size_t *start;        // Offset of each chunk in uncompressed data
+	uint8_t *loaded;      // Chunk is in 'data' already
+	uint8_t *data;
+	size_t size, pos;
+};
+
+/////////////////////////
+// Parallel chunk loop //
+/////////////////////////
+
+struct par_loop {
+	pthread_mutex_t lock;
+	int next, count, error;
+	int (*func)(void *ctx, int i);
+	void *ctx;
+};
+
+static void *par_worker(void *arg)
+{
+	struct par_loop *p = (struct par_loop *)arg;
+
+	for (;;) {
+		pthread_mutex_lock(&p->lock);
+		int i = p->error ? p->count : p->next++;
+		pthread_mutex_unlock(&p->lock);
+		if (i >= p->count)
+			break;
+
+		if (p->func(p->ctx, i) != 0) {
+			pthread_mutex_lock(&p->lock);
+			p->error = 1;
+			pthread_mutex_unlock(&p->lock);
+		}
+	}
+	return NULL;
+}
+
+// Calls func(ctx, i) for i = 0..count-1 on up to STATEFILE_MAX_THREADS
+//  threads, calling thread being one of them. Returns -1 if a call failed.
+static int par_for(int count, int (*func)(void *ctx, int i), void *ctx)
+{
+	pthread_t threads[STATEFILE_MAX_THREADS];
+	struct par_loop p;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int n = cpus < 1 ? 1 : cpus > STATEFILE_MAX_THREADS ? STATEFILE_MAX_THREADS : (int)cpus;
+	int started;
+
+	if (n > count)
+		n = count;
+
+	if (pthread_mutex_init(&p.lock, NULL) != 0)
+		return -1;
+	p.next = 0;
+	p.count = count;
+	p.error = 0;
+	p.func = func;
+	p.ctx = ctx;
+
+	// If a thread can't be created, the ones running do its share
+	for (started = 0; started < n - 1; started++)
+		if (pthread_create(&threads[started], NULL, par_worker, &p) != 0)
+			break;
+	par_worker(&p);
+	while (started--)
+		pthread_join(threads[started], NULL);
+
+	pthread_mutex_destroy(&p.lock);
+	return p.error ? -1 : 0;
+}
+
+/////////////
+// Writing //
+/////////////
+
+struct write_ctx {
+	const uint8_t *data;
+	struct state_chunk *chunks;
+	size_t *start;
+	uint8_t **out;
+};
+
+static int compress_chunk(void *arg, int i)
+{
+	struct write_ctx *w = (struct write_ctx *)arg;
+	struct state_chunk *c = &w->chunks[i];
+	const uint8_t *src = w->data + w->start[i];
+
+	if (c->method == STATE_CHUNK_STORED) {
+		w->out[i] = (uint8_t *)src;
+		c->stored_size = c->size;
+	} else {
+		// Default zlib compression level 6 is a bit slow.. 4 is faster
+		uLongf len = compressBound(c->size);
+		if ((w->out[i] = (uint8_t *)malloc(len)) == NULL ||
+		    compress2(w->out[i], &len, src, c->size, 4) != Z_OK)
+			return -1;
+		c->stored_size = len;
+	}
+
+	c->crc = crc32(crc32(0L, Z_NULL, 0), w->out[i], c->stored_size);
+	return 0;
+}
+
+int StateFileWrite(const char *name, const void *data, size_t size,
+                   size_t stored_size)
+{
+	struct write_ctx w;
+	uint32_t num_chunks, version = STATEFILE_VERSION, i;
+	uint32_t offset;
+	FILE *f = NULL;
+	int retval = -1;
+
+	if (stored_size > size)
+		stored_size = size;
+	num_chunks = (stored_size ? 1 : 0) +
+	             (size - stored_size + STATEFILE_CHUNK_SIZE - 1) / STATEFILE_CHUNK_SIZE;
+
+	w.data = (const uint8_t *)data;
+	w.chunks = (struct state_chunk *)calloc(num_chunks, sizeof(*w.chunks));
+	w.start = (size_t *)calloc(num_chunks, sizeof(*w.start));
+	w.out = (uint8_t **)calloc(num_chunks, sizeof(*w.out));
+	if (!w.chunks || !w.start || !w.out) {
+		printf("Error in %s(): out of memory\n", __func__);
+		goto out;
+	}
+
+	for (i = 0; i < num_chunks; i++) {
+		size_t start = i ? w.start[i-1] + w.chunks[i-1].size : 0;
+		size_t left = size - start;
+		w.start[i] = start;
+		if (i == 0 && stored_size) {
+			w.chunks[i].method = STATE_CHUNK_STORED;
+			w.chunks[i].size = stored_size;
+		} else {
+			w.chunks[i].method = STATE_CHUNK_DEFLATE;
+			w.chunks[i].size = left < STATEFILE_CHUNK_SIZE ? left : STATEFILE_CHUNK_SIZE;
+		}
+	}
+
+	if (par_for(num_chunks, compress_chunk, &w) != 0) {
+		printf("Error in %s(): compressing savestate failed\n", __func__);
+		goto out;
+	}
+
+	offset = sizeof(magic) + 2 * sizeof(uint32_t) + num_chunks * sizeof(struct state_chunk);
+	for (i = 0; i < num_chunks; i++) {
+		w.chunks[i].offset = offset;
+		offset += w.chunks[i].stored_size;
+	}
+
+	if ((f = fopen(name, "wb")) == NULL)
+		goto error;
+
+	if (fwrite(magic, sizeof(magic), 1, f) != 1                      ||
+	    fwrite(&version, sizeof(version), 1, f) != 1                 ||
+	    fwrite(&num_chunks, sizeof(num_chunks), 1, f) != 1          ||
+	    fwrite(w.chunks, sizeof(*w.chunks), num_chunks, f) != num_chunks)
+		goto error;
+
+	for (i = 0; i < num_chunks; i++)
+		if (fwrite(w.out[i], 1, w.chunks[i].stored_size, f) != w.chunks[i].stored_size)
+			goto error;
+
+	retval = 0;
+	if (fflush(f)) retval = -1;
+#if !(defined(_WIN32) && !defined(__CYGWIN__))
+	if (fsync(fileno(f))) retval = -1;
+#endif
+
+error:
+	if (f && fclose(f)) retval = -1;
+	if (retval < 0)
+		perror(__func__);
+out:
+	if (w.out)
+		for (i = 0; i < num_chunks; i++)
+			if (w.chunks[i].method != STATE_CHUNK_STORED)
+				free(w.out[i]);
+	free(w.out);
+	free(w.start);
+	free(w.chunks);
+	return retval;
+}
+
+/////////////
+// Reading //
+/////////////
+
+int StateFileIsChunked(const char *name)
+{
+	char buf[sizeof(magic)];
+	FILE *f = fopen(name, "rb");
+	int ret;
+
+	if (!f)
+		return 0;
+	ret = fread(buf, sizeof(buf), 1, f) == 1 && memcmp(buf, magic, sizeof(magic)) == 0;
+	fclose(f);
+	return ret;
+}
+
+struct state_file *StateFileOpen(const char *name)
+{
+	struct state_file *sf;
+	char buf[sizeof(magic)];
+	uint32_t version, i;
+
+	if ((sf = (struct state_file *)calloc(1, sizeof(*sf))) == NULL)
+		return NULL;
+
+	if ((sf->f = fopen(name, "rb")) == NULL)
+		goto error;
+
+	if (fread(buf, sizeof(buf), 1, sf->f) != 1                           ||
+	    fread(&version, sizeof(version), 1, sf->f) != 1                   ||
+	    fread(&sf->num_chunks, sizeof(sf->num_chunks), 1, sf->f) != 1     ||
+	    memcmp(buf, magic, sizeof(magic)) != 0)
+		goto error;
+
+	if (version != STATEFILE_VERSION || sf->num_chunks > MAX_CHUNKS) {
+		printf("Error in %s(): unsupported savestate container %s\n", __func__, name);
+		goto error;
+	}
+
+	sf->chunks = (struct state_chunk *)calloc(sf->num_chunks + 1, sizeof(*sf->chunks));
+	sf->start = (size_t *)calloc(sf->num_chunks + 1, sizeof(*sf->start));
+	sf->loaded = (uint8_t *)calloc(sf->num_chunks + 1, 1);
+	if (!sf->chunks || !sf->start || !sf->loaded ||
+	    fread(sf->chunks, sizeof(*sf->chunks), sf->num_chunks, sf->f) != sf->num_chunks)
+		goto error;
+
+	for (i = 0; i < sf->num_chunks; i++) {
+		const struct state_chunk *c = &sf->chunks[i];
+		if (c->method > STATE_CHUNK_DEFLATE ||
+		    (c->method == STATE_CHUNK_STORED && c->stored_size != c->size) ||
+		    c->size > MAX_STATE_SIZE - sf->size)
+			goto error;
+		sf->start[i] = sf->size;
+		sf->size += c->size;
+	}
+
+	// Pages are only touched when chunks are loaded, so this costs
+	//  little when just the screenshot is read.
+	if ((sf->data = (uint8_t *)malloc(sf->size + 1)) == NULL)
+		goto error;
+
+	return sf;
+
+error:
+	printf("Error in %s() reading savestate file %s\n", __func__, name);
+	StateFileClose(sf);
+	return NULL;
+}
+
+static int load_stored_chunk(struct state_file *sf, uint32_t i)
+{
+	const struct state_chunk *c = &sf->chunks[i];
+	uint8_t *dst = sf->data + sf->start[i];
+
+	if (fseek(sf->f, c->offset, SEEK_SET) != 0 ||
+	    fread(dst, 1, c->size, sf->f) != c->size ||
+	    crc32(crc32(0L, Z_NULL, 0), dst, c->size) != c->crc)
+		return -1;
+
+	sf->loaded[i] = 1;
+	return 0;
+}
+
+struct inflate_ctx {
+	struct state_file *sf;
+	uint32_t *idx;        // Chunks to inflate
+	uint8_t **src;        // Their compressed data
+};
+
+static int inflate_chunk(void *arg, int n)
+{
+	struct inflate_ctx *x = (struct inflate_ctx *)arg;
+	struct state_file *sf = x->sf;
+	const uint32_t i = x->idx[n];
+	const struct state_chunk *c = &sf->chunks[i];
+	uLongf len = c->size;
+
+	if (crc32(crc32(0L, Z_NULL, 0), x->src[n], c->stored_size) != c->crc ||
+	    uncompress(sf->data + sf->start[i], &len, x->src[n], c->stored_size) != Z_OK ||
+	    len != c->size)
+		return -1;
+	return 0;
+}
+
+// Read compressed data of all deflated chunks not loaded yet, one after the
+//  other as they lie in file, then inflate them in parallel.
+static int load_deflated_chunks(struct state_file *sf)
+{
+	struct inflate_ctx x;
+	uint8_t *buf = NULL;
+	size_t buf_size = 0;
+	uint32_t i, n = 0;
+	int retval = -1;
+
+	x.sf = sf;
+	x.idx = (uint32_t *)malloc(sf->num_chunks * sizeof(*x.idx));
+	x.src = (uint8_t **)malloc(sf->num_chunks * sizeof(*x.src));
+	if (!x.idx || !x.src)
+		goto out;
+
+	for (i = 0; i < sf->num_chunks; i++) {
+		if (sf->loaded[i] || sf->chunks[i].method != STATE_CHUNK_DEFLATE)
+			continue;
+		x.idx[n++] = i;
+		buf_size += sf->chunks[i].stored_size;
+	}
+
+	if ((buf = (uint8_t *)malloc(buf_size + 1)) == NULL)
+		goto out;
+
+	buf_size = 0;
+	for (i = 0; i < n; i++) {
+		const struct state_chunk *c = &sf->chunks[x.idx[i]];
+		x.src[i] = buf + buf_size;
+		if (fseek(sf->f, c->offset, SEEK_SET) != 0 ||
+		    fread(x.src[i], 1, c->stored_size, sf->f) != c->stored_size)
+			goto out;
+		buf_size += c->stored_size;
+	}
+
+	if (par_for(n, inflate_chunk, &x) != 0)
+		goto out;
+
+	for (i = 0; i < n; i++)
+		sf->loaded[x.idx[i]] = 1;
+	retval = 0;
+
+out:
+	free(buf);
+	free(x.src);
+	free(x.idx);
+	return retval;
+}
+
+int StateFileRead(struct state_file *sf, void *buf, uint32_t len)
+{
+	size_t end;
+	uint32_t i;
+
+	if (sf->pos >= sf->size)
+		return 0;
+	if (len > sf->size - sf->pos)
+		len = sf->size - sf->pos;
+	end = sf->pos + len;
+
+	for (i = 0; i < sf->num_chunks; i++) {
+		if (sf->loaded[i] || sf->start[i] >= end ||
+		    sf->start[i] + sf->chunks[i].size <= sf->pos)
+			continue;
+
+		if ((sf->chunks[i].method == STATE_CHUNK_STORED ?
+		     load_stored_chunk(sf, i) : load_deflated_chunks(sf)) != 0) {
+			printf("Error in %s(): savestate chunk %u is corrupt\n", __func__, i);
+			return -1;
+		}
+	}
+
+	memcpy(buf, sf->data + sf->pos, len);
+	sf->pos = end;
+	return len;
+}
+
+long StateFileSeek(struct state_file *sf, long offs, int whence)
+{
+	long pos;
+
+	switch (whence) {
+		case SEEK_SET: pos = offs; break;
+		case SEEK_CUR: pos = (long)sf->pos + offs; break;
+		case SEEK_END: pos = (long)sf->size + offs; break;
+		default: return -1;
+	}
+
+	if (pos < 0 || pos > (long)sf->size)
+		return -1;
+	sf->pos = pos;
+	return pos;
+}
+
+int StateFileClose(struct state_file *sf)
+{
+	if (!sf)
+		return 0;
+	if (sf->f)
+		fclose(sf->f);
+	free(sf->data);
+	free(sf->loaded);
+	free(sf->start);
+	free(sf->chunks);
+	free(sf);
+	return 0;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Chunked savestate container
+ *
+ * Savestates used to be one gzip stream, so reading the screenshot meant
+ * inflating from the start of file and loading couldn't use more than one
+ * core. The container holds the same data stream SaveState() produces,
+ * split in chunks that are compressed independently:
+ *
+ *   char     magic[8]        "PCSXSTC1"
+ *   uint32_t version         STATEFILE_VERSION
+ *   uint32_t num_chunks
+ *   struct state_chunk[num_chunks]
+ *   chunk data, in order of chunk table
+ *
+ * First chunk is stored uncompressed: it holds the savestate header and
+ * embedded screenshot, which the savestate menu reads with a single read.
+ * The rest is deflated in STATEFILE_CHUNK_SIZE pieces, which are
+ * compressed and inflated on up to STATEFILE_MAX_THREADS threads.
+ *
+ * Like the rest of the savestate, integers are in host byte order.
+ */
+
+#ifndef __STATEFILE_H__
+#define __STATEFILE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STATEFILE_VERSION      1
+#define STATEFILE_CHUNK_SIZE   (256 * 1024)
+#define STATEFILE_MAX_THREADS  4
+
+enum {
+	STATE_CHUNK_STORED = 0,
+	STATE_CHUNK_DEFLATE
+};
+
+struct state_chunk {
+	uint32_t method;      // STATE_CHUNK_*
+	uint32_t offset;      // Offset of data in file
+	uint32_t stored_size; // Size of data in file
+	uint32_t size;        // Size of data uncompressed
+	uint32_t crc;         // crc32 of data in file
+};
+
+struct state_file;
+
+// Returns 1 if 'name' is a chunked savestate, 0 if not (older gzip
+//  savestate) or it can't be read.
+int StateFileIsChunked(const char *name);
+
+// Write 'size' bytes at 'data' to 'name', with first 'stored_size' bytes
+//  uncompressed. Calls fsync() before closing. Returns 0 on success.
+int StateFileWrite(const char *name, const void *data, size_t size,
+                   size_t stored_size);
+
+// Read side works like the SaveFuncs read/seek/close of a gzip savestate.
+//  Chunks are read when a read first reaches into them; reaching into a
+//  deflated chunk inflates all remaining ones in parallel.
+struct state_file *StateFileOpen(const char *name);
+int StateFileRead(struct state_file *sf, void *buf, uint32_t len);
+long StateFileSeek(struct state_file *sf, long offs, int whence);
+int StateFileClose(struct state_file *sf);
+
+#endif /* __STATEFILE_H__ */